@@ -0,0 +1,52 @@
+#include <helper.h>
+#include <iostream>
+#include <pipeline-lib.h>
+
+bool parse_args(int argc, const char** argv, std::string& output, std::string& input);
+
+int main(int argc, const char** argv) {
+	std::string output, input;
+	if (!parse_args(argc, argv, output, input)) return -1;
+	if (output.empty()) return 0;
+
+	try {
+		snowboy::ConvertToModelContainer(input, output);
+	} catch (const std::exception& e) {
+		std::cerr << "Failed to convert \"" << input << "\": " << e.what() << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+bool parse_args(int argc, const char** argv, std::string& output, std::string& input) {
+	option_parser parser;
+	parser.option("--output", &output).set_shortname("-o").set_description("Output filename for the model container");
+	parser.option("--input", &input).set_shortname("-i").set_required(true).set_description("Model (.umdl, .pmdl) or resource (.res) to convert");
+	bool print_help = false;
+	parser.option("--help", &print_help).set_shortname("-h").set_description("Print help");
+	std::vector<std::string> extra_args;
+	try {
+		extra_args = parser.parse(argc - 1, argv + 1);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+	if (print_help) {
+		parser.print_help(std::cout);
+		return true;
+	}
+	if (input.empty() && !extra_args.empty()) {
+		input = extra_args.front();
+		extra_args.erase(extra_args.begin());
+	}
+	if (output.empty() && !extra_args.empty()) {
+		output = extra_args.front();
+		extra_args.erase(extra_args.begin());
+	}
+	if (output.empty() && !input.empty()) output = input + ".snowmdl";
+	if (input.empty()) {
+		std::cerr << "Missing required argument" << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,174 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <helper.h>
+#include <iostream>
+#include <memory>
+#include <snowboy-detect.h>
+#include <snowboy-io.h>
+#include <snowboy-utils.h>
+#include <sstream>
+#include <thread>
+#include <wave-reader.h>
+
+const static auto root = detect_project_root();
+
+struct score_options {
+	std::string resource;
+	std::string models;
+	std::string sensitivity;
+	std::string high_sensitivity;
+	std::string output;
+	std::string list;
+	std::string sweep;
+	std::vector<float> sweep_values;
+	std::vector<std::string> files;
+	int64_t threads = 0;
+	int64_t chunk_ms = 1000;
+	int64_t sweep_rerun_ms = 2000;
+	bool frontend = false;
+};
+
+bool parse_args(int argc, const char** argv, score_options& options);
+
+int main(int argc, const char** argv) {
+	score_options options;
+	if (!parse_args(argc, argv, options)) return -1;
+	if (options.models.empty()) return 0;
+
+	// Keep the resource and models mapped for the whole run, so the detectors of all workers share them
+	std::vector<std::shared_ptr<const snowboy::MappedFile>> pins;
+	try {
+		pins.push_back(snowboy::PinMappedFile(options.resource));
+		for (auto& e : split(options.models, ","))
+			pins.push_back(snowboy::PinMappedFile(e));
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	}
+
+	std::vector<std::string> results(options.files.size());
+	std::atomic<size_t> next_file{0};
+	std::atomic<uint64_t> total_audio_ms{0};
+	std::atomic<size_t> failed{0};
+	auto start = std::chrono::steady_clock::now();
+	snowboy::ParallelFor(
+		options.threads, [&](size_t) {
+			for (size_t f = next_file++; f < options.files.size(); f = next_file++) {
+				auto& file = options.files[f];
+				std::stringstream out;
+				try {
+					// A fresh detector per file keeps the results independent of how files are spread over workers
+					snowboy::SnowboyDetect detector(options.resource, options.models);
+					if (!options.sensitivity.empty()) detector.SetSensitivity(options.sensitivity);
+					if (!options.high_sensitivity.empty()) detector.SetHighSensitivity(options.high_sensitivity);
+					detector.ApplyFrontend(options.frontend);
+					// Sweeps record the scores once and evaluate every sensitivity from them
+					if (!options.sweep_values.empty()) detector.StartScoreTrace(options.sweep_rerun_ms / 1000.0f);
+					snowboy::WaveReader reader{file};
+					// Files recorded at another rate are resampled by the detector
+					if (reader.Header().dwSamplesPerSec != static_cast<uint32_t>(detector.SampleRate()))
+						detector.SetInputSampleRate(reader.Header().dwSamplesPerSec);
+					reader.CheckFormat(detector.SampleRate(), detector.NumChannels(), detector.BitsPerSample());
+					const size_t chunk_frames = std::max<size_t>(1, detector.SampleRate() * options.chunk_ms / 1000);
+					size_t len = 0;
+					while (auto chunk = reader.NextChunk(chunk_frames, &len)) {
+						auto res = detector.RunDetection(chunk, len * detector.NumChannels(), reader.Position() == reader.NumFrames());
+						if (res > 0) {
+							auto frame = detector.GetLastDetectionFrameId();
+							out << file << '\t' << res << '\t' << frame << '\t' << frame * 0.01 << '\t' << detector.GetLastDetectionScore() << '\n';
+						}
+					}
+					for (auto sensitivity : options.sweep_values) {
+						// The same sensitivity for every hotword of the models
+						std::string sensitivities = std::to_string(sensitivity);
+						for (int i = 1; i < detector.NumHotwords(); i++)
+							sensitivities += "," + std::to_string(sensitivity);
+						for (auto& e : detector.EvaluateScoreTrace(sensitivities)) {
+							out << file << '\t' << e.hotword << '\t' << e.frame_id << '\t' << e.frame_id * 0.01 << '\t' << e.score << '\t'
+								<< sensitivity << '\n';
+						}
+					}
+					total_audio_ms += reader.NumFrames() * 1000 / reader.Header().dwSamplesPerSec;
+				} catch (const std::exception& e) {
+					std::cerr << "Failed to score \"" << file << "\": " << e.what() << std::endl;
+					failed++;
+				}
+				results[f] = out.str();
+			}
+		},
+		options.threads);
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::ofstream file_out;
+	if (!options.output.empty() && options.output != "-") file_out.open(options.output);
+	std::ostream& out = file_out.is_open() ? file_out : std::cout;
+	out << "file\thotword\tframe\ttime\tscore" << (options.sweep_values.empty() ? "\n" : "\tsensitivity\n");
+	for (auto& e : results)
+		out << e;
+
+	auto audio_seconds = total_audio_ms / 1000.0;
+	fprintf(stderr, "scored %zu files (%zu failed), %.1f s of audio in %.2f s on %zu threads, real time factor %.4f (%.1fx real time)\n",
+			options.files.size(), failed.load(), audio_seconds, seconds, static_cast<size_t>(options.threads), seconds / audio_seconds,
+			audio_seconds / seconds);
+	return failed == 0 ? 0 : 1;
+}
+
+bool parse_args(int argc, const char** argv, score_options& options) {
+	options.resource = root + "resources/common.res";
+	option_parser parser;
+	parser.option("--resource", &options.resource).set_shortname("-r").set_description("Resource file (default resources/common.res)");
+	parser.option("--models", &options.models).set_shortname("-m").set_required(true).set_description("Hotword models, separated by comma");
+	parser.option("--sensitivity", &options.sensitivity).set_shortname("-s").set_description("Sensitivities, separated by comma");
+	parser.option("--high-sensitivity", &options.high_sensitivity).set_description("High sensitivities, separated by comma");
+	parser.option("--output", &options.output).set_shortname("-o").set_description("Output file for the detections (default stdout)");
+	parser.option("--list", &options.list).set_shortname("-l").set_description("File with one wave file per line to score");
+	parser.option("--threads", &options.threads).set_min(0).set_shortname("-j").set_description("Number of worker threads (default: one per core)");
+	parser.option("--chunk-ms", &options.chunk_ms).set_min(10).set_description("Milliseconds of audio passed to each RunDetection call (default 1000)");
+	parser.option("--sweep", &options.sweep).set_description("Score each file once and report the detections for the sensitivities from:to:step");
+	parser.option("--sweep-rerun-ms", &options.sweep_rerun_ms).set_min(0).set_description("Milliseconds of audio a sweep runs again after a detection before it may reuse the scores of the whole file, 0 for exact results (default 2000)");
+	parser.option("--frontend", &options.frontend).set_description("Apply the audio frontend (NS & AGC)");
+	bool print_help = false;
+	parser.option("--help", &print_help).set_shortname("-h").set_description("Print help");
+	try {
+		options.files = parser.parse(argc - 1, argv + 1);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return false;
+	}
+	if (print_help) {
+		parser.print_help(std::cout);
+		options.models.clear();
+		return true;
+	}
+	if (!options.list.empty()) {
+		std::ifstream list{options.list};
+		if (!list) {
+			std::cerr << "Failed to open file list \"" << options.list << "\"" << std::endl;
+			return false;
+		}
+		for (std::string line; std::getline(list, line);) {
+			trim(line);
+			if (!line.empty()) options.files.push_back(line);
+		}
+	}
+	if (options.models.empty() || options.files.empty()) {
+		std::cerr << "Missing required argument" << std::endl;
+		return false;
+	}
+	if (!options.sweep.empty()) {
+		auto parts = split(options.sweep, ":");
+		float from = 0, to = 0, step = 0;
+		if (parts.size() != 3 || !(std::istringstream{parts[0]} >> from) || !(std::istringstream{parts[1]} >> to)
+			|| !(std::istringstream{parts[2]} >> step) || step <= 0 || to < from) {
+			std::cerr << "Invalid sweep \"" << options.sweep << "\", expected from:to:step" << std::endl;
+			return false;
+		}
+		// Computed from the index so the values do not drift with the step
+		for (size_t i = 0; from + i * step <= to + step * 1e-3f; i++)
+			options.sweep_values.push_back(from + i * step);
+	}
+	if (options.threads == 0) options.threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+	return true;
+}
@@ -1,58 +1,120 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <agc.h>
+#include <frontend-lib.h>
 
 extern "C"
 {
-	// not sure if those are correct
+	// Digital AGC: a peak envelope per millisecond picks a gain from a compressor curve, which is then
+	// smoothed (fast attack, slow release) and interpolated over the samples.
 	struct TAgc_config {
-		short level;
-		short power;
+		short level; // target level in dB below full scale
+		short power; // maximum gain in dB
 	};
+
+	// The envelope energy is looked up by log2 in Q3, 0.375 dB steps
+	static const int kAgcTableSize = 256;
+	// Gains are applied in Q12, so the maximum gain is just below 18 dB
+	static const int kAgcMaxPower = 18;
+	// Below this level nothing is amplified, so silence does not get pumped up to the target
+	static const double kAgcNoiseGateDbfs = -70.0;
+
 	struct TAgc_Instance {
-		unsigned char unknown1[8];
-		short unknown2;
-		unsigned char unknown3[0x28e];
+		int sample_rate;
+		int block_size;
+		int subframe;
+		TAgc_config config;
+		int32_t gain_table[kAgcTableSize]; // Q16
+		uint32_t envelope;
+		int32_t gain; // Q16
+		int16_t gains[480];
 	};
-	//static_assert(sizeof(TAgc_Instance) == 0x298);
-	// TODO: Can we just copy the WebRtc implementation ?
-	// https://chromium.googlesource.com/external/webrtc/+/refs/heads/master/modules/audio_processing/agc/legacy/gain_control.h
-	extern void TAgc_Create(TAgc_Instance** ptr);
-	extern void TAgc_Init_org(TAgc_Instance* instance, uint64_t, uint64_t, int, int sample_rate);
-	extern void TAgc_Free(TAgc_Instance* instance);
-	extern int TAgc_set_config(TAgc_Instance* instance, TAgc_config cfg);
-	extern int TAgc_AddMic(TAgc_Instance* instance, long, long, short);
-	extern int TAgc_VirtualMic(TAgc_Instance* instance, long, long, short, int, int*);
-	extern int TAgc_Process(TAgc_Instance*, long, long, short, long, long, long, long*, long, long*);
 
-	int agc_targetlevel = 4;
-	int agc_targetpower = 5;
+	static void TAgc_Create(TAgc_Instance** ptr) {
+		*ptr = static_cast<TAgc_Instance*>(calloc(1, sizeof(TAgc_Instance)));
+	}
+
+	static void TAgc_Free(TAgc_Instance* instance) {
+		free(instance);
+	}
+
+	static int TAgc_set_config(TAgc_Instance* instance, TAgc_config cfg) {
+		if (cfg.level < 0 || cfg.level > 31 || cfg.power < 0 || cfg.power > kAgcMaxPower) return -1;
+		instance->config = cfg;
+		for (int i = 0; i < kAgcTableSize; i++) {
+			// Energy of a full scale sample is 2^30
+			double level = 10.0 * log10(2.0) * ((i + 0.5) / 8.0 - 30.0);
+			double gain = std::min<double>(cfg.power, -cfg.level - level);
+			if (gain > 0 && level < kAgcNoiseGateDbfs + 10) gain *= std::max(0.0, (level - kAgcNoiseGateDbfs) / 10.0);
+			instance->gain_table[i] = static_cast<int32_t>(lround(65536.0 * pow(10.0, gain / 20.0)));
+		}
+		return 0;
+	}
+
+	static int TAgc_Init(TAgc_Instance* instance, int sample_rate, int block_size) {
+		instance->sample_rate = sample_rate;
+		instance->block_size = block_size;
+		instance->subframe = sample_rate / 1000;
+		instance->envelope = 0;
+		instance->gain = 65536;
+		TAgc_config cfg;
+		cfg.level = 3;
+		cfg.power = 9;
+		return TAgc_set_config(instance, cfg);
+	}
+
+	static int TAgc_LevelIndex(uint32_t energy) {
+		if (energy == 0) return 0;
+		int zeros = TSpl_NormU32(energy);
+		return (31 - zeros) * 8 + static_cast<int>(((energy << zeros) >> 28) & 7);
+	}
+
+	static void TAgc_Process(TAgc_Instance* instance, const int16_t* in, int16_t* out) {
+		const int len = instance->subframe;
+		for (int j = 0; j < instance->block_size / len; j++) {
+			uint32_t peak = TSpl_MaxAbsValueW16(in + j * len, len);
+			uint32_t energy = peak * peak;
+			if (energy > instance->envelope)
+				instance->envelope = energy;
+			else
+				instance->envelope -= (instance->envelope - energy) >> 4;
+			int32_t target = instance->gain_table[TAgc_LevelIndex(instance->envelope)];
+			int32_t previous = instance->gain;
+			if (target < instance->gain)
+				instance->gain = target;
+			else
+				instance->gain += (target - instance->gain) >> 7;
+			for (int i = 0; i < len; i++) {
+				int32_t g = (previous + static_cast<int32_t>((static_cast<int64_t>(instance->gain - previous) * (i + 1)) / len)) >> 4;
+				instance->gains[j * len + i] = static_cast<int16_t>(std::min<int32_t>(g, 32767));
+			}
+		}
+		TSpl_ScaleVectorW16(in, instance->gains, out, instance->block_size, 12);
+	}
 
 	struct AGC_Instance {
 		TAgc_Instance* m_tagc_instance;
-		short unknown1;
-		uint32_t unknown2;
-		uint32_t unknown3;
-		// 4 more bytes, probably padding
+		short m_block_size;
 	};
-	//static_assert(sizeof(AGC_Instance) == 0x18);
 
-	AGC_Instance* AGC_Init(int sample_rate /* probably */, int param_2, short param_3, int* param_4 /* status? */) {
+	AGC_Instance* AGC_Init(int sample_rate, int block_size, short, int* status) {
 		if ((sample_rate == 8000 || sample_rate == 16000 || sample_rate == 32000 || sample_rate == 48000)
-			&& (param_2 == 0x50 || param_2 == 0xa0 || param_2 == 0x140 || param_2 == 0x1e0)) {
+			&& block_size == sample_rate / 100) {
 			auto res = new AGC_Instance{};
 			TAgc_Create(&res->m_tagc_instance);
-			TAgc_Init_org(res->m_tagc_instance, 0, 0xff, param_3 + 1, sample_rate);
-			if (sample_rate == 32000 || sample_rate == 48000)
-				res->unknown1 = 0xa0;
-			else
-				res->unknown1 = param_2;
-			*param_4 = 1;
-			res->unknown2 = 0;
-			res->unknown3 = 0;
+			if (res->m_tagc_instance == nullptr || TAgc_Init(res->m_tagc_instance, sample_rate, block_size) != 0) {
+				AGC_Exit(res);
+				*status = 3;
+				return nullptr;
+			}
+			res->m_block_size = block_size;
+			*status = 1;
 			return res;
 		}
-		*param_4 = 4;
+		*status = 4;
 		return nullptr;
 	}
 
@@ -62,37 +124,19 @@ extern "C"
 		return 1;
 	}
 
-	int AGC_Process(AGC_Instance* instance, long param_2, long param_3, long param_4, long param_5, int param_6) {
-		instance->m_tagc_instance->unknown2 = param_6 + 1;
-		if (param_6 == 0) {
-			TAgc_AddMic(instance->m_tagc_instance, param_2, param_3, instance->unknown1);
-			long a = 0, b = 0;
-			TAgc_Process(instance->m_tagc_instance, param_2, param_3, instance->unknown1, param_4, param_5, 0, &a, 0, &b);
-			instance->unknown3 = b;
-			instance->unknown2 = a;
-		} else {
-			int a = 0;
-			if (param_6 == 1) {
-				TAgc_VirtualMic(instance->m_tagc_instance, param_2, param_3, instance->unknown1, instance->unknown2, &a);
-			}
-			long b = 0, c = 0;
-			TAgc_Process(instance->m_tagc_instance, param_2, param_3, instance->unknown1, param_4, param_5, a, &b, 0, &c);
-			instance->unknown3 = c;
-		}
+	int AGC_Process(AGC_Instance* instance, const short* in, short* out) {
+		if (instance == nullptr) return 2;
+		TAgc_Process(instance->m_tagc_instance, in, out);
 		return 1;
 	}
 
 	int AGC_SetPara(AGC_Instance* instance, const char* property, const char* value) {
 		if (instance == nullptr) return 2;
-		TAgc_config cfg;
-		cfg.level = agc_targetlevel;
-		cfg.power = agc_targetpower;
+		TAgc_config cfg = instance->m_tagc_instance->config;
 		if (strcmp(property, "AGC_Level") == 0) {
-			auto val = strtol(value, nullptr, 10);
-			cfg.level = agc_targetlevel = val;
+			cfg.level = strtol(value, nullptr, 10);
 		} else if (strcmp(property, "AGC_Power") == 0) {
-			auto val = strtol(value, nullptr, 10);
-			cfg.power = agc_targetpower = val;
+			cfg.power = strtol(value, nullptr, 10);
 		} else
 			return 4;
 		auto res = TAgc_set_config(instance->m_tagc_instance, cfg);
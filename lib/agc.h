@@ -3,8 +3,10 @@
 extern "C"
 {
 	struct AGC_Instance;
-	AGC_Instance* AGC_Init(int sample_rate /* probably */, int param_2, short param_3, int* param_4 /* status? */);
+	// Returns nullptr and sets `status` to something other than 1 for unsupported rates, `block_size` has to be 10 ms
+	AGC_Instance* AGC_Init(int sample_rate, int block_size, short mode, int* status);
 	int AGC_Exit(AGC_Instance* instance);
-	int AGC_Process(AGC_Instance* instance);
+	// Applies the gain to one block, `in` and `out` may be the same
+	int AGC_Process(AGC_Instance* instance, const short* in, short* out);
 	int AGC_SetPara(AGC_Instance* instance, const char* property, const char* value);
-}
\ No newline at end of file
+}
@@ -1,9 +1,128 @@
 #include <audio-lib.h>
+#include <frontend-lib.h>
 #include <matrix-wrapper.h>
 #include <snowboy-error.h>
 #include <wave-header.h>
+#ifdef TSPL_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace snowboy {
+	namespace {
+		// Any channel count, starting at frame `first`. One row at a time, so the writes stay sequential.
+		template <typename T>
+		void DeinterleaveRows(const T* data, size_t channels, size_t frames, float scale, size_t first, Matrix* out) {
+			for (size_t r = 0; r < channels; r++) {
+				auto row = out->m_data + r * out->m_stride;
+				for (size_t c = first; c < frames; c++)
+					row[c] = static_cast<float>(data[c * channels + r]) * scale;
+			}
+		}
+
+		template <typename T>
+		size_t DeinterleaveVector(const T*, size_t, size_t, float, Matrix*) {
+			return 0;
+		}
+
+#ifdef TSPL_HAVE_SSE2
+		// The vector loops return the number of frames they converted, the rest is left to DeinterleaveRows()
+		template <>
+		size_t DeinterleaveVector(const int16_t* data, size_t channels, size_t frames, float scale, Matrix* out) {
+			const __m128 vscale = _mm_set1_ps(scale);
+			auto row0 = out->m_data;
+			auto row1 = out->m_data + out->m_stride;
+			size_t c = 0;
+			if (channels == 1) {
+				for (; c + 8 <= frames; c += 8) {
+					const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + c));
+					const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+					const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+					_mm_storeu_ps(row0 + c, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+					_mm_storeu_ps(row0 + c + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+				}
+			} else if (channels == 2) {
+				// Each 32 bit lane holds one frame, left in the low half
+				for (; c + 4 <= frames; c += 4) {
+					const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2 * c));
+					const __m128i left = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+					const __m128i right = _mm_srai_epi32(x, 16);
+					_mm_storeu_ps(row0 + c, _mm_mul_ps(_mm_cvtepi32_ps(left), vscale));
+					_mm_storeu_ps(row1 + c, _mm_mul_ps(_mm_cvtepi32_ps(right), vscale));
+				}
+			}
+			return c;
+		}
+
+		template <>
+		size_t DeinterleaveVector(const int32_t* data, size_t channels, size_t frames, float scale, Matrix* out) {
+			const __m128 vscale = _mm_set1_ps(scale);
+			auto row0 = out->m_data;
+			auto row1 = out->m_data + out->m_stride;
+			size_t c = 0;
+			if (channels == 1) {
+				for (; c + 4 <= frames; c += 4) {
+					const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + c));
+					_mm_storeu_ps(row0 + c, _mm_mul_ps(_mm_cvtepi32_ps(x), vscale));
+				}
+			} else if (channels == 2) {
+				for (; c + 4 <= frames; c += 4) {
+					const __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2 * c)));
+					const __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 2 * c + 4)));
+					const __m128i left = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+					const __m128i right = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+					_mm_storeu_ps(row0 + c, _mm_mul_ps(_mm_cvtepi32_ps(left), vscale));
+					_mm_storeu_ps(row1 + c, _mm_mul_ps(_mm_cvtepi32_ps(right), vscale));
+				}
+			}
+			return c;
+		}
+
+		template <>
+		size_t DeinterleaveVector(const float* data, size_t channels, size_t frames, float scale, Matrix* out) {
+			const __m128 vscale = _mm_set1_ps(scale);
+			auto row0 = out->m_data;
+			auto row1 = out->m_data + out->m_stride;
+			size_t c = 0;
+			if (channels == 1) {
+				for (; c + 4 <= frames; c += 4)
+					_mm_storeu_ps(row0 + c, _mm_mul_ps(_mm_loadu_ps(data + c), vscale));
+			} else if (channels == 2) {
+				for (; c + 4 <= frames; c += 4) {
+					const __m128 a = _mm_loadu_ps(data + 2 * c);
+					const __m128 b = _mm_loadu_ps(data + 2 * c + 4);
+					_mm_storeu_ps(row0 + c, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), vscale));
+					_mm_storeu_ps(row1 + c, _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)), vscale));
+				}
+			}
+			return c;
+		}
+#endif
+
+		template <typename T>
+		void Deinterleave(const T* data, size_t channels, size_t frames, float scale, Matrix* out) {
+			out->Resize(channels, frames, MatrixResizeType::kUndefined);
+			if (channels == 0 || frames == 0) return;
+			auto first = DeinterleaveVector(data, channels, frames, scale, out);
+			DeinterleaveRows(data, channels, frames, scale, first, out);
+		}
+	} // namespace
+
+	void DeinterleaveSamples(const int8_t* data, size_t channels, size_t frames, Matrix* data_out) {
+		Deinterleave(data, channels, frames, 1.0f, data_out);
+	}
+
+	void DeinterleaveSamples(const int16_t* data, size_t channels, size_t frames, Matrix* data_out) {
+		Deinterleave(data, channels, frames, 1.0f, data_out);
+	}
+
+	void DeinterleaveSamples(const int32_t* data, size_t channels, size_t frames, Matrix* data_out) {
+		Deinterleave(data, channels, frames, 1.0f, data_out);
+	}
+
+	void DeinterleaveSamples(const float* data, size_t channels, size_t frames, float scale, Matrix* data_out) {
+		Deinterleave(data, channels, frames, scale, data_out);
+	}
+
 	float GetMaxWaveAmplitude(const WaveHeader& hdr) {
 #ifndef NDEBUG
 		if (hdr.wBitsPerSample != 8 && hdr.wBitsPerSample != 16 && hdr.wBitsPerSample != 32)
@@ -21,33 +140,14 @@ namespace snowboy {
 	}
 
 	void ReadRawWaveFromString(const WaveHeader& hdr, const std::string& data, Matrix* data_out) {
-		// Note: Not 100% sure about this stuff...
-		data_out->Resize(hdr.wChannels, data.size() / hdr.wBlockAlign);
-		if (hdr.wBitsPerSample == 8) {
-			auto dptr = reinterpret_cast<int8_t*>(const_cast<char*>(data.data()));
-			for (size_t c = 0; c < data_out->m_cols; c++) {
-				for (size_t r = 0; r < data_out->m_rows; r++) {
-					data_out->m_data[r * data_out->m_stride + c] = *dptr;
-					dptr++;
-				}
-			}
-		} else if (hdr.wBitsPerSample == 16) {
-			auto dptr = reinterpret_cast<int16_t*>(const_cast<char*>(data.data()));
-			for (size_t c = 0; c < data_out->m_cols; c++) {
-				for (size_t r = 0; r < data_out->m_rows; r++) {
-					data_out->m_data[r * data_out->m_stride + c] = *dptr;
-					dptr++;
-				}
-			}
-		} else if (hdr.wBitsPerSample == 32) {
-			auto dptr = reinterpret_cast<int32_t*>(const_cast<char*>(data.data()));
-			for (size_t c = 0; c < data_out->m_cols; c++) {
-				for (size_t r = 0; r < data_out->m_rows; r++) {
-					data_out->m_data[r * data_out->m_stride + c] = *dptr;
-					dptr++;
-				}
-			}
-		} else
+		const size_t frames = data.size() / hdr.wBlockAlign;
+		if (hdr.wBitsPerSample == 8)
+			DeinterleaveSamples(reinterpret_cast<const int8_t*>(data.data()), hdr.wChannels, frames, data_out);
+		else if (hdr.wBitsPerSample == 16)
+			DeinterleaveSamples(reinterpret_cast<const int16_t*>(data.data()), hdr.wChannels, frames, data_out);
+		else if (hdr.wBitsPerSample == 32)
+			DeinterleaveSamples(reinterpret_cast<const int32_t*>(data.data()), hdr.wChannels, frames, data_out);
+		else
 			throw snowboy_exception{"Undefined bits_per_sample: " + std::to_string(hdr.wBitsPerSample) + ", expecting 8,16 or 32."};
 	}
 
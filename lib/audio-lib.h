@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace snowboy {
@@ -7,6 +9,13 @@ namespace snowboy {
 	struct MatrixBase;
 	float GetMaxWaveAmplitude(const WaveHeader& hdr);
 	float GetMaxWaveAmplitude(int nbits);
+	// Splits `frames` frames of `channels` interleaved samples into one row per channel. `data_out` is resized without
+	// clearing, so a matrix reused across calls only allocates when the chunks grow.
+	void DeinterleaveSamples(const int8_t* data, size_t channels, size_t frames, Matrix* data_out);
+	void DeinterleaveSamples(const int16_t* data, size_t channels, size_t frames, Matrix* data_out);
+	void DeinterleaveSamples(const int32_t* data, size_t channels, size_t frames, Matrix* data_out);
+	// Same for float samples, which are multiplied by `scale` on the way
+	void DeinterleaveSamples(const float* data, size_t channels, size_t frames, float scale, Matrix* data_out);
 	void ReadRawWaveFromString(const WaveHeader& hdr, const std::string& data, Matrix* data_out);
 	void WriteRawWaveToString(const WaveHeader& hdr, const MatrixBase& data, std::string* data_out);
 } // namespace snowboy
\ No newline at end of file
@@ -0,0 +1,165 @@
+extern "C"
+{
+#include <cblas.h>
+}
+#include <algorithm>
+#include <channel-mix-stream.h>
+#include <cmath>
+#include <cstring>
+#include <frame-info.h>
+#include <matrix-wrapper.h>
+#include <snowboy-error.h>
+#include <snowboy-options.h>
+
+namespace snowboy {
+	void ChannelMixStreamOptions::Register(const std::string& prefix, OptionsItf* opts) {
+		opts->Register(prefix, "sample-rate", "Sampling rate.", &sample_rate);
+		opts->Register(prefix, "method", "How channels are combined, candidates are: beamform|select|first.", &method);
+		opts->Register(prefix, "max-delay-ms", "Largest delay between two microphones in milliseconds.", &max_delay_ms);
+		opts->Register(prefix, "decay", "Decay per read of the correlations and energies the channels are weighed by.", &decay);
+	}
+
+	ChannelMixStream::ChannelMixStream(const ChannelMixStreamOptions& options)
+		: m_options{options} {
+		if (m_options.method == "beamform")
+			m_method = Method::kBeamform;
+		else if (m_options.method == "select")
+			m_method = Method::kSelect;
+		else if (m_options.method == "first")
+			m_method = Method::kFirst;
+		else
+			throw snowboy_exception{"Channel mix method " + m_options.method + " is not defined"};
+		if (m_options.sample_rate <= 0 || m_options.max_delay_ms < 0.0f)
+			throw snowboy_exception{"invalid channel mix options"};
+		m_max_delay = static_cast<int64_t>(std::lround(m_options.max_delay_ms * m_options.sample_rate / 1000.0f));
+		Reset();
+	}
+
+	int ChannelMixStream::Read(Matrix* mat, std::vector<FrameInfo>* info) {
+		auto sig = m_connectedStream->Read(mat, info);
+		if ((sig & 0xc2) != 0) return sig;
+		if (mat->m_cols == 0) {
+			// An empty end read still passes on the samples the beamformer holds back
+			if ((sig & 0x18) != 0 && m_buffers.size() > 1) {
+				if (m_method == Method::kBeamform) {
+					Beamform(Matrix{}, true, mat);
+					info->resize(std::min<size_t>(info->size(), mat->m_rows));
+				}
+				Reset();
+			}
+			return sig;
+		}
+		if (mat->m_rows <= 1) return sig;
+
+		Matrix in{std::move(*mat)};
+		if (m_buffers.size() != in.m_rows) {
+			m_buffers.resize(in.m_rows);
+			Reset();
+		}
+		switch (m_method) {
+		case Method::kBeamform: Beamform(in, (sig & 0x18) != 0, mat); break;
+		case Method::kSelect: Select(in, mat); break;
+		case Method::kFirst:
+			mat->Resize(1, in.m_cols, MatrixResizeType::kUndefined);
+			memcpy(mat->m_data, in.m_data, in.m_cols * sizeof(float));
+			break;
+		}
+		info->resize(std::min<size_t>(info->size(), mat->m_rows));
+		if ((sig & 0x18) != 0) Reset();
+		return sig;
+	}
+
+	void ChannelMixStream::Beamform(const Matrix& in, bool flush, Matrix* out) {
+		const size_t channels = m_buffers.size();
+		for (size_t r = 0; r < channels; r++) {
+			if (in.m_cols != 0) {
+				auto row = in.m_data + r * in.m_stride;
+				m_buffers[r].insert(m_buffers[r].end(), row, row + in.m_cols);
+			}
+			// Past the end the channels are silent
+			if (flush) m_buffers[r].resize(m_buffers[r].size() + m_max_delay, 0.0f);
+		}
+		m_input_count += in.m_cols;
+
+		const auto end = flush ? m_input_count : m_input_count - m_max_delay;
+		const auto num = static_cast<int>(std::max<int64_t>(end - m_output_count, 0));
+		if (num == 0) {
+			out->Resize(0, 0);
+			return;
+		}
+		const auto offset = m_output_count - m_buffer_start;
+		const float* ref = m_buffers[0].data() + offset;
+		const size_t lags = 2 * m_max_delay + 1;
+		for (size_t c = 1; c < channels; c++) {
+			const float* x = m_buffers[c].data() + offset;
+			auto corr = m_correlation.data() + c * lags;
+			size_t best = m_max_delay;
+			for (size_t l = 0; l < lags; l++) {
+				corr[l] = m_options.decay * corr[l] + cblas_sdot(num, ref, 1, x + l - m_max_delay, 1);
+				if (corr[l] > corr[best]) best = l;
+			}
+			m_lags[c] = static_cast<int64_t>(best) - m_max_delay;
+		}
+
+		out->Resize(1, num, MatrixResizeType::kUndefined);
+		memcpy(out->m_data, ref, num * sizeof(float));
+		for (size_t c = 1; c < channels; c++)
+			cblas_saxpy(num, 1.0f, m_buffers[c].data() + offset + m_lags[c], 1, out->m_data, 1);
+		cblas_sscal(num, 1.0f / channels, out->m_data, 1);
+		m_output_count += num;
+
+		// The next output reads back to m_max_delay samples before it
+		const auto consumed = m_output_count - m_max_delay - m_buffer_start;
+		if (consumed > 0) {
+			for (auto& e : m_buffers)
+				e.erase(e.begin(), e.begin() + consumed);
+			m_buffer_start += consumed;
+		}
+	}
+
+	void ChannelMixStream::Select(const Matrix& in, Matrix* out) {
+		const size_t channels = in.m_rows;
+		const int num = in.m_cols;
+		size_t best = 0;
+		for (size_t c = 0; c < channels; c++) {
+			auto row = in.m_data + c * in.m_stride;
+			m_energy[c] = m_options.decay * m_energy[c] + cblas_sdot(num, row, 1, row, 1);
+			if (m_energy[c] > m_energy[best]) best = c;
+		}
+		const auto previous = m_selected;
+		// Only switch to a clearly louder channel, so similar channels do not flip back and forth
+		if (m_energy[best] > 1.4 * m_energy[previous]) m_selected = best;
+
+		out->Resize(1, num, MatrixResizeType::kUndefined);
+		memcpy(out->m_data, in.m_data + m_selected * in.m_stride, num * sizeof(float));
+		if (m_selected != previous) {
+			// Fade over 10 ms instead of jumping between the signals
+			const auto old_row = in.m_data + previous * in.m_stride;
+			const int fade = std::min(num, std::max(m_options.sample_rate / 100, 1));
+			for (int i = 0; i < fade; i++) {
+				const float a = static_cast<float>(i + 1) / (fade + 1);
+				out->m_data[i] = a * out->m_data[i] + (1.0f - a) * old_row[i];
+			}
+		}
+	}
+
+	bool ChannelMixStream::Reset() {
+		const auto channels = m_buffers.size();
+		m_buffer_start = -m_max_delay;
+		m_input_count = 0;
+		m_output_count = 0;
+		for (auto& e : m_buffers)
+			e.assign(m_max_delay, 0.0f);
+		m_correlation.assign(channels * (2 * m_max_delay + 1), 0.0);
+		m_lags.assign(channels, 0);
+		m_energy.assign(channels, 0.0);
+		m_selected = 0;
+		return true;
+	}
+
+	std::string ChannelMixStream::Name() const {
+		return "ChannelMixStream";
+	}
+
+	ChannelMixStream::~ChannelMixStream() {}
+} // namespace snowboy
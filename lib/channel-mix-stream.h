@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <stream-itf.h>
+#include <vector>
+
+namespace snowboy {
+	struct OptionsItf;
+	struct ChannelMixStreamOptions {
+		int sample_rate = 16000;
+		std::string method = "beamform";
+		float max_delay_ms = 1.0f;
+		float decay = 0.9f;
+		void Register(const std::string&, OptionsItf*);
+	};
+	// Combines the rows of multi-channel audio into one, single channel audio passes unchanged. "beamform" delays every
+	// channel onto the first one by the lag maximizing their cross correlation and averages them, "select" passes the
+	// loudest channel and "first" only the first channel.
+	class ChannelMixStream : public StreamItf {
+		enum class Method { kBeamform, kSelect, kFirst };
+		ChannelMixStreamOptions m_options;
+		Method m_method;
+		int64_t m_max_delay;
+
+		// Beamforming: samples of every channel from index m_buffer_start on, m_max_delay zeros pad the start. The
+		// output lags the input by m_max_delay samples.
+		std::vector<std::vector<float>> m_buffers;
+		int64_t m_buffer_start;
+		int64_t m_input_count;
+		int64_t m_output_count;
+		// Decaying cross correlation with the first channel for every lag, 2 * m_max_delay + 1 per channel
+		std::vector<double> m_correlation;
+		std::vector<int64_t> m_lags;
+
+		// Selection: decaying energy of every channel and the channel passed on
+		std::vector<double> m_energy;
+		size_t m_selected;
+
+		void Beamform(const Matrix& in, bool flush, Matrix* out);
+		void Select(const Matrix& in, Matrix* out);
+
+	public:
+		ChannelMixStream(const ChannelMixStreamOptions& options);
+		virtual int Read(Matrix* mat, std::vector<FrameInfo>* info) override;
+		virtual bool Reset() override;
+		virtual std::string Name() const override;
+		virtual ~ChannelMixStream();
+
+		// Lag of every channel against the first one in samples, as used for the last output
+		const std::vector<int64_t>& Lags() const { return m_lags; }
+		size_t SelectedChannel() const { return m_selected; }
+	};
+} // namespace snowboy
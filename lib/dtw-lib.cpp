@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <dtw-lib.h>
 #include <limits>
@@ -163,48 +164,95 @@ namespace snowboy {
 
 	SlidingDtw::~SlidingDtw() {}
 
-	float DtwAlign(DistanceType param_1, const MatrixBase& param_2, const MatrixBase& param_3, std::vector<std::vector<size_t>>* param_4) {
+	float DtwAlign(DistanceType param_1, const MatrixBase& param_2, const MatrixBase& param_3, std::vector<std::vector<size_t>>* param_4, int band_width) {
 		if (param_4 != nullptr) param_4->resize(param_2.rows());
 		if (param_2.rows() == 0 || param_3.rows() == 0) {
 			return std::numeric_limits<float>::max();
 		}
+		if (param_1 != DistanceType::cosine && param_1 != DistanceType::euclidean)
+			throw snowboy_exception{"Unknown distance type: " + std::to_string(param_1)};
 
 		SNOWBOY_ASSERT(!param_2.HasNan() && !param_2.HasInfinity());
 		SNOWBOY_ASSERT(!param_3.HasNan() && !param_3.HasInfinity());
 
-		Matrix distances;
-		distances.Resize(param_2.rows(), param_3.rows());
-		for (size_t row = 0; row < distances.rows(); row++) {
-			for (size_t col = 0; col < distances.cols(); col++) {
-				if (param_1 == DistanceType::cosine) {
-					distances(row, col) = SubVector{param_2, row}.CosineDistance(SubVector{param_3, col});
-				} else if (param_1 == DistanceType::euclidean) {
-					distances(row, col) = SubVector{param_2, row}.EuclideanDistance(SubVector{param_3, col});
-				} else
-					throw snowboy_exception{"Unknown distance type: " + std::to_string(param_1)};
+		const auto rows = param_2.rows(), cols = param_3.rows();
+		// Columns [band_begin[row], band_end[row]) are searched, cells outside the band have a cost of FLT_MAX
+		std::vector<size_t> band_begin(rows, 0), band_end(rows, cols);
+		if (band_width >= 0 && rows > 1) {
+			auto last_row = rows - 1, last_col = cols - 1;
+			// The center moves by up to ceil(slope) columns per row, a narrower band would leave gaps
+			auto max_step = (last_col + last_row - 1) / last_row;
+			auto width = std::max<size_t>(band_width, max_step / 2);
+			for (size_t row = 0; row < rows; row++) {
+				auto center = row * last_col / last_row;
+				band_begin[row] = center > width ? center - width : 0;
+				band_end[row] = std::min(center + width + 1, cols);
 			}
 		}
-		SNOWBOY_ASSERT(!distances.HasNan() && !distances.HasInfinity());
-		Matrix local_1d8;
-		local_1d8.Resize(param_2.rows(), param_3.rows());
-		for (size_t row = 0; row < local_1d8.rows(); row++) {
-			for (size_t col = 0; col < local_1d8.cols(); col++) {
+
+		// Only two rows of the cost matrix are kept. For the traceback each searched cell stores the
+		// predecessor the original full matrix traceback would have picked, one byte per cell.
+		enum : uint8_t { kDiagonal,
+						 kLeft,
+						 kUp };
+		std::vector<size_t> step_offset;
+		std::vector<uint8_t> steps;
+		if (param_4 != nullptr) {
+			step_offset.resize(rows + 1, 0);
+			for (size_t row = 0; row < rows; row++)
+				step_offset[row + 1] = step_offset[row] + band_end[row] - band_begin[row];
+			steps.resize(step_offset.back());
+		}
+		std::vector<float> cost(cols, std::numeric_limits<float>::max()), prev_cost(cols, std::numeric_limits<float>::max());
+		for (size_t row = 0; row < rows; row++) {
+			std::swap(cost, prev_cost);
+			if (row >= 2) std::fill(cost.begin() + band_begin[row - 2], cost.begin() + band_end[row - 2], std::numeric_limits<float>::max());
+			SubVector feat{param_2, row};
+			for (size_t col = band_begin[row]; col < band_end[row]; col++) {
+				float distance;
+				if (param_1 == DistanceType::cosine) {
+					distance = feat.CosineDistance(SubVector{param_3, col});
+				} else {
+					distance = feat.EuclideanDistance(SubVector{param_3, col});
+				}
+				SNOWBOY_ASSERT(!std::isnan(distance) && !std::isinf(distance));
 				if (row == 0) {
-					local_1d8(0, col) = distances(0, col);
+					cost[col] = distance;
 				} else if (col == 0) {
-					local_1d8(row, 0) = distances(row, 0) + local_1d8(row - 1, 0);
+					cost[0] = distance + prev_cost[0];
+					if (param_4 != nullptr) steps[step_offset[row]] = kUp;
 				} else {
-					auto fVar16 = std::min(std::min(local_1d8(row, col - 1), local_1d8(row - 1, col)), local_1d8(row - 1, col - 1));
-					local_1d8(row, col) = fVar16 + distances(row, col);
+					auto fVar16 = std::min(std::min(cost[col - 1], prev_cost[col]), prev_cost[col - 1]);
+					cost[col] = fVar16 + distance;
+					if (param_4 != nullptr) {
+						// Same rounding and tie breaking as recovering the predecessor from the stored costs
+						auto fVar18 = cost[col] - distance;
+						auto pfVar8_0 = fabs(fVar18 - prev_cost[col - 1]);
+						auto pfVar8_1 = fabs(fVar18 - cost[col - 1]);
+						auto pfVar8_2 = fabs(fVar18 - prev_cost[col]);
+						uint8_t step;
+						if (pfVar8_0 <= pfVar8_1) {
+							step = pfVar8_2 >= pfVar8_0 ? kDiagonal : kUp;
+						} else {
+							step = pfVar8_2 < pfVar8_1 ? kUp : kLeft;
+						}
+						steps[step_offset[row] + col - band_begin[row]] = step;
+					}
 				}
+				SNOWBOY_ASSERT(!std::isnan(cost[col]) && !std::isinf(cost[col]));
 			}
 		}
-		SNOWBOY_ASSERT(!local_1d8.HasNan() && !local_1d8.HasInfinity());
 		int min_index = -1;
-		auto min_value = SubVector{local_1d8, local_1d8.rows() - 1}.Min(&min_index);
+		auto min_value = std::numeric_limits<float>::infinity();
+		for (size_t col = 0; col < cols; col++) {
+			if (cost[col] < min_value) {
+				min_index = col;
+				min_value = cost[col];
+			}
+		}
 		SNOWBOY_ASSERT(min_index >= 0);
 		if (param_4 != nullptr) {
-			for (size_t iVar11 = local_1d8.rows() - 1; iVar11 != 0;) {
+			for (size_t iVar11 = rows - 1; iVar11 != 0;) {
 				// TODO: This is wrong
 				// If I look at the code it should only be
 				// param_4->at(iVar11).push_back(min_index);
@@ -213,25 +261,13 @@ namespace snowboy {
 					param_4->at(iVar11).push_back(min_index);
 				else
 					param_4->at(iVar11).at(0) = min_index;
-				if (0 >= min_index) {
-					iVar11--;
-					continue;
-				}
-				auto fVar18 = local_1d8(iVar11, min_index) - distances(iVar11, min_index);
-				auto pfVar8_0 = fabs(fVar18 - local_1d8(iVar11 - 1, min_index - 1));
-				auto pfVar8_1 = fabs(fVar18 - local_1d8(iVar11, min_index - 1));
-				auto pfVar8_2 = fabs(fVar18 - local_1d8(iVar11 - 1, min_index));
-				if (pfVar8_0 <= pfVar8_1) {
-					if (pfVar8_2 >= pfVar8_0) {
-						min_index -= 1;
-					}
+				switch (steps[step_offset[iVar11] + min_index - band_begin[iVar11]]) {
+				case kDiagonal:
+					min_index -= 1;
 					iVar11--;
-				} else {
-					if (pfVar8_2 < pfVar8_1) {
-						iVar11--;
-					} else {
-						min_index -= 1;
-					}
+					break;
+				case kLeft: min_index -= 1; break;
+				default: iVar11--; break;
 				}
 			}
 			// TODO: This is wrong
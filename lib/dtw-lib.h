@@ -37,5 +37,7 @@ namespace snowboy {
 		virtual ~SlidingDtw();
 	};
 
-	float DtwAlign(DistanceType, const MatrixBase&, const MatrixBase&, std::vector<std::vector<size_t>>*);
+	// Subsequence DTW of the first matrix against the second. If band_width is not negative the search is
+	// limited to a Sakoe-Chiba band of that half width around the diagonal (widened to keep the band connected).
+	float DtwAlign(DistanceType, const MatrixBase&, const MatrixBase&, std::vector<std::vector<size_t>>*, int band_width = -1);
 } // namespace snowboy
@@ -0,0 +1,112 @@
+extern "C"
+{
+#include <cblas.h>
+}
+#include <algorithm>
+#include <cmath>
+#include <energy-gate-stream.h>
+#include <frame-info.h>
+#include <limits>
+#include <snowboy-error.h>
+#include <snowboy-options.h>
+
+namespace snowboy {
+	void EnergyGateStreamOptions::Register(const std::string& prefix, OptionsItf* opts) {
+		opts->Register(prefix, "threshold", "Frames with a log energy less than this above the background are silent.", &threshold);
+		opts->Register(prefix, "bg-window", "Number of frames the background log energy is the minimum of.", &bg_window);
+		opts->Register(prefix, "min-silence-frames", "Number of silent frames before frames are dropped.", &min_silence_frames);
+		opts->Register(prefix, "look-back-frames", "Number of dropped frames passed on in front of the first read with a frame that is not silent.",
+					   &look_back_frames);
+	}
+
+	EnergyGateStream::EnergyGateStream(const EnergyGateStreamOptions& options)
+		: m_options{options}, m_allow_skipping{false}, m_skipped_frames{0} {
+		if (m_options.bg_window == 0) throw snowboy_exception{"bg-window must be positive"};
+		Reset();
+	}
+
+	bool EnergyGateStream::IsSilent(const float* frame, size_t len) {
+		auto energy = cblas_sdot(len, frame, 1, frame, 1);
+		energy = logf(std::max(std::numeric_limits<float>::min(), energy));
+		// Sliding minimum: frames louder than a later one can never be the background again
+		while (!m_background.empty() && m_background.back().second >= energy)
+			m_background.pop_back();
+		m_background.emplace_back(m_frame_index, energy);
+		if (m_background.front().first + m_options.bg_window <= m_frame_index) m_background.pop_front();
+		m_frame_index++;
+		return energy - m_background.front().second < m_options.threshold;
+	}
+
+	int EnergyGateStream::Read(Matrix* mat, std::vector<FrameInfo>* info) {
+		if (m_replaying) return Replay(mat, info);
+		auto sig = m_connectedStream->Read(mat, info);
+		if ((sig & 0xc2) != 0) return sig;
+		if (mat->m_rows == 0) {
+			if ((sig & 0x18) != 0) Reset();
+			return sig;
+		}
+
+		bool speech = false;
+		for (size_t r = 0; r < mat->m_rows; r++) {
+			if (IsSilent(mat->m_data + r * mat->m_stride, mat->m_cols)) {
+				m_silent_frames++;
+			} else {
+				speech = true;
+				m_silent_frames = 0;
+			}
+		}
+		// Whole reads pass or are dropped, so the streams after the gate get the reads they get without it
+		if (m_open) {
+			if (m_allow_skipping && m_silent_frames >= m_options.min_silence_frames) m_open = false;
+		} else {
+			m_look_back.push_back({std::move(*mat), std::move(*info), sig});
+			m_look_back_frames += m_look_back.back().mat.m_rows;
+			if (speech) {
+				m_open = true;
+				m_replaying = true;
+				return Replay(mat, info);
+			}
+			// Keeps the fewest reads holding the last look_back_frames frames
+			while (!m_look_back.empty() && m_look_back_frames - m_look_back.front().mat.m_rows >= m_options.look_back_frames) {
+				m_look_back_frames -= m_look_back.front().mat.m_rows;
+				m_skipped_frames += m_look_back.front().mat.m_rows;
+				m_look_back.pop_front();
+			}
+			mat->Resize(0, 0);
+			info->clear();
+		}
+		if ((sig & 0x18) != 0) Reset();
+		return sig;
+	}
+
+	int EnergyGateStream::Replay(Matrix* mat, std::vector<FrameInfo>* info) {
+		auto& e = m_look_back.front();
+		mat->Swap(&e.mat);
+		info->swap(e.info);
+		const auto sig = e.signal;
+		m_look_back_frames -= mat->m_rows;
+		m_look_back.pop_front();
+		if (m_look_back.empty()) {
+			m_replaying = false;
+			if ((sig & 0x18) != 0) Reset();
+		}
+		return sig;
+	}
+
+	bool EnergyGateStream::Reset() {
+		m_open = true;
+		m_silent_frames = 0;
+		m_background.clear();
+		m_frame_index = 0;
+		m_look_back.clear();
+		m_look_back_frames = 0;
+		m_replaying = false;
+		return true;
+	}
+
+	std::string EnergyGateStream::Name() const {
+		return "EnergyGateStream";
+	}
+
+	EnergyGateStream::~EnergyGateStream() {}
+} // namespace snowboy
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <matrix-wrapper.h>
+#include <stream-itf.h>
+#include <vector>
+
+namespace snowboy {
+	struct OptionsItf;
+	struct EnergyGateStreamOptions {
+		float threshold = 1.0f;
+		uint32_t bg_window = 300;
+		uint32_t min_silence_frames = 50;
+		uint32_t look_back_frames = 50;
+		void Register(const std::string&, OptionsItf*);
+	};
+	// Drops reads of silence, so the streams after it only see audio that may contain speech. A frame is silent if its
+	// log energy is less than `threshold` above the background, the lowest log energy of the last `bg_window` frames.
+	// The gate closes after `min_silence_frames` silent frames while skipping is allowed and opens again at the first
+	// read with a frame that is not silent. The dropped reads holding the last `look_back_frames` frames are passed on
+	// one per read before it, so the reader has to read again while HasPending(). No signals are added, the frames just
+	// go missing.
+	class EnergyGateStream : public StreamItf {
+		EnergyGateStreamOptions m_options;
+		bool m_allow_skipping;
+		bool m_open;
+		uint32_t m_silent_frames;
+		// Ascending log energies of the background window with their frame index, the front is the background
+		std::deque<std::pair<uint64_t, float>> m_background;
+		uint64_t m_frame_index;
+		// The last dropped reads, holding m_look_back_frames frames
+		struct DroppedRead {
+			Matrix mat;
+			std::vector<FrameInfo> info;
+			int signal;
+		};
+		std::deque<DroppedRead> m_look_back;
+		size_t m_look_back_frames;
+		bool m_replaying;
+		uint64_t m_skipped_frames;
+
+		bool IsSilent(const float* frame, size_t len);
+		// Passes on the oldest dropped read
+		int Replay(Matrix* mat, std::vector<FrameInfo>* info);
+
+	public:
+		EnergyGateStream(const EnergyGateStreamOptions& options);
+		virtual int Read(Matrix* mat, std::vector<FrameInfo>* info) override;
+		virtual bool Reset() override;
+		virtual std::string Name() const override;
+		virtual ~EnergyGateStream();
+
+		// Frames are only dropped while allowed, the pipeline allows it while its VAD does not hear voice
+		void AllowSkipping(bool allow) { m_allow_skipping = allow; }
+		bool IsOpen() const { return m_open; }
+		bool HasPending() const { return m_replaying; }
+		// Frames dropped and not passed on since the construction
+		uint64_t SkippedFrames() const { return m_skipped_frames; }
+	};
+} // namespace snowboy
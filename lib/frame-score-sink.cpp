@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstring>
+#include <frame-score-sink.h>
+#include <snowboy-error.h>
+
+namespace snowboy {
+	// Flushing in blocks keeps the file sink cheap per detection step
+	static constexpr size_t kFileSinkBufferSize = 4096;
+
+	static void WriteFrameScoreHeader(std::ostream* os) {
+		FrameScoreFileHeader header{};
+		memcpy(header.magic, global_frame_score_magic, sizeof(header.magic));
+		header.version = kFrameScoreFileVersion;
+		header.record_size = sizeof(FrameScore);
+		os->write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+
+	FrameScoreFileSink::FrameScoreFileSink(const std::string& filename)
+		: m_stream{filename, std::ios::binary | std::ios::trunc} {
+		if (!m_stream)
+			throw snowboy_exception{"Fail to open output file \"" + filename + "\""};
+		WriteFrameScoreHeader(&m_stream);
+		m_buffer.reserve(kFileSinkBufferSize);
+	}
+
+	void FrameScoreFileSink::Write(const FrameScore* scores, size_t count) {
+		m_buffer.insert(m_buffer.end(), scores, scores + count);
+		if (m_buffer.size() >= kFileSinkBufferSize) Flush();
+	}
+
+	void FrameScoreFileSink::Flush() {
+		WriteFrameScores(&m_stream, m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+		m_stream.flush();
+	}
+
+	FrameScoreFileSink::~FrameScoreFileSink() {
+		// A failed write can not be reported from here, the trace is just cut short
+		try {
+			Flush();
+		} catch (...) {
+		}
+	}
+
+	FrameScoreRingBuffer::FrameScoreRingBuffer(size_t capacity)
+		: m_buffer(capacity) {
+		if (capacity == 0)
+			throw snowboy_exception{"frame score ring buffer needs a capacity"};
+	}
+
+	void FrameScoreRingBuffer::Write(const FrameScore* scores, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			m_buffer[m_head] = scores[i];
+			m_head = (m_head + 1) % m_buffer.size();
+		}
+		m_size = std::min(m_size + count, m_buffer.size());
+	}
+
+	std::vector<FrameScore> FrameScoreRingBuffer::Scores() const {
+		std::vector<FrameScore> res;
+		res.reserve(m_size);
+		auto start = (m_head + m_buffer.size() - m_size) % m_buffer.size();
+		for (size_t i = 0; i < m_size; i++)
+			res.push_back(m_buffer[(start + i) % m_buffer.size()]);
+		return res;
+	}
+
+	void FrameScoreRingBuffer::Save(const std::string& filename) const {
+		std::ofstream out{filename, std::ios::binary | std::ios::trunc};
+		if (!out)
+			throw snowboy_exception{"Fail to open output file \"" + filename + "\""};
+		WriteFrameScoreHeader(&out);
+		auto scores = Scores();
+		WriteFrameScores(&out, scores.data(), scores.size());
+	}
+
+	void FrameScoreRingBuffer::Clear() {
+		m_head = 0;
+		m_size = 0;
+	}
+
+	void WriteFrameScores(std::ostream* os, const FrameScore* scores, size_t count) {
+		os->write(reinterpret_cast<const char*>(scores), count * sizeof(FrameScore));
+		if (!*os)
+			throw snowboy_exception{"failed to write frame scores"};
+	}
+
+	std::vector<FrameScore> ReadFrameScores(const std::string& filename) {
+		std::ifstream in{filename, std::ios::binary};
+		if (!in)
+			throw snowboy_exception{"Fail to open input file \"" + filename + "\""};
+		FrameScoreFileHeader header{};
+		in.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!in || memcmp(header.magic, global_frame_score_magic, sizeof(header.magic)) != 0)
+			throw snowboy_exception{"\"" + filename + "\" is not a frame score trace"};
+		if (header.version != kFrameScoreFileVersion || header.record_size != sizeof(FrameScore))
+			throw snowboy_exception{"\"" + filename + "\" has unsupported frame score version " + std::to_string(header.version)};
+		std::vector<FrameScore> res;
+		FrameScore score;
+		while (in.read(reinterpret_cast<char*>(&score), sizeof(score)))
+			res.push_back(score);
+		if (in.gcount() != 0)
+			throw snowboy_exception{"\"" + filename + "\" has a truncated frame score"};
+		return res;
+	}
+} // namespace snowboy
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace snowboy {
+	// Score of one frame as seen by the detection streams, for offline analysis of false accepts
+	struct FrameScore {
+		enum Kind : uint8_t {
+			kUniversalPosterior = 1,
+			// DTW distance of one template, matched if below the sensitivity. Distances above it may be
+			// cut short by the early stopping of the DTW.
+			kTemplateDistance = 2,
+		};
+		uint32_t frame_id;
+		// FrameInfo::flags of the frame, bit 0 is set for voiced frames
+		uint16_t flags;
+		uint8_t kind;
+		// Template of the personal model, 0 for universal models
+		uint8_t template_id;
+		// Hotword as returned by RunDetection(). Streams used outside of a detector write the hotword id of the
+		// universal keyword or the index of the personal model instead.
+		uint32_t hotword;
+		float score;
+	};
+	static_assert(sizeof(FrameScore) == 16, "FrameScore is written to trace files as is");
+
+	// Trace files start with this header, followed by FrameScore records in host byte order
+	struct FrameScoreFileHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t record_size;
+		uint32_t reserved;
+	};
+	constexpr const char* global_frame_score_magic = "SBFS";
+	constexpr uint32_t kFrameScoreFileVersion = 1;
+
+	// Receives the scores of the detection streams. Write() is called from RunDetection() with the scores of
+	// one step of the detection, so implementations should not block.
+	class FrameScoreSink {
+	public:
+		virtual void Write(const FrameScore* scores, size_t count) = 0;
+		virtual ~FrameScoreSink() {}
+	};
+
+	// Buffers the scores and appends them to a trace file
+	class FrameScoreFileSink : public FrameScoreSink {
+		std::ofstream m_stream;
+		std::vector<FrameScore> m_buffer;
+
+	public:
+		explicit FrameScoreFileSink(const std::string& filename);
+		virtual void Write(const FrameScore* scores, size_t count) override;
+		void Flush();
+		virtual ~FrameScoreFileSink();
+	};
+
+	// Keeps the last `capacity` scores in memory, e.g. to save the context of a detection
+	class FrameScoreRingBuffer : public FrameScoreSink {
+		std::vector<FrameScore> m_buffer;
+		size_t m_head{0};
+		size_t m_size{0};
+
+	public:
+		explicit FrameScoreRingBuffer(size_t capacity);
+		virtual void Write(const FrameScore* scores, size_t count) override;
+		// Buffered scores, oldest first
+		std::vector<FrameScore> Scores() const;
+		void Save(const std::string& filename) const;
+		void Clear();
+	};
+
+	void WriteFrameScores(std::ostream* os, const FrameScore* scores, size_t count);
+	std::vector<FrameScore> ReadFrameScores(const std::string& filename);
+} // namespace snowboy
@@ -1,10 +1,15 @@
 #include "msvc_compat.h"
 #include <cmath>
+#include <cstring>
 #include <framer-stream.h>
+#include <frontend-lib.h>
 #include <matrix-wrapper.h>
 #include <random>
 #include <snowboy-error.h>
 #include <snowboy-options.h>
+#ifdef TSPL_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace snowboy {
 	void FramerStreamOptions::Register(const std::string& prefix, OptionsItf* opts) {
@@ -12,11 +17,52 @@ namespace snowboy {
 		opts->Register(prefix, "frame-length", "Frame length in milliseconds.", &frame_length_ms);
 		opts->Register(prefix, "frame-shift", "Frame shift in milliseconds.", &frame_shift_ms);
 		opts->Register(prefix, "dither-coeff", "Dithering coefficient, 0 means no dithering at all.", &dither_coeff);
+		opts->Register(prefix, "dither-seed", "Seed of the dithering noise, -1 picks a random one.", &dither_seed);
 		opts->Register(prefix, "preemphasis-coeff", "Pre-emphasis coefficient.", &preemphasis_coeff);
 		opts->Register(prefix, "subtract-mean", "If true, subtract mean from each frame.", &subtract_mean);
 		opts->Register(prefix, "window-type", "Type of window to use, candidates are: hamming|hanning|rectangular|povey.", &window_type);
 	}
 
+	void DitherGenerator::Seed(uint32_t seed) {
+		// splitmix32 spreads one seed over the lanes, none of which may be zero
+		for (auto& e : m_state) {
+			uint32_t z = (seed += 0x9e3779b9u);
+			z = (z ^ (z >> 16)) * 0x85ebca6bu;
+			z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+			z ^= z >> 16;
+			e = z != 0 ? z : 1;
+		}
+	}
+
+	void DitherGenerator::AddNoise(float* data, size_t len, float scale) {
+		// Four uniform bytes: mean 510, standard deviation sqrt(4 * (256^2 - 1) / 12)
+		const float mul = scale / 147.7996f;
+		uint32_t state[8];
+		memcpy(state, m_state, sizeof(state));
+		size_t i = 0;
+		for (; i + 8 <= len; i += 8) {
+			for (size_t l = 0; l < 8; l++) {
+				uint32_t x = state[l];
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				state[l] = x;
+				int sum = static_cast<int>((x & 0xff) + ((x >> 8) & 0xff) + ((x >> 16) & 0xff) + (x >> 24));
+				data[i + l] += static_cast<float>(sum - 510) * mul;
+			}
+		}
+		for (size_t l = 0; i < len; i++, l++) {
+			uint32_t x = state[l];
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			state[l] = x;
+			int sum = static_cast<int>((x & 0xff) + ((x >> 8) & 0xff) + ((x >> 16) & 0xff) + (x >> 24));
+			data[i] += static_cast<float>(sum - 510) * mul;
+		}
+		memcpy(m_state, state, sizeof(state));
+	}
+
 	FramerStream::FramerStream(const FramerStreamOptions& options)
 		: m_options{options} {
 		const auto samples_per_ms = static_cast<double>(m_options.sample_rate) * 0.001;
@@ -24,6 +70,8 @@ namespace snowboy {
 		m_frame_shift_samples = m_options.frame_shift_ms * samples_per_ms;
 		CreateWindow();
 		this->field_x38 = 1;
+		if (m_options.dither_seed < 0) m_options.dither_seed = std::random_device{}() & 0x7fffffff;
+		m_dither.Seed(m_options.dither_seed);
 	}
 
 	void FramerStream::CreateWindow() {
@@ -53,42 +101,59 @@ namespace snowboy {
 			throw snowboy_exception{"Window type " + m_options.window_type + " is not defined"};
 	}
 
+	void FramerStream::ProcessFrame(const float* in, float* out, float mean) const {
+		// out[i] = window[i] * ((in[i] - mean) - coeff * (in[i - 1] - mean)) with in[-1] = in[0], which is exactly what the
+		// separate mean removal, pre-emphasis and window passes computed. `in` may be `out`.
+		const float coeff = m_options.preemphasis_coeff;
+		const float* window = m_window.data();
+		const size_t len = m_frame_length_samples;
+		float prev = in[0] - mean;
+		size_t i = 0;
+#ifdef TSPL_HAVE_SSE2
+		const __m128 vmean = _mm_set1_ps(mean);
+		const __m128 vcoeff = _mm_set1_ps(coeff);
+		// Lane 3 carries the previous sample into the next block, so no sample is loaded twice
+		__m128 last = _mm_set1_ps(prev);
+		for (; i + 4 <= len; i += 4) {
+			const __m128 cur = _mm_sub_ps(_mm_loadu_ps(in + i), vmean);
+			const __m128 shifted = _mm_castsi128_ps(
+				_mm_or_si128(_mm_slli_si128(_mm_castps_si128(cur), 4), _mm_srli_si128(_mm_castps_si128(last), 12)));
+			const __m128 y = _mm_sub_ps(cur, _mm_mul_ps(vcoeff, shifted));
+			_mm_storeu_ps(out + i, _mm_mul_ps(y, _mm_loadu_ps(window + i)));
+			last = cur;
+		}
+		if (i != 0) prev = _mm_cvtss_f32(_mm_shuffle_ps(last, last, _MM_SHUFFLE(3, 3, 3, 3)));
+#endif
+		for (; i < len; i++) {
+			const float cur = in[i] - mean;
+			out[i] = window[i] * (cur - coeff * prev);
+			prev = cur;
+		}
+	}
+
 	void FramerStream::CreateFrames(const VectorBase& data, Matrix* mat) {
 		const auto nframes = NumFrames(data.size());
-		mat->Resize(nframes, m_frame_length_samples);
-		std::mt19937 gen;
-		// This might have a different mean
-		std::uniform_real_distribution<float> dist;
+		const auto len = m_frame_length_samples;
+		mat->Resize(nframes, len, MatrixResizeType::kUndefined);
+		const bool dither = m_options.dither_coeff != 0.0f && len > 0;
 		for (size_t currentFrame = 0; currentFrame < nframes; currentFrame++) {
 			SubVector sub{*mat, currentFrame};
-			sub.CopyFromVec(data.Range(this->m_frame_shift_samples * currentFrame, this->m_frame_length_samples));
-			if (this->m_options.dither_coeff != 0.0 && sub.size() > 0) {
-				auto data = sub.data();
-				for (size_t i = 0; i < sub.size(); i++) {
-					// Kaldi RandGauss
-					float r = sqrt(-2 * std::log(dist(gen))) * cos(2 * M_PI * dist(gen));
-					data[i] += r * this->m_options.dither_coeff;
-				}
+			auto frame = data.Range(m_frame_shift_samples * currentFrame, len);
+			// Dithering has to happen before the mean is taken, so the noisy frame is staged in the output row
+			if (dither) {
+				sub.CopyFromVec(frame);
+				m_dither.AddNoise(sub.data(), len, m_options.dither_coeff);
 			}
-			if (this->m_options.subtract_mean) {
-				auto sum = sub.Sum();
-				sub.Add(-sum / sub.size());
-			}
-			if (this->m_options.preemphasis_coeff != 0.0) {
-				auto data = sub.data();
-				for (size_t i = sub.size() - 1; i > 0; i--) {
-					data[i] -= this->m_options.preemphasis_coeff * data[i - 1];
-				}
-				data[0] -= this->m_options.preemphasis_coeff * data[0];
-			}
-			sub.MulElements(this->m_window);
-		}
-		// Cache remaining samples in our temp buffer
-		auto remain = data.size() - (nframes * this->m_frame_shift_samples);
-		this->field_x40.Resize(remain);
-		if (remain > 0) {
-			this->field_x40.CopyFromVec(data.Range(nframes * this->m_frame_shift_samples, remain));
+			const VectorBase& in = dither ? static_cast<const VectorBase&>(sub) : frame;
+			const float mean = m_options.subtract_mean ? in.Sum() / len : 0.0f;
+			ProcessFrame(in.data(), sub.data(), mean);
 		}
+		// Keep the remaining samples at the front of the sample buffer. Shrinking never reallocates, so this is safe
+		// when `data` is the sample buffer itself.
+		auto remain = data.size() - (nframes * m_frame_shift_samples);
+		auto rest = data.data() + nframes * m_frame_shift_samples;
+		field_x40.Resize(remain, MatrixResizeType::kCopyData);
+		if (remain > 0 && field_x40.data() != rest) memmove(field_x40.data(), rest, remain * sizeof(float));
 	}
 
 	size_t FramerStream::NumFrames(size_t p1) const {
@@ -106,13 +171,12 @@ namespace snowboy {
 			return sig;
 		}
 
-		Vector temp_vector;
-		temp_vector.Resize(matrix_in.m_cols + field_x40.size());
-		temp_vector.Range(0, field_x40.size()).CopyFromVec(field_x40);
-		temp_vector.Range(field_x40.size(), matrix_in.m_cols).CopyFromVec(SubVector{matrix_in, 0});
-		field_x40.Resize(0);
+		// New samples are appended to the leftovers of the last call, the buffer keeps its capacity between calls
+		const auto buffered = field_x40.size();
+		field_x40.Resize(buffered + matrix_in.m_cols, MatrixResizeType::kCopyData);
+		field_x40.Range(buffered, matrix_in.m_cols).CopyFromVec(SubVector{matrix_in, 0});
 
-		CreateFrames(temp_vector, mat);
+		CreateFrames(field_x40, mat);
 
 		info->resize(mat->m_rows);
 		if (!info->empty()) {
@@ -131,6 +195,8 @@ namespace snowboy {
 
 	bool FramerStream::Reset() {
 		field_x40.Resize(0);
+		// Reseeding keeps the output of a run independent of what was processed before the reset
+		m_dither.Seed(m_options.dither_seed);
 		return true;
 	}
 
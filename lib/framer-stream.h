@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <frame-info.h>
 #include <stream-itf.h>
 #include <string>
@@ -11,21 +12,35 @@ namespace snowboy {
 		int frame_length_ms;
 		int frame_shift_ms;
 		float dither_coeff;
+		int dither_seed = 0;
 		float preemphasis_coeff;
 		bool subtract_mean;
 		std::string window_type;
 		void Register(const std::string&, OptionsItf*);
 	};
+	// Dithering noise from eight xorshift32 lanes, which the compiler runs as one vector. Each value is the sum of
+	// the four bytes of a lane, scaled to unit variance: close enough to a Gaussian for dithering.
+	struct DitherGenerator {
+		uint32_t m_state[8];
+
+		void Seed(uint32_t seed);
+		// Adds `scale` times the noise to `data`
+		void AddNoise(float* data, size_t len, float scale);
+	};
+
 	struct FramerStream : StreamItf {
 		FramerStreamOptions m_options;
 		int field_x38;
 		int field_x3c; // might be padding
-		Vector field_x40;
+		Vector field_x40; // Samples not yet framed, reused across calls
 		size_t m_frame_shift_samples;
 		size_t m_frame_length_samples;
 		Vector m_window;
+		DitherGenerator m_dither;
 
 		void CreateWindow();
+		// Writes one finished frame from the frame length samples at `in`
+		void ProcessFrame(const float* in, float* out, float mean) const;
 		void CreateFrames(const VectorBase& data, Matrix* mat);
 		size_t NumFrames(size_t p1) const;
 
@@ -10,6 +10,9 @@
 #include <intrin.h> // for _BitScanReverse
 #endif
 #include <frontend-lib.h>
+#ifdef TSPL_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 #define SHR(a, shift) ((a) >> (shift))
 #define SHR16(a, shift) ((a) >> (shift))
@@ -216,9 +219,64 @@ extern "C"
 		6982, 6786, 6589, 6392, 6195, 5997, 5799, 5601, 5403,
 		5205, 5006, 4807, 4608, 4409, 4210, 4011, 3811, 3611,
 		3411, 3211, 3011, 2811, 2610, 2410, 2209, 2009, 1808,
-		1607, 1406, 1206, 1005, 804, 603, 402, 201,
-		// ... the table continues; keep the full 1024 entries as in your source ...
-		-201};
+		1607, 1406, 1206, 1005, 804, 603, 402, 201, 0,
+		-201, -402, -603, -804, -1005, -1206, -1406, -1607, -1808,
+		-2009, -2209, -2410, -2610, -2811, -3011, -3211, -3411, -3611,
+		-3811, -4011, -4210, -4409, -4608, -4807, -5006, -5205, -5403,
+		-5601, -5799, -5997, -6195, -6392, -6589, -6786, -6982, -7179,
+		-7375, -7571, -7766, -7961, -8156, -8351, -8545, -8739, -8932,
+		-9126, -9319, -9511, -9703, -9895, -10087, -10278, -10469, -10659,
+		-10849, -11038, -11227, -11416, -11604, -11792, -11980, -12166, -12353,
+		-12539, -12724, -12909, -13094, -13278, -13462, -13645, -13827, -14009,
+		-14191, -14372, -14552, -14732, -14911, -15090, -15268, -15446, -15623,
+		-15799, -15975, -16150, -16325, -16499, -16672, -16845, -17017, -17189,
+		-17360, -17530, -17699, -17868, -18036, -18204, -18371, -18537, -18702,
+		-18867, -19031, -19194, -19357, -19519, -19680, -19840, -20000, -20159,
+		-20317, -20474, -20631, -20787, -20942, -21096, -21249, -21402, -21554,
+		-21705, -21855, -22004, -22153, -22301, -22448, -22594, -22739, -22883,
+		-23027, -23169, -23311, -23452, -23592, -23731, -23869, -24006, -24143,
+		-24278, -24413, -24546, -24679, -24811, -24942, -25072, -25201, -25329,
+		-25456, -25582, -25707, -25831, -25954, -26077, -26198, -26318, -26437,
+		-26556, -26673, -26789, -26905, -27019, -27132, -27244, -27355, -27466,
+		-27575, -27683, -27790, -27896, -28001, -28105, -28208, -28309, -28410,
+		-28510, -28608, -28706, -28802, -28897, -28992, -29085, -29177, -29268,
+		-29358, -29446, -29534, -29621, -29706, -29790, -29873, -29955, -30036,
+		-30116, -30195, -30272, -30349, -30424, -30498, -30571, -30643, -30713,
+		-30783, -30851, -30918, -30984, -31049, -31113, -31175, -31236, -31297,
+		-31356, -31413, -31470, -31525, -31580, -31633, -31684, -31735, -31785,
+		-31833, -31880, -31926, -31970, -32014, -32056, -32097, -32137, -32176,
+		-32213, -32249, -32284, -32318, -32350, -32382, -32412, -32441, -32468,
+		-32495, -32520, -32544, -32567, -32588, -32609, -32628, -32646, -32662,
+		-32678, -32692, -32705, -32717, -32727, -32736, -32744, -32751, -32757,
+		-32761, -32764, -32766, -32767, -32766, -32764, -32761, -32757, -32751,
+		-32744, -32736, -32727, -32717, -32705, -32692, -32678, -32662, -32646,
+		-32628, -32609, -32588, -32567, -32544, -32520, -32495, -32468, -32441,
+		-32412, -32382, -32350, -32318, -32284, -32249, -32213, -32176, -32137,
+		-32097, -32056, -32014, -31970, -31926, -31880, -31833, -31785, -31735,
+		-31684, -31633, -31580, -31525, -31470, -31413, -31356, -31297, -31236,
+		-31175, -31113, -31049, -30984, -30918, -30851, -30783, -30713, -30643,
+		-30571, -30498, -30424, -30349, -30272, -30195, -30116, -30036, -29955,
+		-29873, -29790, -29706, -29621, -29534, -29446, -29358, -29268, -29177,
+		-29085, -28992, -28897, -28802, -28706, -28608, -28510, -28410, -28309,
+		-28208, -28105, -28001, -27896, -27790, -27683, -27575, -27466, -27355,
+		-27244, -27132, -27019, -26905, -26789, -26673, -26556, -26437, -26318,
+		-26198, -26077, -25954, -25831, -25707, -25582, -25456, -25329, -25201,
+		-25072, -24942, -24811, -24679, -24546, -24413, -24278, -24143, -24006,
+		-23869, -23731, -23592, -23452, -23311, -23169, -23027, -22883, -22739,
+		-22594, -22448, -22301, -22153, -22004, -21855, -21705, -21554, -21402,
+		-21249, -21096, -20942, -20787, -20631, -20474, -20317, -20159, -20000,
+		-19840, -19680, -19519, -19357, -19194, -19031, -18867, -18702, -18537,
+		-18371, -18204, -18036, -17868, -17699, -17530, -17360, -17189, -17017,
+		-16845, -16672, -16499, -16325, -16150, -15975, -15799, -15623, -15446,
+		-15268, -15090, -14911, -14732, -14552, -14372, -14191, -14009, -13827,
+		-13645, -13462, -13278, -13094, -12909, -12724, -12539, -12353, -12166,
+		-11980, -11792, -11604, -11416, -11227, -11038, -10849, -10659, -10469,
+		-10278, -10087, -9895, -9703, -9511, -9319, -9126, -8932, -8739,
+		-8545, -8351, -8156, -7961, -7766, -7571, -7375, -7179, -6982,
+		-6786, -6589, -6392, -6195, -5997, -5799, -5601, -5403, -5205,
+		-5006, -4807, -4608, -4409, -4210, -4011, -3811, -3611, -3411,
+		-3211, -3011, -2811, -2610, -2410, -2209, -2009, -1808, -1607,
+		-1406, -1206, -1005, -804, -603, -402, -201};
 
 	int TSpl_ComplexFFT(int16_t* frfi, int stages, int mode) {
 		int i, j, l, k, istep, n, m;
@@ -292,7 +350,23 @@ extern "C"
 	// Put this early so callers don't need a prototype from the header.
 	int16_t TSpl_MaxAbsValueW16(const int16_t* vector, size_t length) {
 		int maximum = 0;
-		for (size_t i = 0; i < length; ++i) {
+		size_t i = 0;
+#ifdef TSPL_HAVE_SSE2
+		if (length >= 8) {
+			// The saturating negation maps -32768 to 32767, which is what the result saturates to anyway
+			const __m128i zero = _mm_setzero_si128();
+			__m128i max = zero;
+			for (; i + 8 <= length; i += 8) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vector + i));
+				max = _mm_max_epi16(max, _mm_max_epi16(v, _mm_subs_epi16(zero, v)));
+			}
+			max = _mm_max_epi16(max, _mm_srli_si128(max, 8));
+			max = _mm_max_epi16(max, _mm_srli_si128(max, 4));
+			max = _mm_max_epi16(max, _mm_srli_si128(max, 2));
+			maximum = static_cast<int16_t>(_mm_cvtsi128_si32(max));
+		}
+#endif
+		for (; i < length; ++i) {
 			int v = vector[i];
 			int absolute = (v >= 0) ? v : -v; // integer abs; safe in int
 			if (absolute > maximum) maximum = absolute;
@@ -614,4 +688,70 @@ extern "C"
 		return B;
 	}
 
+	uint32_t TSpl_SqrtFloor(uint32_t value) {
+		// Digit by digit, exact for the whole range
+		uint32_t root = 0;
+		uint32_t bit = 1u << 30;
+		while (bit > value)
+			bit >>= 2;
+		while (bit != 0) {
+			if (value >= root + bit) {
+				value -= root + bit;
+				root = (root >> 1) + bit;
+			} else {
+				root >>= 1;
+			}
+			bit >>= 2;
+		}
+		return root;
+	}
+
+	// ---------- Vector helpers ----------
+
+	void TSpl_ScaleVectorW16(const int16_t* in, const int16_t* gain, int16_t* out, size_t length, int right_shifts) {
+		size_t i = 0;
+#ifdef TSPL_HAVE_SSE2
+		const __m128i shift = _mm_cvtsi32_si128(right_shifts);
+		for (; i + 8 <= length; i += 8) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			__m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gain + i));
+			__m128i lo = _mm_mullo_epi16(x, g);
+			__m128i hi = _mm_mulhi_epi16(x, g);
+			__m128i p0 = _mm_sra_epi32(_mm_unpacklo_epi16(lo, hi), shift);
+			__m128i p1 = _mm_sra_epi32(_mm_unpackhi_epi16(lo, hi), shift);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(p0, p1));
+		}
+#endif
+		for (; i < length; i++)
+			out[i] = TSpl_SatW32ToW16((static_cast<int32_t>(in[i]) * gain[i]) >> right_shifts);
+	}
+
+	void TSpl_AddSatVectorW16(const int16_t* a, const int16_t* b, int16_t* out, size_t length) {
+		size_t i = 0;
+#ifdef TSPL_HAVE_SSE2
+		for (; i + 8 <= length; i += 8) {
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_adds_epi16(x, y));
+		}
+#endif
+		for (; i < length; i++)
+			out[i] = TSpl_AddSatW16(a[i], b[i]);
+	}
+
+	void TSpl_ComplexSquaredMagnitude(const int16_t* frfi, uint32_t* out, size_t bins) {
+		size_t k = 0;
+#ifdef TSPL_HAVE_SSE2
+		// pmaddwd sums re^2 + im^2 in one step, the only overflow (2^31) is still right as unsigned
+		for (; k + 4 <= bins; k += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frfi + 2 * k));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), _mm_madd_epi16(v, v));
+		}
+#endif
+		for (; k < bins; k++) {
+			int32_t re = frfi[2 * k], im = frfi[2 * k + 1];
+			out[k] = static_cast<uint32_t>(re * re) + static_cast<uint32_t>(im * im);
+		}
+	}
+
 } // extern "C"
@@ -2,12 +2,18 @@
 #include <cstddef>
 #include <cstdint>
 
+// SSE2 is part of every x86-64 target, the vector helpers fall back to plain loops elsewhere
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TSPL_HAVE_SSE2 1
+#endif
+
 extern "C"
 {
 	int32_t spx_exp2(int16_t x);
 	int32_t spx_exp(int16_t x);
 	int16_t TSpl_AddSatW16(int16_t a, int16_t b);
 	int16_t TSpl_SatW32ToW16(int32_t value32);
+	void TSpl_ComplexBitReverse(int16_t* complex_data, int stages);
 	int TSpl_ComplexFFT(int16_t* frfi, int stages, int mode);
 	int TSpl_ComplexIFFT(int16_t* frfi, int stages, int mode);
 	uint32_t TSpl_DivU32U16(uint32_t a, uint16_t b);
@@ -24,4 +30,11 @@ extern "C"
 	int16_t TSpl_NormW32(int32_t a);
 	int32_t TSpl_Sqrt(int32_t value);
 	int32_t TSpl_SqrtLocal(int32_t in);
+	uint32_t TSpl_SqrtFloor(uint32_t value);
+	// out[i] = sat16((in[i] * gain[i]) >> right_shifts), in place is fine
+	void TSpl_ScaleVectorW16(const int16_t* in, const int16_t* gain, int16_t* out, size_t length, int right_shifts);
+	// out[i] = sat16(a[i] + b[i])
+	void TSpl_AddSatVectorW16(const int16_t* a, const int16_t* b, int16_t* out, size_t length);
+	// out[k] = re^2 + im^2 of the interleaved complex values
+	void TSpl_ComplexSquaredMagnitude(const int16_t* frfi, uint32_t* out, size_t bins);
 }
\ No newline at end of file
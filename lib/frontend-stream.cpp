@@ -1,14 +1,48 @@
 #include <agc.h>
+#include <algorithm>
+#include <cmath>
 #include <frame-info.h>
+#include <frontend-lib.h>
 #include <frontend-stream.h>
 #include <matrix-wrapper.h>
 #include <ns3.h>
 #include <snowboy-error.h>
 #include <snowboy-options.h>
-
-#define ENABLE_FRONTEND_STREAM 0
+#ifdef TSPL_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace snowboy {
+	// Rounds and saturates to 16 bit, the range the fixed point frontend works in
+	static void FloatToShort(const float* in, short* out, size_t len) {
+		size_t i = 0;
+#ifdef TSPL_HAVE_SSE2
+		for (; i + 8 <= len; i += 8) {
+			__m128i lo = _mm_cvtps_epi32(_mm_loadu_ps(in + i));
+			__m128i hi = _mm_cvtps_epi32(_mm_loadu_ps(in + i + 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+		}
+#endif
+		for (; i < len; i++)
+			out[i] = TSpl_SatW32ToW16(static_cast<int32_t>(lrintf(std::max(-32768.0f, std::min(32767.0f, in[i])))));
+	}
+
+	static void ShortToFloat(const short* in, float* out, size_t len) {
+		size_t i = 0;
+#ifdef TSPL_HAVE_SSE2
+		for (; i + 8 <= len; i += 8) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			// Sign extend by moving the samples to the upper half and shifting them back down
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(out + i, _mm_cvtepi32_ps(lo));
+			_mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(hi));
+		}
+#endif
+		for (; i < len; i++)
+			out[i] = in[i];
+	}
+
 	void FrontendStreamOptions::Register(const std::string& prefix, OptionsItf* opts) {
 		opts->Register(prefix, "ns-power", "NS power.", &ns_power);
 		opts->Register(prefix, "dr-power", "DR power.", &dr_power);
@@ -23,9 +57,7 @@ namespace snowboy {
 		m_dr_power = options.dr_power;
 		m_agc_level = options.agc_level;
 		m_agc_power = options.agc_power;
-#if ENABLE_FRONTEND_STREAM
-		field_x60 = 0xa0;
-		field_x38 = malloc(0x140); // this should be new x, might be 160 shorts
+		m_block_size = 0xa0;
 		m_ns3_instance = nullptr;
 		m_agc_instance = nullptr;
 		try {
@@ -33,72 +65,62 @@ namespace snowboy {
 		} catch (...) {
 			if (m_ns3_instance) NS3_Exit(m_ns3_instance);
 			if (m_agc_instance) AGC_Exit(m_agc_instance);
-			if (field_x38) free(field_x38); // this should be delete x
 			m_ns3_instance = nullptr;
 			m_agc_instance = nullptr;
-			field_x38 = nullptr;
 			throw;
 		}
-#endif
 	}
 
 	int FrontendStream::Read(Matrix* mat, std::vector<FrameInfo>* info) {
-#if !ENABLE_FRONTEND_STREAM
-		// TODO: Implement this stuff
-		// It seems to work reasonably good without AGC and Noise suppression,
-		// so we just read from the previous stream for now.
-		// However for performance and completeness we should really implement it correctly
-		return m_connectedStream->Read(mat, info);
-#else
-		// TODO:
 		Matrix m;
 		auto res = m_connectedStream->Read(&m, info);
-		field_x64 = field_x64 + m.m_cols;
-		if (field_x64 > 48000) {
-			this->Reset();
-		}
-		if ((res & 0xc2) == 0 && m.m_rows != 0) {
-			Vector v;
-			v.Resize(field_x50.size() + m.m_cols);
-			v.Range(0, field_x50.size()).CopyFromVec(field_x50);
-			v.Range(field_x50.size(), m.m_cols).CopyFromVec(SubVector{m, 0});
-			field_x50.Resize(0);
-			auto x = v.size() / field_x60;
-			mat->Resize(1, x * field_x60);
-			// TODO: More code between here
-			if (x > 0) {
-			}
-			// TODO: and here
-		} else {
+		if ((res & 0xc2) != 0 || m.m_rows == 0) {
 			mat->Resize(0, 0);
 			info->clear();
+			return res;
+		}
+		// NS and AGC work on whole 10 ms blocks, the rest is kept for the next read
+		const size_t total = m_remainder.size() + m.m_cols;
+		const size_t len = total / m_block_size * m_block_size;
+		m_samples.resize(total);
+		FloatToShort(m_remainder.data(), m_samples.data(), m_remainder.size());
+		FloatToShort(m.m_data, m_samples.data() + m_remainder.size(), m.m_cols);
+		for (size_t i = 0; i < len; i += m_block_size) {
+			NS3_Process(m_ns3_instance, &m_samples[i], &m_samples[i]);
+			AGC_Process(m_agc_instance, &m_samples[i], &m_samples[i]);
+		}
+		mat->Resize(1, len, MatrixResizeType::kUndefined);
+		ShortToFloat(m_samples.data(), mat->m_data, len);
+		m_remainder.Resize(total - len, MatrixResizeType::kUndefined);
+		ShortToFloat(m_samples.data() + len, m_remainder.data(), total - len);
+		if ((res & 0x18) != 0) {
+			m_remainder.Resize(0);
 		}
 		return res;
-#endif
 	}
 
 	bool FrontendStream::Reset() {
-#if ENABLE_FRONTEND_STREAM
 		if (m_ns3_instance) NS3_Exit(m_ns3_instance);
 		if (m_agc_instance) AGC_Exit(m_agc_instance);
-		field_x60 = 0xa0;
+		m_ns3_instance = nullptr;
+		m_agc_instance = nullptr;
+		m_block_size = 0xa0;
 		int status;
-		m_ns3_instance = NS3_Init(16000, 0xa0, &status);
+		m_ns3_instance = NS3_Init(16000, m_block_size, &status);
 		if (status != 1)
 			throw snowboy_exception{"Failed to initialize NS."};
 		if (NS3_SetPara(m_ns3_instance, "NS_Power", m_ns_power.c_str()) != 1)
 			throw snowboy_exception{"Failed to set NS_Power."};
 		if (NS3_SetPara(m_ns3_instance, "DR_Power", m_dr_power.c_str()) != 1)
 			throw snowboy_exception{"Failed to set DR_Power."};
-		m_agc_instance = AGC_Init(16000, field_x60, 1, &status);
+		m_agc_instance = AGC_Init(16000, m_block_size, 1, &status);
 		if (status != 1)
 			throw snowboy_exception{"Failed to initialize AGC."};
 		if (AGC_SetPara(m_agc_instance, "AGC_Level", m_agc_level.c_str()) != 1)
 			throw snowboy_exception{"Failed to set AGC_Level."};
 		if (AGC_SetPara(m_agc_instance, "AGC_Power", m_agc_power.c_str()) != 1)
 			throw snowboy_exception{"Failed to set AGC_Power."};
-		field_x64 = 0;
-#endif
+		m_remainder.Resize(0);
 		return true;
 	}
 
@@ -107,11 +129,8 @@ namespace snowboy {
 	}
 
 	FrontendStream::~FrontendStream() {
-#if ENABLE_FRONTEND_STREAM
 		if (m_ns3_instance) NS3_Exit(m_ns3_instance);
 		if (m_agc_instance) AGC_Exit(m_agc_instance);
-		if (field_x38) free(field_x38); // this should be delete x
-#endif
 		m_connectedStream = nullptr;
 		m_isConnected = false;
 	}
@@ -1,6 +1,7 @@
 #pragma once
 #include <stream-itf.h>
 #include <string>
+#include <vector>
 #include <vector-wrapper.h>
 
 struct AGC_Instance;
@@ -19,12 +20,11 @@ namespace snowboy {
 		std::string m_dr_power;
 		std::string m_agc_level;
 		std::string m_agc_power;
-		void* field_x38; // 0x140 bytes
+		std::vector<short> m_samples; // 16 bit copy of the blocks processed by one Read()
 		NS3_Instance* m_ns3_instance;
 		AGC_Instance* m_agc_instance;
-		Vector field_x50;
-		int field_x60;
-		int field_x64; // might be padding
+		Vector m_remainder; // samples short of a whole block, processed with the next Read()
+		int m_block_size;
 
 		FrontendStream(const FrontendStreamOptions& options);
 		virtual int Read(Matrix* mat, std::vector<FrameInfo>* info) override;
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <frontend-lib.h>
 #include <gain-control-stream.h>
 #include <matrix-wrapper.h>
 #include <snowboy-error.h>
 #include <snowboy-options.h>
+#ifdef TSPL_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace snowboy {
 	bool StreamItf::Connect(StreamItf* other) {
@@ -25,31 +30,46 @@ namespace snowboy {
 	GainControlStream::GainControlStream(const GainControlStreamOptions& options) {
 		m_connectedStream = nullptr;
 		m_isConnected = false;
-		SetAudioGain(options.m_audioGain);
 		m_maxAudioAmplitude = 32767.0;
+		SetAudioGain(options.m_audioGain);
 	}
 
 	int GainControlStream::Read(Matrix* mat, std::vector<FrameInfo>* info) {
 		auto res = m_connectedStream->Read(mat, info);
 		if ((res & 0xc2) == 0 && m_audioGain != 1.0 && mat->m_rows > 0) {
-			auto len = mat->m_rows * mat->m_stride;
-			auto ptr = mat->m_data;
-			for (size_t i = 0; i < len; i++) {
-				auto v = ptr[i];
-				v /= m_maxAudioAmplitude;
-				v *= m_audioGain;
-				if (v >= 1.0)
-					v = 1.0;
-				else if (v <= -1.0)
-					v = -1.0;
-				else
-					v = v * 1.5 - v * v * 0.5 * v;
-				ptr[i] = v * m_maxAudioAmplitude;
-			}
+			// Only the samples, the stride padding is left alone
+			for (size_t r = 0; r < mat->m_rows; r++)
+				Process(mat->m_data + r * mat->m_stride, mat->m_cols);
 		}
 		return res;
 	}
 
+	void GainControlStream::Process(float* data, size_t len) const {
+		// v = clamp(x * gain / amplitude, -1, 1), x = (1.5 v - 0.5 v^3) * amplitude. The cubic is exactly 1 at the
+		// clamped ends, so clamping first needs no branch.
+		const float scale = m_scale;
+		const float amp = m_maxAudioAmplitude;
+		size_t i = 0;
+#ifdef TSPL_HAVE_SSE2
+		const __m128 vscale = _mm_set1_ps(scale);
+		const __m128 vamp = _mm_set1_ps(amp);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minus_one = _mm_set1_ps(-1.0f);
+		const __m128 one_half = _mm_set1_ps(1.5f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (; i + 4 <= len; i += 4) {
+			__m128 v = _mm_mul_ps(_mm_loadu_ps(data + i), vscale);
+			v = _mm_min_ps(_mm_max_ps(v, minus_one), one);
+			const __m128 y = _mm_mul_ps(v, _mm_sub_ps(one_half, _mm_mul_ps(half, _mm_mul_ps(v, v))));
+			_mm_storeu_ps(data + i, _mm_mul_ps(y, vamp));
+		}
+#endif
+		for (; i < len; i++) {
+			auto v = std::min(std::max(data[i] * scale, -1.0f), 1.0f);
+			data[i] = v * (1.5f - 0.5f * v * v) * amp;
+		}
+	}
+
 	bool GainControlStream::Reset() {
 		return true;
 	}
@@ -65,6 +85,7 @@ namespace snowboy {
 			throw snowboy_exception{"audio gain must be non-negative"};
 		}
 		m_audioGain = gain;
+		m_scale = m_audioGain / m_maxAudioAmplitude;
 	}
 
 	void GainControlStream::SetMaxAudioAmplitude(float amp) {
@@ -72,6 +93,7 @@ namespace snowboy {
 			throw snowboy_exception{"max audio amplitude must be non-negative"};
 		}
 		m_maxAudioAmplitude = amp;
+		m_scale = m_audioGain / m_maxAudioAmplitude;
 	}
 
 } // namespace snowboy
@@ -10,6 +10,8 @@ namespace snowboy {
 	class GainControlStream : public StreamItf {
 		float m_audioGain;
 		float m_maxAudioAmplitude;
+		// Gain divided by the amplitude, the scale to the clipper's [-1, 1] range
+		float m_scale;
 
 	public:
 		GainControlStream(const GainControlStreamOptions& options);
@@ -20,5 +22,7 @@ namespace snowboy {
 
 		void SetAudioGain(float gain);
 		void SetMaxAudioAmplitude(float amp);
+		// Applies the gain and the soft clipping to `len` samples in place
+		void Process(float* data, size_t len) const;
 	};
 } // namespace snowboy
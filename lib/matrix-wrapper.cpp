@@ -2,6 +2,8 @@ extern "C"
 {
 #include <cblas.h>
 }
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <matrix-wrapper.h>
@@ -228,8 +230,36 @@ namespace snowboy {
 		throw snowboy_exception{"Not implemented"};
 	}
 
+	void MatrixBase::WriteAligned(std::ostream* os) const {
+		WriteToken(true, "AM", os);
+		WriteBasicType<int32_t>(true, m_rows, os);
+		WriteBasicType<int32_t>(true, m_cols, os);
+		int32_t stride = (m_cols + 3) & ~3;
+		WriteBasicType<int32_t>(true, stride, os);
+		WriteBlobPadding(os);
+		std::vector<float> row(stride, 0.0f);
+		for (size_t r = 0; r < m_rows; r++) {
+			std::copy(data(r), data(r) + m_cols, row.begin());
+			os->write(reinterpret_cast<const char*>(row.data()), stride * sizeof(float));
+		}
+		if (!*os) throw snowboy_exception{"Fail to write Matrix"};
+	}
+
 	void MatrixBase::Write(bool binary, std::ostream* os) const {
-		if (!binary) throw snowboy_exception{"Not implemented"};
+		if (!binary) {
+			if (m_rows == 0) {
+				*os << " [ ]\n";
+			} else {
+				*os << " [";
+				for (size_t r = 0; r < m_rows; r++) {
+					*os << "\n  ";
+					WriteTextValues(data(r), m_cols, os);
+				}
+				*os << "]\n";
+			}
+			if (!*os) throw snowboy_exception{"Fail to write Matrix to stream"};
+			return;
+		}
 		WriteToken(binary, "FM", os);
 		WriteBasicType<int32_t>(binary, m_rows, os);
 		WriteBasicType<int32_t>(binary, m_cols, os);
@@ -263,8 +293,8 @@ namespace snowboy {
 		return false;
 	}
 
-	static size_t allocs = 0;
-	static size_t frees = 0;
+	static std::atomic<size_t> allocs{0};
+	static std::atomic<size_t> frees{0};
 
 	template <typename T>
 	constexpr inline T next_multiple_of(T val, T multi) noexcept {
@@ -334,7 +364,10 @@ namespace snowboy {
 	}
 
 	void Matrix::ReleaseMatrixMemory() {
-		if (m_data) {
+		if (m_mapping) {
+			m_mapping.reset();
+			m_data = nullptr;
+		} else if (m_data) {
 			SnowboyMemalignFree(m_data);
 			frees++;
 		}
@@ -373,7 +406,6 @@ namespace snowboy {
 	}
 
 	void Matrix::Read(bool binary, bool add, std::istream* is) {
-		if (!binary) throw snowboy_exception{"Not implemented"};
 		if (add) {
 			Matrix temp;
 			temp.Read(binary, false, is);
@@ -385,21 +417,65 @@ namespace snowboy {
 				throw snowboy_exception{ss.str()};
 			}
 			AddMat(1.0f, temp, MatrixTransposeType::kNoTrans);
+		} else if (!binary) {
+			// Text matrices have one row per line: " [\n  1 2 3\n  4 5 6 ]"
+			std::vector<float> values;
+			std::vector<size_t> row_lengths;
+			ReadTextBlock<float>(is, &values, &row_lengths);
+			size_t cols = row_lengths.empty() ? 0 : row_lengths.front();
+			for (auto e : row_lengths) {
+				if (e != cols)
+					throw snowboy_exception{"Fail to read Matrix: rows of length " + std::to_string(cols) + " and " + std::to_string(e)};
+			}
+			Resize(row_lengths.size(), cols, MatrixResizeType::kUndefined);
+			for (size_t r = 0; r < m_rows; r++)
+				std::copy(values.begin() + r * cols, values.begin() + (r + 1) * cols, &m_data[r * m_stride]);
 		} else {
-			ExpectToken(binary, "FM", is);
+			auto buffer = dynamic_cast<MemoryStreamBuf*>(is->rdbuf());
+			auto begin = buffer != nullptr ? buffer->Position() : 0;
+			std::string token;
+			ReadToken(binary, &token, is);
 			int32_t rows, cols;
 			ReadBasicType<int32_t>(binary, &rows, is);
 			ReadBasicType<int32_t>(binary, &cols, is);
-			if (m_rows != static_cast<size_t>(rows) || m_cols != static_cast<size_t>(cols)) {
-				Resize(rows, cols, MatrixResizeType::kUndefined);
-			}
-			if (m_stride == m_cols) {
-				is->read(reinterpret_cast<char*>(m_data), m_rows * m_cols * sizeof(float));
-			} else {
-				for (size_t r = 0; r < m_rows; r++) {
-					is->read(reinterpret_cast<char*>(&m_data[r * m_stride]), m_cols * sizeof(float));
+			if (token == "AM") {
+				int32_t stride;
+				ReadBasicType<int32_t>(binary, &stride, is);
+				if (rows < 0 || cols < 0 || stride < cols || stride % 4 != 0)
+					throw snowboy_exception{"Fail to read Matrix: invalid aligned layout " + std::to_string(rows) + " x " + std::to_string(cols) + " stride " + std::to_string(stride)};
+				ReadBlobPadding(is);
+				size_t bytes = static_cast<size_t>(rows) * stride * sizeof(float);
+				if (buffer != nullptr && rows != 0 && cols != 0 && buffer->Remaining() >= bytes
+					&& reinterpret_cast<uintptr_t>(buffer->Current()) % 16 == 0) {
+					// Use the weights in place, the mapping stays alive as long as this matrix refers to it
+					ReleaseMatrixMemory();
+					m_data = reinterpret_cast<float*>(buffer->Current());
+					m_rows = rows;
+					m_cols = cols;
+					m_stride = stride;
+					m_mapping = buffer->File();
+					is->seekg(bytes, std::ios_base::cur);
+				} else {
+					Resize(rows, cols, MatrixResizeType::kUndefined);
+					for (size_t r = 0; r < m_rows; r++) {
+						is->read(reinterpret_cast<char*>(&m_data[r * m_stride]), m_cols * sizeof(float));
+						is->ignore((stride - cols) * sizeof(float));
+					}
 				}
-			}
+			} else if (token == "FM") {
+				if (m_rows != static_cast<size_t>(rows) || m_cols != static_cast<size_t>(cols)) {
+					Resize(rows, cols, MatrixResizeType::kUndefined);
+				}
+				if (m_stride == m_cols) {
+					is->read(reinterpret_cast<char*>(m_data), m_rows * m_cols * sizeof(float));
+				} else {
+					for (size_t r = 0; r < m_rows; r++) {
+						is->read(reinterpret_cast<char*>(&m_data[r * m_stride]), m_cols * sizeof(float));
+					}
+				}
+			} else
+				throw snowboy_exception{"Expected token \"FM\", got instead \"" + token + "\"."};
+			if (buffer != nullptr && *is) buffer->LogBlob(begin, true);
 		}
 		if (!*is) {
 			throw snowboy_exception{"Fail to read Matrix"};
@@ -415,6 +491,7 @@ namespace snowboy {
 		std::swap(m_rows, other->m_rows);
 		std::swap(m_stride, other->m_stride);
 		std::swap(m_data, other->m_data);
+		std::swap(m_mapping, other->m_mapping);
 	}
 
 	void Matrix::Transpose() {
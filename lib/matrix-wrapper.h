@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <matrix-types.h>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -60,10 +61,15 @@ namespace snowboy {
 		void SetUnit();
 		void Transpose();
 		void Write(bool, std::ostream*) const;
+		// Binary only, writes the matrix as a 64 byte aligned blob for model containers
+		void WriteAligned(std::ostream*) const;
 		bool HasNan() const;
 		bool HasInfinity() const;
 	};
 	struct Matrix : MatrixBase {
+		// Set if m_data points into a mapped model container instead of memory owned by this matrix
+		std::shared_ptr<const void> m_mapping;
+
 		Matrix() {}
 		Matrix(const Matrix& other) {
 			Resize(other.m_rows, other.m_cols, MatrixResizeType::kUndefined);
@@ -78,6 +84,7 @@ namespace snowboy {
 			m_cols = other.m_cols;
 			m_stride = other.m_stride;
 			m_data = other.m_data;
+			m_mapping = std::move(other.m_mapping);
 			other.m_rows = 0;
 			other.m_data = nullptr;
 			other.m_stride = 0;
@@ -3,6 +3,7 @@
 #include <nnet-component.h>
 #include <nnet-lib.h>
 #include <set>
+#include <snowboy-error.h>
 #include <snowboy-io.h>
 
 namespace snowboy {
@@ -53,12 +54,34 @@ namespace snowboy {
 		Destroy();
 	}
 
+	void Nnet::ShareComponents(const Nnet& other) {
+		m_pad_input = other.m_pad_input;
+		field_xb = other.field_xb;
+		m_left_context = other.m_left_context;
+		m_right_context = other.m_right_context;
+		m_components = other.m_components;
+		m_chunkinfo.resize(m_components.size() + 1);
+		m_reusable_component_inputs.resize(m_components.size() + 1);
+		ResetComputation();
+	}
+
 	void Nnet::Compute(const MatrixBase& input, const std::vector<FrameInfo>& b, Matrix* output, std::vector<FrameInfo>* d) {
 		if (input.m_rows == 0) {
 			output->Resize(0, 0);
 			d->clear();
 			return;
 		}
+		if (AppendInput(input)) {
+			Propagate();
+			*output = m_output_data;
+			m_output_data.Resize(0, 0);
+		} else {
+			output->Resize(0, 0);
+		}
+		QueueFrameInfo(b, input.m_rows, output->m_rows, d);
+	}
+
+	bool Nnet::AppendInput(const MatrixBase& input) {
 		if (m_is_first_chunk == 0) {
 			m_input_data.Resize(input.m_rows + m_unprocessed_buffer.m_rows, input.m_cols);
 			if (m_unprocessed_buffer.m_rows > 0) {
@@ -89,31 +112,105 @@ namespace snowboy {
 				field_x18 = num_effective_input_rows;
 			}
 			field_b8 = SubVector{m_input_data, m_input_data.rows() - 1};
-			Propagate();
-			*output = m_output_data;
-			m_output_data.Resize(0, 0);
-		} else {
-			m_unprocessed_buffer = m_input_data;
-			field_b8 = SubVector{m_input_data, m_input_data.rows() - 1};
-			m_input_data.Resize(0, 0);
-			output->Resize(0, 0);
+			return true;
 		}
+		m_unprocessed_buffer = m_input_data;
+		field_b8 = SubVector{m_input_data, m_input_data.rows() - 1};
+		m_input_data.Resize(0, 0);
+		return false;
+	}
+
+	void Nnet::QueueFrameInfo(const std::vector<FrameInfo>& b, size_t input_rows, size_t output_rows, std::vector<FrameInfo>* d) {
 		for (auto& frame : b) {
 			field_x20.push_back(frame);
 		}
-		if (field_xc == 0 && m_pad_input == 0 && input.m_rows > 0) {
+		if (field_xc == 0 && m_pad_input == 0 && input_rows > 0) {
 			for (int i = 0; i < m_left_context; i++) {
 				field_x20.pop_front();
 			}
 			field_xc = 1;
 		}
-		d->resize(output->m_rows);
+		d->resize(output_rows);
 		for (auto& e : *d) {
 			e = field_x20.front();
 			field_x20.pop_front();
 		}
 	}
 
+	void Nnet::ComputeBatch(const std::vector<Nnet*>& nets, const std::vector<const MatrixBase*>& inputs,
+							const std::vector<const std::vector<FrameInfo>*>& input_info, std::vector<Matrix>* outputs,
+							std::vector<std::vector<FrameInfo>>* output_info) {
+		outputs->resize(nets.size());
+		output_info->resize(nets.size());
+		std::vector<size_t> active;
+		for (size_t i = 0; i < nets.size(); i++) {
+			if (nets[i]->m_components != nets[0]->m_components)
+				throw snowboy_exception{"networks computed in one batch have to share their components"};
+			(*outputs)[i].Resize(0, 0);
+			if (inputs[i]->m_rows > 0 && nets[i]->AppendInput(*inputs[i])) active.push_back(i);
+		}
+
+		// Components without context transform every frame on its own, so the frames of all networks are stacked
+		// and go through them as one matrix. Splicing needs the context of each network and runs separately.
+		Matrix stacked;
+		bool is_stacked = false;
+		std::vector<size_t> rows(active.size());
+		const auto& components = active.empty() ? nets[0]->m_components : nets[active[0]]->m_components;
+		for (size_t c = 0; c < components.size() && !active.empty(); c++) {
+			if (components[c]->Context().size() > 1) {
+				if (is_stacked) {
+					size_t offset = 0;
+					for (size_t i = 0; i < active.size(); i++) {
+						auto& data = nets[active[i]]->m_input_data;
+						data.Resize(rows[i], stacked.m_cols, MatrixResizeType::kUndefined);
+						data.CopyFromMat(stacked.RowRange(offset, rows[i]), MatrixTransposeType::kNoTrans);
+						offset += rows[i];
+					}
+					is_stacked = false;
+				}
+				for (auto i : active)
+					nets[i]->PropagateComponent(c);
+				continue;
+			}
+			if (!is_stacked) {
+				size_t total = 0;
+				for (size_t i = 0; i < active.size(); i++) {
+					rows[i] = nets[active[i]]->m_input_data.m_rows;
+					total += rows[i];
+				}
+				stacked.Resize(total, components[c]->InputDim(), MatrixResizeType::kUndefined);
+				size_t offset = 0;
+				for (size_t i = 0; i < active.size(); i++) {
+					stacked.RowRange(offset, rows[i]).CopyFromMat(nets[active[i]]->m_input_data, MatrixTransposeType::kNoTrans);
+					nets[active[i]]->m_input_data.Resize(0, 0);
+					offset += rows[i];
+				}
+				is_stacked = true;
+			}
+			Matrix out;
+			components[c]->Propagate(ChunkInfo{static_cast<size_t>(components[c]->InputDim()), 1, 0, stacked.m_rows - 1},
+									 ChunkInfo{static_cast<size_t>(components[c]->OutputDim()), 1, 0, stacked.m_rows - 1}, std::move(stacked), &out);
+			stacked = std::move(out);
+		}
+
+		size_t offset = 0;
+		for (size_t i = 0; i < active.size(); i++) {
+			auto net = nets[active[i]];
+			auto& out = (*outputs)[active[i]];
+			if (is_stacked) {
+				out.Resize(rows[i], stacked.m_cols, MatrixResizeType::kUndefined);
+				out.CopyFromMat(stacked.RowRange(offset, rows[i]), MatrixTransposeType::kNoTrans);
+				offset += rows[i];
+			} else {
+				out = std::move(net->m_output_data);
+			}
+			net->m_output_data.Resize(0, 0);
+			if (net->field_xa == 0) net->field_xa = 1;
+		}
+		for (size_t i = 0; i < nets.size(); i++)
+			nets[i]->QueueFrameInfo(*input_info[i], inputs[i]->m_rows, (*outputs)[i].m_rows, &(*output_info)[i]);
+	}
+
 	// Note: Adopted from kaldi
 	void Nnet::ComputeChunkInfo(int input_chunk_size, int num_chunks) {
 		const size_t output_chunk_size = (input_chunk_size - m_left_context) - m_right_context;
@@ -231,43 +328,46 @@ namespace snowboy {
 	}
 
 	void Nnet::Propagate() {
-		for (size_t c = 0; c < m_components.size(); c++) {
-			auto ctx = m_components[c]->Context();
-			auto inputDim = m_components[c]->InputDim();
-			if (ctx.size() > 1) {
-				auto& rci = m_reusable_component_inputs[c];
-				if (rci.m_rows > 0) {
-					Matrix local_98;
-					local_98.Resize(rci.m_rows + m_input_data.m_rows, inputDim);
-					local_98.RowRange(0, rci.m_rows).CopyFromMat(rci, MatrixTransposeType::kNoTrans);
-					local_98.RowRange(rci.m_rows, m_input_data.m_rows).CopyFromMat(m_input_data, MatrixTransposeType::kNoTrans);
-					m_input_data = std::move(local_98);
-				}
-				rci.Resize(ctx.back() - ctx.front(), inputDim);
-				rci.CopyFromMat(m_input_data.RowRange(m_input_data.m_rows - rci.m_rows, rci.m_rows), MatrixTransposeType::kNoTrans);
-			}
-			m_chunkinfo[c].MakeOffsetsContiguous();
-			m_chunkinfo[c + 1].MakeOffsetsContiguous();
-			auto last_offset = m_chunkinfo[c].GetOffset(m_chunkinfo[c].ChunkSize() - 1);
-			ChunkInfo input_chunk_info{
-				m_chunkinfo[c].NumCols(),
-				m_chunkinfo[c].NumChunks(),
-				last_offset - m_input_data.rows() + 1,
-				last_offset};
-			last_offset = m_chunkinfo[c + 1].GetOffset(m_chunkinfo[c + 1].ChunkSize() - 1);
-			ChunkInfo output_chunk_info{
-				m_chunkinfo[c + 1].NumCols(),
-				m_chunkinfo[c + 1].NumChunks(),
-				last_offset - (m_input_data.rows() - (ctx.back() - ctx.front())) + 1,
-				last_offset};
-			m_components[c]->Propagate(input_chunk_info, output_chunk_info, std::move(m_input_data), &m_output_data);
-			if (c < m_components.size() - 1) {
-				m_input_data = std::move(m_output_data);
-			} else {
-				m_input_data.Resize(0, 0);
+		for (size_t c = 0; c < m_components.size(); c++)
+			PropagateComponent(c);
+		if (field_xa == 0) field_xa = 1;
+	}
+
+	void Nnet::PropagateComponent(size_t c) {
+		auto ctx = m_components[c]->Context();
+		auto inputDim = m_components[c]->InputDim();
+		if (ctx.size() > 1) {
+			auto& rci = m_reusable_component_inputs[c];
+			if (rci.m_rows > 0) {
+				Matrix local_98;
+				local_98.Resize(rci.m_rows + m_input_data.m_rows, inputDim);
+				local_98.RowRange(0, rci.m_rows).CopyFromMat(rci, MatrixTransposeType::kNoTrans);
+				local_98.RowRange(rci.m_rows, m_input_data.m_rows).CopyFromMat(m_input_data, MatrixTransposeType::kNoTrans);
+				m_input_data = std::move(local_98);
 			}
+			rci.Resize(ctx.back() - ctx.front(), inputDim);
+			rci.CopyFromMat(m_input_data.RowRange(m_input_data.m_rows - rci.m_rows, rci.m_rows), MatrixTransposeType::kNoTrans);
+		}
+		m_chunkinfo[c].MakeOffsetsContiguous();
+		m_chunkinfo[c + 1].MakeOffsetsContiguous();
+		auto last_offset = m_chunkinfo[c].GetOffset(m_chunkinfo[c].ChunkSize() - 1);
+		ChunkInfo input_chunk_info{
+			m_chunkinfo[c].NumCols(),
+			m_chunkinfo[c].NumChunks(),
+			last_offset - m_input_data.rows() + 1,
+			last_offset};
+		last_offset = m_chunkinfo[c + 1].GetOffset(m_chunkinfo[c + 1].ChunkSize() - 1);
+		ChunkInfo output_chunk_info{
+			m_chunkinfo[c + 1].NumCols(),
+			m_chunkinfo[c + 1].NumChunks(),
+			last_offset - (m_input_data.rows() - (ctx.back() - ctx.front())) + 1,
+			last_offset};
+		m_components[c]->Propagate(input_chunk_info, output_chunk_info, std::move(m_input_data), &m_output_data);
+		if (c < m_components.size() - 1) {
+			m_input_data = std::move(m_output_data);
+		} else {
+			m_input_data.Resize(0, 0);
 		}
-		if (field_xa == 0) field_xa = 1;
 	}
 
 	void Nnet::ResetComputation() {
@@ -25,13 +25,19 @@ namespace snowboy {
 		// Padding ?
 		std::deque<FrameInfo> field_x20;
 		std::vector<ChunkInfo> m_chunkinfo;
-		std::vector<std::unique_ptr<Component>> m_components;
+		// Shared between the networks of ShareComponents()
+		std::vector<std::shared_ptr<Component>> m_components;
 		std::vector<Matrix> m_reusable_component_inputs;
 		Vector field_b8;
 		Matrix m_unprocessed_buffer;
 		Matrix m_input_data;
 		Matrix m_output_data;
 
+		// Appends `input` to the unprocessed frames, returns true if m_input_data is ready to be propagated
+		bool AppendInput(const MatrixBase& input);
+		void QueueFrameInfo(const std::vector<FrameInfo>& input_info, size_t input_rows, size_t output_rows, std::vector<FrameInfo>* output_info);
+		void PropagateComponent(size_t component);
+
 	public:
 		Nnet();
 		Nnet(bool pad_context);
@@ -39,6 +45,11 @@ namespace snowboy {
 		~Nnet();
 
 		void Compute(const MatrixBase&, const std::vector<FrameInfo>&, Matrix*, std::vector<FrameInfo>*);
+		// Computes several networks sharing their components, e.g. one per audio channel. Every network keeps its own
+		// context, the layers without context evaluate the frames of all networks as one matrix.
+		static void ComputeBatch(const std::vector<Nnet*>& nets, const std::vector<const MatrixBase*>& inputs,
+								 const std::vector<const std::vector<FrameInfo>*>& input_info, std::vector<Matrix>* outputs,
+								 std::vector<std::vector<FrameInfo>>* output_info);
 		void ComputeChunkInfo(int, int);
 		void Destroy();
 		void FlushOutput(const MatrixBase&, const std::vector<FrameInfo>&, Matrix*, std::vector<FrameInfo>*);
@@ -46,6 +57,8 @@ namespace snowboy {
 		int32_t OutputDim() const;
 		void Propagate();
 		void ResetComputation();
+		// Uses the components of `other` instead of copying them and starts a new computation
+		void ShareComponents(const Nnet& other);
 		void SetIndices();
 		void Read(bool binary, std::istream* is);
 		void Write(bool binary, std::ostream* is) const;
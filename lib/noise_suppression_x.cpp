@@ -1,42 +1,170 @@
+#include "msvc_compat.h"
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <frontend-lib.h>
+#include <noise_suppression_x.h>
+#include <tdereverb_x.h>
 
 extern "C"
 {
+	static const int kMaxFftLength = 256;
+	static const int kMaxBins = kMaxFftLength / 2 + 1;
+	// Magnitudes are kept in Q8 of the unnormalized spectrum so blocks of any level compare
+	static const int kMagnQ = 8;
+	// The noise estimate is the running mean over the first blocks, then follows the smoothed magnitude down
+	// quickly and creeps up slowly (about 3.4 dB/s), so it stays near the floor during speech
+	static const int kStartupBlocks = 20;
+	// On stationary noise the estimate settles at about 70% of the mean magnitude, this scales it back (Q8)
+	static const int kNoiseBias = 368;
+	// Per policy: over-subtraction (Q8) and gain floor (Q15)
+	static const int16_t kOverdrive[4] = {256, 256, 282, 320};
+	static const int16_t kGainFloor[4] = {16384, 8192, 4096, 2949};
 
-	extern void TNRx_InitCore(void* param_1, int sample_rate);
-	extern int TNRx_set_policy_core(void* param_1, long param_2);
-	extern int TNRx_set_dereverb_core(void* param_1, long param_2);
-	extern void TNRx_ProcessCore(void* param_1);
-	extern void Delete_TDereverb_x_Params(void*);
+	struct TNRx_Core {
+		int initialized;
+		int block;
+		int fft_length;
+		int stages;
+		int bins;
+		int policy;
+		int blocks;
+		// Analysis and synthesis window in Q15: rises over the overlap, flat, then falls over the overlap
+		int16_t window[kMaxFftLength];
+		int16_t analysis[kMaxFftLength];
+		int16_t synthesis[kMaxFftLength];
+		int16_t fft[2 * kMaxFftLength];
+		int16_t spectrum_gain[2 * kMaxFftLength];
+		uint32_t magn[kMaxBins];
+		int32_t smooth[kMaxBins];
+		int32_t noise[kMaxBins];
+		int16_t gain[kMaxBins];
+		TDereverb_x_Params dereverb;
+	};
 
-	int TNRx_Create(void** param_1) {
-		*param_1 = malloc(0x35f8);
-		if (*param_1 == nullptr) return -1;
-		reinterpret_cast<uint32_t*>(reinterpret_cast<uintptr_t>(*param_1) + 0xc48)[0] = 0;
+	int TNRx_Create(void** inst) {
+		*inst = calloc(1, sizeof(TNRx_Core));
+		if (*inst == nullptr) return -1;
 		return 0;
 	}
 
-	int TNRx_Free(void* param_1) {
-		if (param_1 == nullptr) return -1;
-		Delete_TDereverb_x_Params(reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(param_1) + 0x3550));
-		free(param_1);
+	int TNRx_Free(void* inst) {
+		if (inst == nullptr) return -1;
+		Delete_TDereverb_x_Params(&static_cast<TNRx_Core*>(inst)->dereverb);
+		free(inst);
 		return 0;
 	}
 
-	void TNRx_Init(void* param_1, int sample_rate) {
-		TNRx_InitCore(param_1, sample_rate);
+	int TNRx_Init(void* inst, int sample_rate) {
+		auto s = static_cast<TNRx_Core*>(inst);
+		if (sample_rate != 8000 && sample_rate != 16000) return -1;
+		auto dereverb = s->dereverb;
+		memset(s, 0, sizeof(TNRx_Core));
+		s->dereverb = dereverb;
+		s->block = sample_rate / 100;
+		s->stages = sample_rate == 8000 ? 7 : 8;
+		s->fft_length = 1 << s->stages;
+		s->bins = s->fft_length / 2 + 1;
+		s->policy = 0;
+		const int overlap = s->fft_length - s->block;
+		for (int i = 0; i < s->fft_length; i++) {
+			double w = 1.0;
+			if (i < overlap)
+				w = sin(M_PI * (i + 0.5) / (2 * overlap));
+			else if (i >= s->block)
+				w = cos(M_PI * (i - s->block + 0.5) / (2 * overlap));
+			s->window[i] = static_cast<int16_t>(lround(w * 32767));
+		}
+		for (int k = 0; k < s->bins; k++)
+			s->gain[k] = 32767;
+		if (Init_TDereverb_x_Params(&s->dereverb, s->bins) != 0) return -1;
+		s->initialized = 1;
+		return 0;
+	}
+
+	int TNRx_set_policy(void* inst, long policy) {
+		if (policy < 0 || policy > 3) return -1;
+		static_cast<TNRx_Core*>(inst)->policy = policy;
+		return 0;
+	}
+
+	int TNRx_set_dereverb(void* inst, long power) {
+		return Set_TDereverb_x_Power(&static_cast<TNRx_Core*>(inst)->dereverb, power);
 	}
 
-	int TNRx_set_policy(void* param_1, long param_2) {
-		return TNRx_set_policy_core(param_1, param_2);
+	static void UpdateNoise(TNRx_Core* s) {
+		for (int k = 0; k < s->bins; k++) {
+			int32_t magn = static_cast<int32_t>(s->magn[k]);
+			s->smooth[k] += (magn - s->smooth[k]) >> 1;
+			int32_t smooth = s->smooth[k];
+			int32_t& noise = s->noise[k];
+			if (s->blocks < kStartupBlocks)
+				noise += (magn - noise) / (s->blocks + 1);
+			else if (smooth > noise)
+				noise += (noise >> 8) + 1;
+			else
+				noise -= (noise - smooth) >> 3;
+			if (noise < 0) noise = 0;
+		}
+		if (s->blocks < kStartupBlocks) s->blocks++;
 	}
 
-	int TNRx_set_dereverb(void* param_1, long param_2) {
-		return TNRx_set_dereverb_core(param_1, param_2);
+	static void ComputeGains(TNRx_Core* s) {
+		const int64_t overdrive = (kOverdrive[s->policy] * kNoiseBias) >> 8;
+		const int16_t floor = kGainFloor[s->policy];
+		for (int k = 0; k < s->bins; k++) {
+			int64_t noise = (s->noise[k] * overdrive) >> 8;
+			int32_t g = static_cast<int64_t>(s->magn[k]) <= noise ? 0 : 32767 - static_cast<int32_t>((noise << 15) / s->magn[k]);
+			if (g < floor) g = floor;
+			// Gains rise at once so onsets are kept, and fall smoothly against musical noise
+			s->gain[k] = static_cast<int16_t>(g >= s->gain[k] ? g : (s->gain[k] + g) >> 1);
+		}
+		Process_TDereverb_x(&s->dereverb, s->magn, s->gain);
 	}
 
-	void TNRx_Process(void* param_1) {
-		TNRx_ProcessCore(param_1);
+	void TNRx_Process(void* inst, const int16_t* in, int16_t* out) {
+		auto s = static_cast<TNRx_Core*>(inst);
+		const int n = s->fft_length, overlap = n - s->block;
+		int16_t frame[kMaxFftLength];
+
+		memmove(s->analysis, s->analysis + s->block, overlap * sizeof(int16_t));
+		memcpy(s->analysis + overlap, in, s->block * sizeof(int16_t));
+		TSpl_ScaleVectorW16(s->analysis, s->window, frame, n, 15);
+
+		// Use the full 16 bits for the transform and undo it on the magnitudes and the output
+		const int norm = TSpl_NormW16(TSpl_MaxAbsValueW16(frame, n));
+		for (int i = 0; i < n; i++) {
+			s->fft[2 * i] = static_cast<int16_t>(frame[i] * (1 << norm));
+			s->fft[2 * i + 1] = 0;
+		}
+		TSpl_ComplexBitReverse(s->fft, s->stages);
+		TSpl_ComplexFFT(s->fft, s->stages, 1);
+		TSpl_ComplexSquaredMagnitude(s->fft, s->magn, s->bins);
+		for (int k = 0; k < s->bins; k++)
+			s->magn[k] = (TSpl_SqrtFloor(s->magn[k]) << kMagnQ) >> norm;
+
+		UpdateNoise(s);
+		ComputeGains(s);
+
+		// The spectrum of a real signal is symmetric, bin n - k gets the gain of bin k
+		for (int k = 0; k < s->bins; k++)
+			s->spectrum_gain[2 * k] = s->spectrum_gain[2 * k + 1] = s->gain[k];
+		for (int k = s->bins; k < n; k++)
+			s->spectrum_gain[2 * k] = s->spectrum_gain[2 * k + 1] = s->gain[n - k];
+		TSpl_ScaleVectorW16(s->fft, s->spectrum_gain, s->fft, 2 * n, 15);
+		TSpl_ComplexBitReverse(s->fft, s->stages);
+		const int shift = TSpl_ComplexIFFT(s->fft, s->stages, 1) - norm;
+		for (int i = 0; i < n; i++) {
+			int32_t v = s->fft[2 * i];
+			frame[i] = shift >= 0 ? TSpl_SatW32ToW16(v * (1 << shift)) : static_cast<int16_t>(v >> -shift);
+		}
+
+		// Overlap add, the first block of the synthesis buffer is complete
+		TSpl_ScaleVectorW16(frame, s->window, frame, n, 15);
+		TSpl_AddSatVectorW16(s->synthesis, frame, s->synthesis, n);
+		memcpy(out, s->synthesis, s->block * sizeof(int16_t));
+		memmove(s->synthesis, s->synthesis + s->block, overlap * sizeof(int16_t));
+		memset(s->synthesis + overlap, 0, s->block * sizeof(int16_t));
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+extern "C"
+{
+	// Fixed point spectral noise suppression on 10 ms blocks of 8 or 16 kHz audio
+	int TNRx_Create(void** inst);
+	int TNRx_Free(void* inst);
+	int TNRx_Init(void* inst, int sample_rate);
+	int TNRx_set_policy(void* inst, long policy);
+	int TNRx_set_dereverb(void* inst, long power);
+	// Processes one block, the output is delayed by the overlap of the analysis frames (6 ms). In place is fine.
+	void TNRx_Process(void* inst, const int16_t* in, int16_t* out);
+}
@@ -1,33 +1,30 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <noise_suppression_x.h>
+#include <ns3.h>
 
 extern "C"
 {
-	extern int TNRx_Create(void** param_1);
-	extern int TNRx_Free(void* param_1);
-	extern void TNRx_Init(void* param_1, int sample_rate);
-	extern int TNRx_set_policy(void* param_1, long param_2);
-	extern int TNRx_set_dereverb(void* param_1, long param_2);
-	extern void TNRx_Process(void* param_1);
-
 	struct NS3_Instance {
 		void* m_tnrx_instance;
-		short m_unknown;
+		short m_block_size;
 	};
-	//static_assert(sizeof(NS3_Instance) == 0x10);
 
-	NS3_Instance* NS3_Init(int sample_rate /* probably */, int unknown1, int* unknown2 /* status? */) {
-		if ((sample_rate == 8000 || sample_rate == 16000 || sample_rate == 32000 || sample_rate == 48000)
-			&& (unknown1 == 0x50 || unknown1 == 0xa0 || unknown1 == 0x140 || unknown1 == 0x1e0)) {
+	NS3_Instance* NS3_Init(int sample_rate, int block_size, int* status) {
+		if ((sample_rate == 8000 || sample_rate == 16000) && block_size == sample_rate / 100) {
 			auto res = new NS3_Instance{};
-			TNRx_Create(&res->m_tnrx_instance);
-			TNRx_Init(res->m_tnrx_instance, sample_rate);
+			if (TNRx_Create(&res->m_tnrx_instance) != 0 || TNRx_Init(res->m_tnrx_instance, sample_rate) != 0) {
+				NS3_Exit(res);
+				*status = 3;
+				return nullptr;
+			}
 			TNRx_set_policy(res->m_tnrx_instance, 1);
-			res->m_unknown = unknown1;
-			*unknown2 = 1;
+			res->m_block_size = block_size;
+			*status = 1;
 			return res;
 		}
+		*status = 4;
 		return nullptr;
 	}
 
@@ -37,8 +34,9 @@ extern "C"
 		return 1;
 	}
 
-	int NS3_Process(NS3_Instance* instance) {
-		TNRx_Process(instance->m_tnrx_instance);
+	int NS3_Process(NS3_Instance* instance, const short* in, short* out) {
+		if (instance == nullptr) return 2;
+		TNRx_Process(instance->m_tnrx_instance, in, out);
 		return 1;
 	}
 
@@ -46,12 +44,10 @@ extern "C"
 		if (instance == nullptr) return 2;
 		if (strcmp(property, "NS_Power") == 0) {
 			auto val = strtol(value, nullptr, 10);
-			TNRx_set_policy(instance->m_tnrx_instance, 1);
-			if (TNRx_set_policy(instance->m_tnrx_instance, val & 0xffffffff) == -1) return 4;
+			if (TNRx_set_policy(instance->m_tnrx_instance, val) == -1) return 4;
 		} else if (strcmp(property, "DR_Power") == 0) {
 			auto val = strtol(value, nullptr, 10);
-			TNRx_set_dereverb(instance->m_tnrx_instance, 0);
-			if (TNRx_set_dereverb(instance->m_tnrx_instance, val & 0xffffffff) == -1) return 4;
+			if (TNRx_set_dereverb(instance->m_tnrx_instance, val) == -1) return 4;
 		} else
 			return 4;
 		return 1;
@@ -3,8 +3,10 @@
 extern "C"
 {
 	struct NS3_Instance;
-	NS3_Instance* NS3_Init(int sample_rate /* probably */, int unknown1, int* unknown2 /* status? */);
+	// Returns nullptr and sets `status` to something other than 1 for unsupported rates, `block_size` has to be 10 ms
+	NS3_Instance* NS3_Init(int sample_rate, int block_size, int* status);
 	int NS3_Exit(NS3_Instance* instance);
-	int NS3_Process(NS3_Instance* instance);
+	// Suppresses the noise of one block, `in` and `out` may be the same
+	int NS3_Process(NS3_Instance* instance, const short* in, short* out);
 	int NS3_SetPara(NS3_Instance* instance, const char* property, const char* value);
-}
\ No newline at end of file
+}
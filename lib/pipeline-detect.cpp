@@ -1,25 +1,94 @@
+#include <algorithm>
+#include <channel-mix-stream.h>
 #include <eavesdrop-stream.h>
+#include <energy-gate-stream.h>
 #include <fft-stream.h>
 #include <framer-stream.h>
 #include <frontend-stream.h>
 #include <gain-control-stream.h>
 #include <intercept-stream.h>
 #include <license-lib.h>
+#include <limits>
+#include <map>
 #include <mfcc-stream.h>
+#include <nnet-lib.h>
 #include <nnet-stream.h>
 #include <pipeline-detect.h>
+#include <pipeline-lib.h>
 #include <raw-energy-vad-stream.h>
 #include <raw-nnet-vad-stream.h>
+#include <resample-stream.h>
+#include <snowboy-detect.h>
 #include <snowboy-error.h>
 #include <snowboy-io.h>
 #include <snowboy-options.h>
 #include <sstream>
 #include <template-detect-stream.h>
 #include <universal-detect-stream.h>
+#include <vad-lib.h>
 #include <vad-state-stream.h>
 
 namespace snowboy {
 
+	// Audio passed to RunDetection() while a score trace is recorded and the network outputs of the universal models for
+	// it. A detection resets the pipeline, so besides the outputs of the whole audio the outputs of the audio following
+	// each chunk a detection happened in are recorded on demand, as far as an evaluation reads them. If min_rerun_seconds
+	// is not 0 a segment ends at the first chunk after that much audio whose outputs match those of the whole audio.
+	struct PipelineDetect::ScoreTrace {
+		struct Segment {
+			std::vector<UniversalDetectStream::ScoreTraceBatch> batches;
+			// Chunk each batch was read from
+			std::vector<size_t> batch_chunk;
+			// Frame counter of the framer when the segment starts and after each of its chunks
+			unsigned int first_frame_counter = 1;
+			std::vector<unsigned int> frame_counter;
+			// First chunk the segment is not run for, it continues with the outputs of the whole audio from there on
+			size_t last_chunk = 0;
+		};
+		float min_rerun_seconds = 0;
+		// Segment the state of the pipeline belongs to
+		size_t active_segment = 0;
+		std::vector<Matrix> chunks;
+		std::vector<bool> is_end;
+		// Segments by their first chunk, segment 0 is the whole audio
+		std::map<size_t, Segment> segments;
+
+		// Whether the segment starting at `first_chunk` read the same frames with the same network outputs and VAD
+		// flags as the whole audio in `chunk`
+		bool MatchesWholeAudio(size_t first_chunk, size_t chunk) const {
+			auto& seg = segments.at(first_chunk);
+			auto& whole = segments.at(0);
+			// The same audio gives frames whose ids differ by the difference of the frame counters
+			const auto offset = seg.frame_counter[chunk - first_chunk] - whole.frame_counter[chunk];
+			auto a = std::equal_range(seg.batch_chunk.begin(), seg.batch_chunk.end(), chunk);
+			auto b = std::equal_range(whole.batch_chunk.begin(), whole.batch_chunk.end(), chunk);
+			if (a.second - a.first != b.second - b.first) return false;
+			size_t rows = 0;
+			for (auto i = a.first - seg.batch_chunk.begin(), j = b.first - whole.batch_chunk.begin(); i != a.second - seg.batch_chunk.begin(); i++, j++) {
+				auto& x = seg.batches[i];
+				auto& y = whole.batches[j];
+				if (x.signal != y.signal || x.outputs.size() != y.outputs.size()) return false;
+				for (size_t m = 0; m < x.outputs.size(); m++) {
+					auto& xo = x.outputs[m];
+					auto& yo = y.outputs[m];
+					if (xo.m_rows != yo.m_rows || xo.m_cols != yo.m_cols || x.info[m].size() != y.info[m].size()) return false;
+					for (size_t r = 0; r < xo.m_rows; r++) {
+						if (!std::equal(xo.data(r), xo.data(r) + xo.m_cols, yo.data(r))) return false;
+					}
+					for (size_t f = 0; f < x.info[m].size(); f++) {
+						auto& xi = x.info[m][f];
+						auto& yi = y.info[m][f];
+						if (xi.flags != yi.flags || (xi.frame_id == 0) != (yi.frame_id == 0)) return false;
+						if (xi.frame_id != 0 && xi.frame_id - yi.frame_id != offset) return false;
+						rows += xi.frame_id != 0;
+					}
+				}
+			}
+			// A chunk without frames says nothing about the frames the VAD still holds back
+			return rows != 0;
+		}
+	};
+
 	void PipelineDetectOptions::Register(const std::string& prefix, OptionsItf* opts) {
 		opts->Register(prefix, "sample-rate", "Sampling rate.", &sampleRate);
 		opts->Register(prefix, "apply-frontend", "If true, apply VQE frontend.", &applyFrontend);
@@ -38,6 +107,7 @@ namespace snowboy {
 		m_framerStreamOptions->Register(prefix + "framer", opts);
 		m_rawEnergyVadStreamOptions->Register(prefix + "vadr1", opts);
 		m_vadStateStreamOptions->Register(prefix + "vads1", opts);
+		m_energyGateStreamOptions->Register(prefix + "gate", opts);
 		m_fftStreamOptions->Register(prefix + "fft", opts);
 		m_mfccStreamOptions->Register(prefix + "mfcc", opts);
 		m_rawNnetVadStreamOptions->Register(prefix + "vadr2", opts);
@@ -79,16 +149,10 @@ namespace snowboy {
 		m_rawNnetVadStream.reset(new RawNnetVadStream{*m_rawNnetVadStreamOptions});
 		m_eavesdropStream.reset(new EavesdropStream{nullptr, &m_eavesdropStreamFrameInfoVector});
 		m_vadStateStream2.reset(new VadStateStream{*m_vadStateStream2Options});
-		if (m_templateDetectStreamOptions->model_str != "") {
-			m_templateDetectInterceptStream.reset(new InterceptStream{});
-			m_templateDetectNnetStream.reset(new NnetStream{*m_templateDetectNnetStreamOptions});
-			m_templateDetectStream.reset(new TemplateDetectStream{*m_templateDetectStreamOptions});
-		}
-		if (m_universalDetectStreamOptions->model_str != "") {
-			m_universalDetectInterceptStream.reset(new InterceptStream{});
-			m_universalDetectStream.reset(new UniversalDetectStream{*m_universalDetectStreamOptions});
-		}
-		m_gainControlStream->Connect(m_interceptStream.get());
+		DetectStreams streams;
+		CreateDetectStreams(*m_templateDetectStreamOptions, *m_universalDetectStreamOptions, m_is_personal_model, &streams);
+		SwapDetectStreams(&streams);
+		ConnectInputStreams();
 		if (!m_frontend_enabled) {
 			m_framerStream->Connect(m_gainControlStream.get());
 		} else {
@@ -97,51 +161,84 @@ namespace snowboy {
 		}
 		m_rawEnergyVadStream->Connect(m_framerStream.get());
 		m_vadStateStream->Connect(m_rawEnergyVadStream.get());
-		m_fftStream->Connect(m_vadStateStream.get());
 		m_mfccStream->Connect(m_fftStream.get());
 		m_rawNnetVadStream->Connect(m_mfccStream.get());
 		m_eavesdropStream->Connect(m_rawNnetVadStream.get());
 		m_vadStateStream2->Connect(m_eavesdropStream.get());
 		m_vadStateStream->field_x2c = 1;
 		m_vadStateStream->field_x2c = 2;
-		if (m_templateDetectStream) {
-			m_templateDetectNnetStream->Connect(m_templateDetectInterceptStream.get());
-			m_templateDetectStream->Connect(m_templateDetectNnetStream.get());
+		// The dropped frames in front of speech have to fill the look-back of the second VAD state stream, with the
+		// context of the VAD network on top
+		m_energyGateStreamOptions->look_back_frames =
+			std::max<uint32_t>(m_energyGateStreamOptions->look_back_frames, m_vadStateStream2->field_x28 + m_rawNnetVadStream->m_nnet->LeftContext()
+																				+ m_rawNnetVadStream->m_nnet->RightContext());
+		ConnectEnergyGate();
+		m_model_files.clear();
+		m_isInitialized = true;
+		return true;
+	}
+
+	void PipelineDetect::CreateDetectStreams(const TemplateDetectStreamOptions& personal_options, const UniversalDetectStreamOptions& universal_options,
+											 const std::vector<bool>& is_personal_model, DetectStreams* streams) const {
+		if (personal_options.model_str != "") {
+			streams->templateDetectInterceptStream.reset(new InterceptStream{});
+			streams->templateDetectNnetStream.reset(new NnetStream{*m_templateDetectNnetStreamOptions});
+			streams->templateDetectStream.reset(new TemplateDetectStream{personal_options});
+			streams->templateDetectNnetStream->Connect(streams->templateDetectInterceptStream.get());
+			streams->templateDetectStream->Connect(streams->templateDetectNnetStream.get());
 		}
-		if (m_universalDetectStream) {
-			m_universalDetectStream->Connect(m_universalDetectInterceptStream.get());
+		if (universal_options.model_str != "") {
+			streams->universalDetectInterceptStream.reset(new InterceptStream{});
+			streams->universalDetectStream.reset(new UniversalDetectStream{universal_options});
+			streams->universalDetectStream->Connect(streams->universalDetectInterceptStream.get());
 		}
 		int npersonal = 0;
 		int nuniversal = 0;
 		int kwid = 1;
-		for (size_t i = 0; i < m_is_personal_model.size(); i++) {
-			if (m_is_personal_model[i] == false) {
-				for (size_t x = 0; x < m_universalDetectStream->NumHotwords(nuniversal); x++) {
-					m_universal_kw_mapping.push_back(kwid);
+		for (size_t i = 0; i < is_personal_model.size(); i++) {
+			if (is_personal_model[i] == false) {
+				for (size_t x = 0; x < streams->universalDetectStream->NumHotwords(nuniversal); x++) {
+					streams->universal_kw_mapping.push_back(kwid);
 					kwid++;
 				}
 				nuniversal++;
 			} else {
-				for (size_t x = 0; x < m_templateDetectStream->NumHotwords(npersonal); x++) {
-					m_personal_kw_mapping.push_back(kwid);
+				for (size_t x = 0; x < streams->templateDetectStream->NumHotwords(npersonal); x++) {
+					streams->personal_kw_mapping.push_back(kwid);
 					kwid++;
 				}
 				npersonal++;
 			}
 		}
-		m_isInitialized = true;
-		return true;
+		// Frame scores carry the ids RunDetection() returns, so they can be matched to detections
+		if (streams->templateDetectStream) streams->templateDetectStream->m_frame_score_hotwords = streams->personal_kw_mapping;
+		if (streams->universalDetectStream) streams->universalDetectStream->m_frame_score_hotwords = streams->universal_kw_mapping;
+	}
+
+	void PipelineDetect::SwapDetectStreams(DetectStreams* streams) {
+		std::swap(m_templateDetectInterceptStream, streams->templateDetectInterceptStream);
+		std::swap(m_templateDetectNnetStream, streams->templateDetectNnetStream);
+		std::swap(m_templateDetectStream, streams->templateDetectStream);
+		std::swap(m_universalDetectInterceptStream, streams->universalDetectInterceptStream);
+		std::swap(m_universalDetectStream, streams->universalDetectStream);
+		std::swap(m_personal_kw_mapping, streams->personal_kw_mapping);
+		std::swap(m_universal_kw_mapping, streams->universal_kw_mapping);
+		if (m_templateDetectStream) m_templateDetectStream->m_frame_score_sink = m_frame_score_sink;
+		if (m_universalDetectStream) m_universalDetectStream->m_frame_score_sink = m_frame_score_sink;
 	}
 
 	bool PipelineDetect::Reset() {
 		CheckSnowboyLicense();
 		if (m_isInitialized) {
 			m_interceptStream->Reset();
+			if (m_channelMixStream) m_channelMixStream->Reset();
+			if (m_resampleStream) m_resampleStream->Reset();
 			m_gainControlStream->Reset();
 			m_frontendStream->Reset();
 			m_framerStream->Reset();
 			m_rawEnergyVadStream->Reset();
 			m_vadStateStream->Reset();
+			if (m_energyGateStream) m_energyGateStream->Reset();
 			m_fftStream->Reset();
 			m_mfccStream->Reset();
 			m_rawNnetVadStream->Reset();
@@ -156,6 +253,22 @@ namespace snowboy {
 				m_universalDetectInterceptStream->Reset();
 				m_universalDetectStream->Reset();
 			}
+			for (auto& e : m_channel_streams) {
+				e->interceptStream->Reset();
+				e->gainControlStream->Reset();
+				e->frontendStream->Reset();
+				e->framerStream->Reset();
+				e->rawEnergyVadStream->Reset();
+				e->vadStateStream->Reset();
+				if (e->energyGateStream) e->energyGateStream->Reset();
+				e->fftStream->Reset();
+				e->mfccStream->Reset();
+				e->rawNnetVadStream->Reset();
+				e->eavesdropStream->Reset();
+				e->vadStateStream2->Reset();
+				e->eavesdropStreamFrameInfoVector.clear();
+				e->silence = true;
+			}
 		}
 		m_eavesdropStreamFrameInfoVector.clear();
 		field_x168 = true;
@@ -201,6 +314,7 @@ namespace snowboy {
 		m_vadStateStreamOptions->min_voice_frames = 10;
 		m_vadStateStreamOptions->remove_non_voice = false;
 		m_vadStateStreamOptions->extra_frame_adjust = 20;
+		m_energyGateStreamOptions.reset(new EnergyGateStreamOptions{});
 		m_fftStreamOptions.reset(new FftStreamOptions{});
 		m_fftStreamOptions->num_fft_points = -1;
 		m_fftStreamOptions->method = "srfft";
@@ -263,29 +377,167 @@ namespace snowboy {
 				m_frontendStream->Connect(m_gainControlStream.get());
 				m_framerStream->Connect(m_frontendStream.get());
 			}
+			for (auto& e : m_channel_streams) {
+				if (apply == false) {
+					e->framerStream->Connect(e->gainControlStream.get());
+				} else {
+					e->frontendStream->Connect(e->gainControlStream.get());
+					e->framerStream->Connect(e->frontendStream.get());
+				}
+			}
+		}
+	}
+
+	void PipelineDetect::SetInputSampleRate(int sample_rate) {
+		if (sample_rate <= 0) throw snowboy_exception{"input sample rate must be positive"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		m_input_sample_rate = sample_rate;
+		if (m_isInitialized) ConnectInputStreams();
+	}
+
+	void PipelineDetect::SetChannelMix(const std::string& method) {
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		if (method == "separate") {
+			if (m_score_trace)
+				throw snowboy_exception{"per-channel detection can not be enabled while a score trace is recorded"};
+			if (m_templateDetectStream)
+				throw snowboy_exception{"per-channel detection is only supported for universal models"};
+		} else {
+			// Checks the method before anything is changed
+			ChannelMixStreamOptions options;
+			options.method = method;
+			ChannelMixStream check{options};
+		}
+		m_channel_mix = method;
+		m_channel_streams.clear();
+		if (m_universalDetectStream) m_universalDetectStream->SetNumChannels(1);
+		if (m_isInitialized) ConnectInputStreams();
+	}
+
+	void PipelineDetect::SetPowerSaving(bool enable) {
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		m_power_saving = enable;
+		if (!m_isInitialized) return;
+		ConnectEnergyGate();
+		// Created again with or without gates by the next RunDetection()
+		m_channel_streams.clear();
+	}
+
+	uint64_t PipelineDetect::GetPowerSavingSkippedFrames() const {
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		uint64_t res = m_energyGateStream ? m_energyGateStream->SkippedFrames() : 0;
+		for (auto& e : m_channel_streams)
+			if (e->energyGateStream) res += e->energyGateStream->SkippedFrames();
+		return res;
+	}
+
+	void PipelineDetect::ConnectEnergyGate() {
+		if (!m_power_saving) {
+			m_energyGateStream.reset();
+			m_fftStream->Connect(m_vadStateStream.get());
+			return;
+		}
+		m_energyGateStream.reset(new EnergyGateStream{*m_energyGateStreamOptions});
+		m_energyGateStream->Connect(m_vadStateStream.get());
+		m_fftStream->Connect(m_energyGateStream.get());
+	}
+
+	void PipelineDetect::ConnectInputStreams() {
+		const auto input_rate = m_input_sample_rate != 0 ? m_input_sample_rate : m_pipelineDetectOptions.sampleRate;
+		StreamItf* input = m_interceptStream.get();
+		if (m_channel_mix == "separate") {
+			// The channels are split after resampling, see RunChannelDetectionLocked()
+			m_channelMixStream.reset();
+		} else {
+			ChannelMixStreamOptions mix_options;
+			mix_options.sample_rate = input_rate;
+			mix_options.method = m_channel_mix;
+			m_channelMixStream.reset(new ChannelMixStream{mix_options});
+			m_channelMixStream->Connect(m_interceptStream.get());
+			input = m_channelMixStream.get();
+		}
+		if (input_rate == m_pipelineDetectOptions.sampleRate) {
+			m_gainControlStream->Connect(input);
+			m_resampleStream.reset();
+			return;
+		}
+		ResampleStreamOptions options;
+		options.input_sample_rate = input_rate;
+		options.output_sample_rate = m_pipelineDetectOptions.sampleRate;
+		m_resampleStream.reset(new ResampleStream{options});
+		m_resampleStream->Connect(input);
+		m_gainControlStream->Connect(m_resampleStream.get());
+	}
+
+	void PipelineDetect::CreateChannelStreams(size_t num_channels) {
+		m_channel_streams.clear();
+		for (size_t c = 0; c < num_channels; c++) {
+			std::unique_ptr<ChannelStreams> e{new ChannelStreams{}};
+			e->interceptStream.reset(new InterceptStream{});
+			// Copied to keep the gain and amplitude set on the pipeline
+			e->gainControlStream.reset(new GainControlStream{*m_gainControlStream});
+			e->frontendStream.reset(new FrontendStream{*m_frontendStreamOptions});
+			e->framerStream.reset(new FramerStream{*m_framerStreamOptions});
+			e->rawEnergyVadStream.reset(new RawEnergyVadStream{*m_rawEnergyVadStreamOptions});
+			e->vadStateStream.reset(new VadStateStream{*m_vadStateStreamOptions});
+			e->fftStream.reset(new FftStream{*m_fftStreamOptions});
+			e->mfccStream.reset(new MfccStream{*m_mfccStreamOptions});
+			e->rawNnetVadStream.reset(new RawNnetVadStream{*m_rawNnetVadStreamOptions});
+			e->eavesdropStream.reset(new EavesdropStream{nullptr, &e->eavesdropStreamFrameInfoVector});
+			e->vadStateStream2.reset(new VadStateStream{*m_vadStateStream2Options});
+			e->gainControlStream->Connect(e->interceptStream.get());
+			if (!m_frontend_enabled) {
+				e->framerStream->Connect(e->gainControlStream.get());
+			} else {
+				e->frontendStream->Connect(e->gainControlStream.get());
+				e->framerStream->Connect(e->frontendStream.get());
+			}
+			e->rawEnergyVadStream->Connect(e->framerStream.get());
+			e->vadStateStream->Connect(e->rawEnergyVadStream.get());
+			if (!m_power_saving) {
+				e->fftStream->Connect(e->vadStateStream.get());
+			} else {
+				e->energyGateStream.reset(new EnergyGateStream{*m_energyGateStreamOptions});
+				e->energyGateStream->Connect(e->vadStateStream.get());
+				e->fftStream->Connect(e->energyGateStream.get());
+			}
+			e->mfccStream->Connect(e->fftStream.get());
+			e->rawNnetVadStream->Connect(e->mfccStream.get());
+			e->eavesdropStream->Connect(e->rawNnetVadStream.get());
+			e->vadStateStream2->Connect(e->eavesdropStream.get());
+			e->vadStateStream->field_x2c = 2;
+			m_channel_streams.push_back(std::move(e));
 		}
 	}
 
 	void PipelineDetect::ClassifyModels(const std::string& model_str, std::string* personal_models, std::string* universal_models) {
+		ClassifyModels(model_str, personal_models, universal_models, &m_is_personal_model, &m_model_files);
+	}
+
+	void PipelineDetect::ClassifyModels(const std::string& model_str, std::string* personal_models, std::string* universal_models,
+										std::vector<bool>* is_personal_model, std::vector<std::shared_ptr<const MappedFile>>* model_files) const {
 		personal_models->clear();
 		universal_models->clear();
 		std::vector<std::string> parts;
 		SplitStringToVector(model_str, global_snowboy_string_delimiter, &parts);
-		m_is_personal_model.resize(parts.size(), false);
+		is_personal_model->resize(parts.size(), false);
+		model_files->clear();
 		for (size_t i = 0; i < parts.size(); i++) {
+			UpdateModelCache(parts[i]);
+			model_files->push_back(PinMappedFile(parts[i]));
 			if (ClassifyModel(parts[i])) {
 				if (!personal_models->empty()) personal_models->append(",");
 				personal_models->append(parts[i]);
-				m_is_personal_model[i] = true;
+				(*is_personal_model)[i] = true;
 			} else {
 				if (!universal_models->empty()) universal_models->append(",");
 				universal_models->append(parts[i]);
-				m_is_personal_model[i] = false;
+				(*is_personal_model)[i] = false;
 			}
 		}
 	}
 
-	bool PipelineDetect::ClassifyModel(const std::string& model_filename) {
+	bool PipelineDetect::ClassifyModel(const std::string& model_filename) const {
 		Input in{model_filename};
 		auto binary = in.is_binary();
 		auto is = in.Stream();
@@ -332,6 +584,7 @@ namespace snowboy {
 	uint64_t PipelineDetect::GetDetectedFrameId() const {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 
 		int id = 0;
 		if (m_universalDetectStream) {
@@ -343,9 +596,39 @@ namespace snowboy {
 		return id;
 	}
 
+	uint64_t PipelineDetect::GetLastDetectionFrameId() const {
+		return m_last_detection_frame_id;
+	}
+
+	float PipelineDetect::GetLastDetectionScore() const {
+		return m_last_detection_score;
+	}
+
+	int PipelineDetect::GetLastDetectionChannel() const {
+		return m_last_detection_channel;
+	}
+
+	std::vector<float> PipelineDetect::GetModelLoadTimes() const {
+		if (!m_isInitialized)
+			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+
+		std::vector<float> res;
+		size_t npersonal = 0;
+		size_t nuniversal = 0;
+		for (size_t i = 0; i < m_is_personal_model.size(); i++) {
+			if (m_is_personal_model[i])
+				res.push_back(m_templateDetectStream->m_model_load_ms[npersonal++]);
+			else
+				res.push_back(m_universalDetectStream->m_model_load_ms[nuniversal++]);
+		}
+		return res;
+	}
+
 	std::string PipelineDetect::GetSensitivity() const {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 
 		std::vector<std::string> personal;
 		std::vector<std::string> universal;
@@ -370,6 +653,7 @@ namespace snowboy {
 	int PipelineDetect::NumHotwords() const {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 
 		int num_hotwords = 0;
 		if (m_templateDetectStream) num_hotwords += m_templateDetectStream->m_models.size();
@@ -382,6 +666,20 @@ namespace snowboy {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
 
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		if (m_score_trace) {
+			// Recording the segments of an evaluation left the pipeline in the state of their audio
+			if (m_score_trace->segments.size() != 1)
+				throw snowboy_exception{"audio can not be added to a score trace after it has been evaluated"};
+			m_score_trace->chunks.push_back(data);
+			m_score_trace->is_end.push_back(is_end);
+			return RunScoreTraceChunk(0, m_score_trace->chunks.size() - 1);
+		}
+		return RunDetectionLocked(data, is_end);
+	}
+
+	int PipelineDetect::RunDetectionLocked(const MatrixBase& data, bool is_end) {
+		if (m_channel_mix == "separate" && data.m_rows > 1) return RunChannelDetectionLocked(data, is_end);
 		std::vector<FrameInfo> info;
 		info.resize(data.m_rows);
 		m_interceptStream->SetData(data, info, static_cast<SnowboySignal>(is_end ? 0x30 : 0x20));
@@ -389,6 +687,8 @@ namespace snowboy {
 		while (x == 0) {
 			Matrix tmat;
 			std::vector<FrameInfo> tinfo;
+			// Only silence the VAD network would not hear voice in is skipped
+			if (m_energyGateStream) m_energyGateStream->AllowSkipping(!m_vadStateStream2->m_vadstate->m_field_x10);
 			auto tres = m_vadStateStream2->Read(&tmat, &tinfo);
 			m_rawEnergyVadStream->UpdateBackgroundEnergy(m_eavesdropStreamFrameInfoVector);
 			m_eavesdropStreamFrameInfoVector.clear();
@@ -398,6 +698,9 @@ namespace snowboy {
 				m_templateDetectInterceptStream->SetData(tmat, tinfo, static_cast<SnowboySignal>(tres));
 				x = m_templateDetectStream->Read(&ptmat, &ptinfo);
 				if (ptmat.m_rows == 1 && ptmat.m_cols == 1) {
+					m_last_detection_frame_id = ptinfo[0].frame_id;
+					m_last_detection_score = m_templateDetectStream->m_detected_score;
+					m_last_detection_channel = 0;
 					this->Reset();
 					auto f = ptmat.m_data[0] - 1.0f;
 					if (f >= 9.223372e+18) f -= 9.223372e+18;
@@ -412,6 +715,9 @@ namespace snowboy {
 				auto utres = m_universalDetectStream->Read(&utmat, &utinfo);
 				x |= utres;
 				if (utmat.m_rows == 1 && utmat.m_cols == 1) {
+					m_last_detection_frame_id = utinfo[0].frame_id;
+					m_last_detection_score = m_universalDetectStream->m_detected_posterior;
+					m_last_detection_channel = 0;
 					this->Reset();
 					auto f = utmat.m_data[0] - 1.0f;
 					if (f >= 9.223372e+18) f -= 9.223372e+18;
@@ -426,29 +732,113 @@ namespace snowboy {
 				field_x168 = true;
 			}
 			x &= 0x20;
+			if (m_energyGateStream && m_energyGateStream->HasPending()) x = 0;
 		}
 		return this->field_x168 ? -2 : 0;
 	}
 
+	int PipelineDetect::RunChannelDetectionLocked(const MatrixBase& data, bool is_end) {
+		if (m_templateDetectStream)
+			throw snowboy_exception{"per-channel detection is only supported for universal models"};
+		const size_t num_channels = data.m_rows;
+		if (m_channel_streams.size() != num_channels) {
+			CreateChannelStreams(num_channels);
+			m_universalDetectStream->SetNumChannels(num_channels);
+		} else if (m_universalDetectStream->NumChannels() != num_channels) {
+			// The models were replaced
+			m_universalDetectStream->SetNumChannels(num_channels);
+		}
+
+		// All channels are resampled together, then every channel runs through its own front end
+		std::vector<FrameInfo> info;
+		info.resize(num_channels);
+		const auto signal = static_cast<SnowboySignal>(is_end ? 0x30 : 0x20);
+		m_interceptStream->SetData(data, info, signal);
+		Matrix audio;
+		if (m_resampleStream)
+			m_resampleStream->Read(&audio, &info);
+		else
+			m_interceptStream->Read(&audio, &info);
+		for (size_t c = 0; c < num_channels; c++) {
+			if (audio.m_rows == 0)
+				m_channel_streams[c]->interceptStream->SetData(Matrix{}, {}, signal);
+			else
+				m_channel_streams[c]->interceptStream->SetData(audio.RowRange(c, 1), {FrameInfo{}}, signal);
+		}
+
+		std::vector<Matrix> features(num_channels);
+		std::vector<std::vector<FrameInfo>> features_info(num_channels);
+		std::vector<int> signals(num_channels);
+		bool more = true;
+		while (more) {
+			for (size_t c = 0; c < num_channels; c++) {
+				auto& e = *m_channel_streams[c];
+				if (e.energyGateStream) e.energyGateStream->AllowSkipping(!e.vadStateStream2->m_vadstate->m_field_x10);
+				signals[c] = e.vadStateStream2->Read(&features[c], &features_info[c]);
+				e.rawEnergyVadStream->UpdateBackgroundEnergy(e.eavesdropStreamFrameInfoVector);
+				e.eavesdropStreamFrameInfoVector.clear();
+			}
+			Matrix mat;
+			std::vector<FrameInfo> mat_info;
+			m_universalDetectStream->ReadChannels(features, features_info, signals, &mat, &mat_info);
+			if (mat.m_rows == 1 && mat.m_cols == 1) {
+				m_last_detection_frame_id = mat_info[0].frame_id;
+				m_last_detection_score = m_universalDetectStream->m_detected_posterior;
+				m_last_detection_channel = m_universalDetectStream->m_detected_channel;
+				this->Reset();
+				auto f = mat.m_data[0] - 1.0f;
+				return m_universal_kw_mapping[static_cast<int>(f)];
+			}
+			more = false;
+			for (size_t c = 0; c < num_channels; c++) {
+				if ((signals[c] & 4) != 0) m_channel_streams[c]->silence = false;
+				if ((signals[c] & 8) != 0) m_channel_streams[c]->silence = true;
+				auto& gate = m_channel_streams[c]->energyGateStream;
+				more |= (signals[c] & 0x20) != 0 || (gate && gate->HasPending());
+			}
+		}
+		// Silence only if no channel hears voice
+		field_x168 = true;
+		for (auto& e : m_channel_streams)
+			field_x168 &= e->silence;
+		return field_x168 ? -2 : 0;
+	}
+
 	void PipelineDetect::SetAudioGain(float gain) {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 		m_gainControlStream->SetAudioGain(gain);
+		for (auto& e : m_channel_streams)
+			e->gainControlStream->SetAudioGain(gain);
 	}
 
 	void PipelineDetect::SetHighSensitivity(const std::string& param_1) {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 		if (!m_universalDetectStream) return;
 		std::string personal, universal;
 		ClassifySensitivities(param_1, &personal, &universal);
 		m_universalDetectStream->SetHighSensitivity(universal);
 	}
 
+	void PipelineDetect::SetFrameScoreSink(FrameScoreSink* sink) {
+		if (!m_isInitialized)
+			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		m_frame_score_sink = sink;
+		if (m_templateDetectStream) m_templateDetectStream->m_frame_score_sink = sink;
+		if (m_universalDetectStream) m_universalDetectStream->m_frame_score_sink = sink;
+	}
+
 	void PipelineDetect::SetMaxAudioAmplitude(float maxAmplitude) {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 		m_gainControlStream->SetMaxAudioAmplitude(maxAmplitude);
+		for (auto& e : m_channel_streams)
+			e->gainControlStream->SetMaxAudioAmplitude(maxAmplitude);
 	}
 
 	void PipelineDetect::SetModel(const std::string& model) {
@@ -457,18 +847,189 @@ namespace snowboy {
 		ClassifyModels(model, &m_templateDetectStreamOptions->model_str, &m_universalDetectStreamOptions->model_str);
 	}
 
+	void PipelineDetect::ReplaceModels(const std::string& model) {
+		if (!m_isInitialized)
+			throw snowboy_exception{"pipeline has not been initialized yet"};
+
+		if (m_score_trace)
+			throw snowboy_exception{"models can not be replaced while a score trace is recorded"};
+		// Everything is loaded before taking the lock, so detection only waits for the swap
+		auto personal_options = *m_templateDetectStreamOptions;
+		auto universal_options = *m_universalDetectStreamOptions;
+		std::vector<bool> is_personal_model;
+		std::vector<std::shared_ptr<const MappedFile>> model_files;
+		ClassifyModels(model, &personal_options.model_str, &universal_options.model_str, &is_personal_model, &model_files);
+		if (personal_options.model_str == "" && universal_options.model_str == "")
+			throw snowboy_exception{"no model detected! You have to provide at least one personal or one universal model"};
+		DetectStreams streams;
+		CreateDetectStreams(personal_options, universal_options, is_personal_model, &streams);
+		{
+			std::lock_guard<std::mutex> lock{m_detect_mutex};
+			if (m_channel_mix == "separate" && streams.templateDetectStream)
+				throw snowboy_exception{"per-channel detection is only supported for universal models"};
+			SwapDetectStreams(&streams);
+			std::swap(m_is_personal_model, is_personal_model);
+			std::swap(m_templateDetectStreamOptions->model_str, personal_options.model_str);
+			std::swap(m_universalDetectStreamOptions->model_str, universal_options.model_str);
+		}
+		// The previous streams are released here, outside of the lock
+	}
+
 	void PipelineDetect::SetSensitivity(const std::string& param_1) {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 		std::string personal, universal;
 		ClassifySensitivities(param_1, &personal, &universal);
 		if (m_templateDetectStream) m_templateDetectStream->SetSensitivity(personal);
 		if (m_universalDetectStream) m_universalDetectStream->SetSensitivity(universal);
 	}
 
+	void PipelineDetect::StartScoreTrace(float min_rerun_seconds) {
+		if (!m_isInitialized)
+			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		// Detections of personal models depend on the template buffer that is cleared after each detection,
+		// so they cannot be evaluated from recorded scores.
+		if (m_templateDetectStream || !m_universalDetectStream)
+			throw snowboy_exception{"score traces are only supported for universal models"};
+		if (m_channel_mix == "separate")
+			throw snowboy_exception{"score traces are not supported with per-channel detection"};
+		// Start from the state of a freshly constructed pipeline, which is what EvaluateScoreTrace() replays
+		m_universalDetectStream->m_score_trace = nullptr;
+		this->Reset();
+		m_framerStream->field_x38 = 1;
+		m_score_trace.reset(new ScoreTrace());
+		m_score_trace->min_rerun_seconds = min_rerun_seconds;
+		m_score_trace->segments[0];
+	}
+
+	void PipelineDetect::StopScoreTrace() {
+		if (!m_isInitialized)
+			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		if (!m_score_trace) return;
+		m_score_trace.reset();
+		m_universalDetectStream->m_score_trace = nullptr;
+		this->Reset();
+	}
+
+	int PipelineDetect::RunScoreTraceChunk(size_t segment, size_t chunk) {
+		auto& seg = m_score_trace->segments[segment];
+		m_universalDetectStream->m_score_trace = &seg.batches;
+		auto res = RunDetectionLocked(m_score_trace->chunks[chunk], m_score_trace->is_end[chunk]);
+		seg.batch_chunk.resize(seg.batches.size(), chunk);
+		seg.frame_counter.push_back(m_framerStream->field_x38);
+		m_score_trace->active_segment = segment;
+		return res;
+	}
+
+	void PipelineDetect::AddScoreTraceSegment(size_t first_chunk, unsigned int frame_counter) {
+		if (m_score_trace->segments.count(first_chunk) != 0) return;
+		auto& seg = m_score_trace->segments[first_chunk];
+		seg.first_frame_counter = frame_counter;
+		seg.last_chunk = m_score_trace->chunks.size();
+		if (m_score_trace->min_rerun_seconds == 0) return;
+		// The outputs can match those of the whole audio before the VAD has forgotten the reset, so matches are only
+		// looked for after min_rerun_seconds
+		const auto input_rate = m_input_sample_rate != 0 ? m_input_sample_rate : m_pipelineDetectOptions.sampleRate;
+		const auto min_samples = static_cast<size_t>(m_score_trace->min_rerun_seconds * input_rate);
+		size_t samples = 0;
+		for (seg.last_chunk = first_chunk; seg.last_chunk < m_score_trace->chunks.size() && samples < min_samples; seg.last_chunk++)
+			samples += m_score_trace->chunks[seg.last_chunk].m_cols;
+	}
+
+	void PipelineDetect::ExtendScoreTraceSegment(size_t first_chunk) {
+		auto& seg = m_score_trace->segments[first_chunk];
+		const auto next_chunk = first_chunk + seg.frame_counter.size();
+		if (m_score_trace->active_segment != first_chunk) {
+			// Bring the pipeline back to the state after the chunks recorded so far, everything but the frame counter
+			// of the framer is reset after a detection
+			this->Reset();
+			m_framerStream->field_x38 = seg.first_frame_counter;
+			std::vector<UniversalDetectStream::ScoreTraceBatch> discarded;
+			m_universalDetectStream->m_score_trace = &discarded;
+			for (size_t c = first_chunk; c < next_chunk; c++)
+				RunDetectionLocked(m_score_trace->chunks[c], m_score_trace->is_end[c]);
+		}
+		RunScoreTraceChunk(first_chunk, next_chunk);
+		// After min_rerun_seconds the segment goes on until a chunk matches the whole audio
+		if (next_chunk + 1 == seg.last_chunk && seg.last_chunk < m_score_trace->chunks.size()
+			&& !m_score_trace->MatchesWholeAudio(first_chunk, next_chunk))
+			seg.last_chunk++;
+	}
+
+	std::vector<HotwordDetection> PipelineDetect::EvaluateScoreTrace(const std::string& sensitivity, const std::string& high_sensitivity) {
+		if (!m_isInitialized)
+			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
+		if (!m_score_trace)
+			throw snowboy_exception{"no score trace has been recorded"};
+		std::string personal, universal, universal_high;
+		if (!sensitivity.empty()) ClassifySensitivities(sensitivity, &personal, &universal);
+		if (!high_sensitivity.empty()) ClassifySensitivities(high_sensitivity, &personal, &universal_high);
+
+		// Walks through the segments the pipeline goes through for these sensitivities. A segment recorded for another
+		// detection may have started with a different frame counter, its frame ids are shifted by the difference until
+		// the counter restarts after the next chunk with is_end set. Segments are run further as they are read.
+		auto end_chunk = [&](size_t chunk) {
+			while (chunk < m_score_trace->is_end.size() && !m_score_trace->is_end[chunk])
+				chunk++;
+			return chunk;
+		};
+		size_t first_chunk = 0, batch = 0, offset_end = end_chunk(0);
+		unsigned int offset = 0;
+		const ScoreTrace::Segment* segment = &m_score_trace->segments[0];
+		UniversalDetectStream::ScoreTraceBatch shifted;
+		auto next_batch = [&](bool detected) -> const UniversalDetectStream::ScoreTraceBatch* {
+			if (detected) {
+				auto chunk = segment->batch_chunk[batch - 1];
+				if (chunk + 1 >= m_score_trace->chunks.size()) return nullptr;
+				auto frame_counter = segment->frame_counter[chunk - first_chunk] + (chunk < offset_end ? offset : 0);
+				first_chunk = chunk + 1;
+				AddScoreTraceSegment(first_chunk, frame_counter);
+				segment = &m_score_trace->segments[first_chunk];
+				offset = frame_counter - segment->first_frame_counter;
+				offset_end = end_chunk(first_chunk);
+				batch = 0;
+			}
+			while (batch == segment->batches.size()) {
+				const auto next_chunk = first_chunk + segment->frame_counter.size();
+				if (next_chunk == m_score_trace->chunks.size()) return nullptr;
+				if (next_chunk < segment->last_chunk) {
+					ExtendScoreTraceSegment(first_chunk);
+					continue;
+				}
+				// Continue with the whole audio where the segment stops being run again
+				auto frame_counter = segment->frame_counter.back() + (next_chunk - 1 < offset_end ? offset : 0);
+				segment = &m_score_trace->segments[0];
+				first_chunk = 0;
+				batch = std::lower_bound(segment->batch_chunk.begin(), segment->batch_chunk.end(), next_chunk) - segment->batch_chunk.begin();
+				offset = frame_counter - segment->frame_counter[next_chunk - 1];
+				offset_end = end_chunk(next_chunk);
+			}
+			auto& res = segment->batches[batch];
+			auto chunk = segment->batch_chunk[batch++];
+			if (offset == 0 || chunk > offset_end) return &res;
+			shifted = res;
+			for (auto& info : shifted.info) {
+				// Rows a network flushes past the frames it got keep frame id 0
+				for (auto& e : info)
+					if (e.frame_id != 0) e.frame_id += offset;
+			}
+			return &shifted;
+		};
+		std::vector<HotwordDetection> res;
+		for (auto& e : m_universalDetectStream->ReplayScoreTrace(universal, universal_high, next_batch)) {
+			res.push_back({m_universal_kw_mapping[e.hotword_id - 1], e.frame_id, e.posterior});
+		}
+		return res;
+	}
+
 	void PipelineDetect::UpdateModel() const {
 		if (!m_isInitialized)
 			throw snowboy_exception{"pipeline has not been initialized yet"};
+		std::lock_guard<std::mutex> lock{m_detect_mutex};
 		if (m_templateDetectStream) m_templateDetectStream->UpdateModel();
 		if (m_universalDetectStream) m_universalDetectStream->UpdateModel();
 	}
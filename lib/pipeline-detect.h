@@ -1,5 +1,6 @@
 #pragma once
 #include <memory>
+#include <mutex>
 #include <pipeline-itf.h>
 #include <vector>
 
@@ -8,11 +9,14 @@ namespace snowboy {
 	struct FrameInfo;
 
 	class InterceptStream;
+	class ChannelMixStream;
+	class ResampleStream;
 	class GainControlStream;
 	struct FrontendStream;
 	struct FramerStream;
 	struct RawEnergyVadStream;
 	struct VadStateStream;
+	class EnergyGateStream;
 	class FftStream;
 	class MfccStream;
 	struct RawNnetVadStream;
@@ -20,12 +24,15 @@ namespace snowboy {
 	class NnetStream;
 	struct TemplateDetectStream;
 	struct UniversalDetectStream;
+	struct HotwordDetection;
+	class FrameScoreSink;
 
 	struct GainControlStreamOptions;
 	struct FrontendStreamOptions;
 	struct FramerStreamOptions;
 	struct RawEnergyVadStreamOptions;
 	struct VadStateStreamOptions;
+	struct EnergyGateStreamOptions;
 	struct FftStreamOptions;
 	struct MfccStreamOptions;
 	struct RawNnetVadStreamOptions;
@@ -54,27 +61,105 @@ namespace snowboy {
 
 		void ApplyFrontend(bool apply);
 		uint64_t GetDetectedFrameId() const;
+		// Frame id and score of the hotword returned by the last RunDetection()
+		uint64_t GetLastDetectionFrameId() const;
+		float GetLastDetectionScore() const;
+		// Channel of the hotword returned by the last RunDetection() when detecting per channel, 0 otherwise
+		int GetLastDetectionChannel() const;
+		std::vector<float> GetModelLoadTimes() const;
 		std::string GetSensitivity() const;
 		int NumHotwords() const;
 		int RunDetection(const MatrixBase& data, bool is_end);
 		void SetAudioGain(float gain);
+		// Passes the per-frame scores of the detection streams to `sink`, nullptr to disable. The sink is not owned.
+		void SetFrameScoreSink(FrameScoreSink* sink);
 		void SetHighSensitivity(const std::string&);
 		void SetMaxAudioAmplitude(float maxAmplitude);
+		// Resamples audio of `sample_rate` to the pipeline sample rate, a resampler is only inserted if they differ
+		void SetInputSampleRate(int sample_rate);
+		// How the rows of multi-channel input are combined, see ChannelMixStream. "separate" detects on every channel,
+		// with the networks of all channels computed in one batch.
+		void SetChannelMix(const std::string& method);
+		// Drops silence before the FFT while the VAD does not hear voice, see EnergyGateStream
+		void SetPowerSaving(bool enable);
+		// Frames dropped by the energy gates of all channels since power saving was enabled
+		uint64_t GetPowerSavingSkippedFrames() const;
 		void SetModel(const std::string& model);
+		// Loads `model` and swaps it in for the current models between two RunDetection() calls, keeping the state
+		// of the front end and VAD. May be called from another thread while RunDetection() is running.
+		void ReplaceModels(const std::string& model);
 		void SetSensitivity(const std::string& sensitivity);
+		// While a score trace is recorded RunDetection() keeps the audio and the network outputs of the universal models
+		// instead of detecting, EvaluateScoreTrace() then finds the detections of the recorded audio for any sensitivity.
+		// The audio after a detection is run again until the next one, or with `min_rerun_seconds` not 0 until a chunk
+		// after that much audio gives the same outputs as the whole audio.
+		void StartScoreTrace(float min_rerun_seconds);
+		void StopScoreTrace();
+		std::vector<HotwordDetection> EvaluateScoreTrace(const std::string& sensitivity, const std::string& high_sensitivity);
 		void UpdateModel() const;
 
 	private:
+		struct ScoreTrace;
+		// Detection streams of one set of models and the mapping of their keywords to hotword ids
+		struct DetectStreams {
+			std::unique_ptr<InterceptStream> templateDetectInterceptStream;
+			std::unique_ptr<NnetStream> templateDetectNnetStream;
+			std::unique_ptr<TemplateDetectStream> templateDetectStream;
+			std::unique_ptr<InterceptStream> universalDetectInterceptStream;
+			std::unique_ptr<UniversalDetectStream> universalDetectStream;
+			std::vector<int> personal_kw_mapping;
+			std::vector<int> universal_kw_mapping;
+		};
+
+		// Front end of one channel when detecting per channel, from the channel's intercept stream to the second VAD
+		// state stream
+		struct ChannelStreams {
+			std::unique_ptr<InterceptStream> interceptStream;
+			std::unique_ptr<GainControlStream> gainControlStream;
+			std::unique_ptr<FrontendStream> frontendStream;
+			std::unique_ptr<FramerStream> framerStream;
+			std::unique_ptr<RawEnergyVadStream> rawEnergyVadStream;
+			std::unique_ptr<VadStateStream> vadStateStream;
+			std::unique_ptr<EnergyGateStream> energyGateStream;
+			std::unique_ptr<FftStream> fftStream;
+			std::unique_ptr<MfccStream> mfccStream;
+			std::unique_ptr<RawNnetVadStream> rawNnetVadStream;
+			std::unique_ptr<EavesdropStream> eavesdropStream;
+			std::unique_ptr<VadStateStream> vadStateStream2;
+			std::vector<FrameInfo> eavesdropStreamFrameInfoVector;
+			bool silence = true;
+		};
+
 		void ClassifyModels(const std::string&, std::string*, std::string*);
-		bool ClassifyModel(const std::string& model_filename);
+		void ClassifyModels(const std::string& model_str, std::string* personal_models, std::string* universal_models,
+							std::vector<bool>* is_personal_model, std::vector<std::shared_ptr<const MappedFile>>* model_files) const;
+		bool ClassifyModel(const std::string& model_filename) const;
 		void ClassifySensitivities(const std::string&, std::string*, std::string*) const;
+		void CreateDetectStreams(const TemplateDetectStreamOptions& personal_options, const UniversalDetectStreamOptions& universal_options,
+								 const std::vector<bool>& is_personal_model, DetectStreams* streams) const;
+		void SwapDetectStreams(DetectStreams* streams);
+		int RunDetectionLocked(const MatrixBase& data, bool is_end);
+		int RunChannelDetectionLocked(const MatrixBase& data, bool is_end);
+		void CreateChannelStreams(size_t num_channels);
+		// Connects the gain control to the intercept stream through the channel mix and, if the input rate differs,
+		// a resampler
+		void ConnectInputStreams();
+		// Connects the FFT to the VAD state stream, through the energy gate with power saving
+		void ConnectEnergyGate();
+		// Runs a recorded chunk of audio and appends its network outputs to the score trace segment starting at `segment`
+		int RunScoreTraceChunk(size_t segment, size_t chunk);
+		void AddScoreTraceSegment(size_t first_chunk, unsigned int frame_counter);
+		void ExtendScoreTraceSegment(size_t first_chunk);
 
 		std::unique_ptr<InterceptStream> m_interceptStream;
+		std::unique_ptr<ChannelMixStream> m_channelMixStream;
+		std::unique_ptr<ResampleStream> m_resampleStream;
 		std::unique_ptr<GainControlStream> m_gainControlStream;
 		std::unique_ptr<FrontendStream> m_frontendStream;
 		std::unique_ptr<FramerStream> m_framerStream;
 		std::unique_ptr<RawEnergyVadStream> m_rawEnergyVadStream;
 		std::unique_ptr<VadStateStream> m_vadStateStream;
+		std::unique_ptr<EnergyGateStream> m_energyGateStream;
 		std::unique_ptr<FftStream> m_fftStream;
 		std::unique_ptr<MfccStream> m_mfccStream;
 		std::unique_ptr<RawNnetVadStream> m_rawNnetVadStream;
@@ -88,12 +173,16 @@ namespace snowboy {
 		std::unique_ptr<InterceptStream> m_universalDetectInterceptStream;
 		std::unique_ptr<UniversalDetectStream> m_universalDetectStream;
 
+		// One front end per channel while detecting per channel
+		std::vector<std::unique_ptr<ChannelStreams>> m_channel_streams;
+
 		PipelineDetectOptions m_pipelineDetectOptions = {};
 		std::unique_ptr<GainControlStreamOptions> m_gainControlStreamOptions;
 		std::unique_ptr<FrontendStreamOptions> m_frontendStreamOptions;
 		std::unique_ptr<FramerStreamOptions> m_framerStreamOptions;
 		std::unique_ptr<RawEnergyVadStreamOptions> m_rawEnergyVadStreamOptions;
 		std::unique_ptr<VadStateStreamOptions> m_vadStateStreamOptions;
+		std::unique_ptr<EnergyGateStreamOptions> m_energyGateStreamOptions;
 		std::unique_ptr<FftStreamOptions> m_fftStreamOptions;
 		std::unique_ptr<MfccStreamOptions> m_mfccStreamOptions;
 		std::unique_ptr<RawNnetVadStreamOptions> m_rawNnetVadStreamOptions;
@@ -104,10 +193,23 @@ namespace snowboy {
 
 		std::vector<FrameInfo> m_eavesdropStreamFrameInfoVector;
 		std::vector<bool> m_is_personal_model;
+		// Mappings of the models pinned from SetModel() until Init() so every model file is opened once
+		std::vector<std::shared_ptr<const MappedFile>> m_model_files;
+		// Held by RunDetection(), while ReplaceModels() swaps the detection streams and by everything reading them
+		mutable std::mutex m_detect_mutex;
 		std::vector<int> m_personal_kw_mapping;
 		std::vector<int> m_universal_kw_mapping;
+		std::unique_ptr<ScoreTrace> m_score_trace;
+		FrameScoreSink* m_frame_score_sink = nullptr;
 
+		uint64_t m_last_detection_frame_id = 0;
+		float m_last_detection_score = 0.0f;
+		int m_last_detection_channel = 0;
 		bool field_x168 = false;
 		bool m_frontend_enabled = false;
+		// Sample rate of the audio passed to RunDetection(), 0 for the pipeline sample rate
+		int m_input_sample_rate = 0;
+		std::string m_channel_mix = "beamform";
+		bool m_power_saving = false;
 	};
 } // namespace snowboy
@@ -1,7 +1,9 @@
 #pragma once
+#include <memory>
 #include <string>
 namespace snowboy {
 	struct OptionsItf;
+	class MappedFile;
 	class PipelineItf {
 	public:
 		virtual void RegisterOptions(const std::string&, OptionsItf*) = 0;
@@ -15,5 +17,7 @@ namespace snowboy {
 
 	protected:
 		bool m_isInitialized = false;
+		// Pinned mapping of the resource, the streams created in Init() read their models from it
+		std::shared_ptr<const MappedFile> m_resource;
 	};
 } // namespace snowboy
@@ -1,12 +1,22 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <map>
+#include <random>
+#include <matrix-wrapper.h>
+#include <nnet-lib.h>
 #include <pipeline-itf.h>
 #include <pipeline-lib.h>
 #include <snowboy-error.h>
 #include <snowboy-io.h>
 #include <snowboy-options.h>
 #include <snowboy-utils.h>
+#include <sstream>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <template-container.h>
+#include <universal-detect-stream.h>
+#include <vector-wrapper.h>
 
 namespace snowboy {
 	void PipelineItf::SetResource(const std::string& param_1) {
@@ -14,6 +24,8 @@ namespace snowboy {
 			throw snowboy_exception{"class has already been initialized, you have to call SetResource before calling Init()"};
 		ParseOptions opts{""};
 		std::string opts_out;
+		UpdateModelCache(param_1);
+		m_resource = PinMappedFile(param_1);
 		UnpackPipelineResource(param_1, &opts_out);
 		FilterConfigString(false, "--" + this->OptionPrefix(), &opts_out);
 		this->RegisterOptions(this->OptionPrefix(), &opts);
@@ -75,6 +87,7 @@ namespace snowboy {
 				throw snowboy_exception{"Fail to open resource file \"" + e + "\""};
 			*stream << file.rdbuf();
 		}
+		out.Close();
 	}
 
 	void UnpackPipelineResource(const std::string& filename, std::string* options_out) {
@@ -113,7 +126,7 @@ namespace snowboy {
 						throw snowboy_exception{"Bad config file, index " + std::to_string(idx)
 												+ " exceeds number of offsets (" + std::to_string(offsets.size()) + ")"};
 					}
-					opt = opt_parts[0] + "=" + filename + global_snowboy_offset_delimiter + std::to_string(offsets[idx] + res_start);
+					opt = opt_parts[0] + "=" + in.Filename() + global_snowboy_offset_delimiter + std::to_string(offsets[idx] + res_start);
 				}
 			} else {
 				throw snowboy_exception{"Bad option in configuration string: \"" + opt
@@ -130,4 +143,169 @@ namespace snowboy {
 			options_out->append(configs[i]);
 		}
 	}
+
+	static void WriteAlignmentPadding(std::ostream* os) {
+		static const char zeros[kModelBlobAlignment] = {};
+		auto pos = static_cast<size_t>(os->tellp());
+		os->write(zeros, (kModelBlobAlignment - pos % kModelBlobAlignment) % kModelBlobAlignment);
+	}
+
+	static void WriteResourceTable(const std::vector<int>& offsets, const std::vector<std::string>& configs, std::ostream* os) {
+		WriteToken(true, "<ResourceFileOffsets>", os);
+		WriteToken(true, "<NumOffsets>", os);
+		WriteBasicType<int32_t>(true, offsets.size(), os);
+		for (auto e : offsets)
+			WriteBasicType<int32_t>(true, e, os);
+		WriteToken(true, "</ResourceFileOffsets>", os);
+		WriteToken(true, "<Configuration>", os);
+		WriteToken(true, "<NumConfigs>", os);
+		WriteBasicType<int32_t>(true, configs.size(), os);
+		for (const auto& e : configs)
+			WriteToken(true, e, os);
+		WriteToken(true, "</Configuration>", os);
+	}
+
+	static std::string ConvertModel(const std::shared_ptr<const MappedFile>& file, size_t begin, size_t end);
+
+	static std::string FinishContainer(std::string data, ModelContainerHeader* header) {
+		header->payload_size = data.size() - sizeof(*header);
+		memcpy(&data[0], header, sizeof(*header));
+		return data;
+	}
+
+	// The embedded files are converted on their own and placed at aligned offsets after the rewritten table
+	static void ConvertPipelineResource(const std::shared_ptr<const MappedFile>& file, size_t end, std::istream* is, std::ostream* os) {
+		ExpectToken(true, "<ResourceFileOffsets>", is);
+		ExpectToken(true, "<NumOffsets>", is);
+		int num_offsets = 0;
+		ReadBasicType<int32_t>(true, &num_offsets, is);
+		std::vector<int> offsets(num_offsets);
+		for (auto& e : offsets)
+			ReadBasicType<int32_t>(true, &e, is);
+		ExpectToken(true, "</ResourceFileOffsets>", is);
+		ExpectToken(true, "<Configuration>", is);
+		ExpectToken(true, "<NumConfigs>", is);
+		int num_configs = 0;
+		ReadBasicType<int32_t>(true, &num_configs, is);
+		std::vector<std::string> configs(num_configs);
+		for (auto& e : configs)
+			ReadToken(true, &e, is);
+		ExpectToken(true, "</Configuration>", is);
+		size_t res_start = is->tellg();
+
+		std::vector<int> starts = offsets;
+		std::sort(starts.begin(), starts.end());
+		starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+		std::stringstream table;
+		WriteResourceTable(offsets, configs, &table);
+		size_t new_res_start = static_cast<size_t>(os->tellp()) + table.str().size();
+		size_t pos = new_res_start;
+		std::map<int, int> new_offsets;
+		std::vector<std::string> embedded;
+		for (size_t i = 0; i < starts.size(); i++) {
+			auto file_end = i + 1 < starts.size() ? res_start + starts[i + 1] : end;
+			embedded.push_back(ConvertModel(file, res_start + starts[i], file_end));
+			pos += (kModelBlobAlignment - pos % kModelBlobAlignment) % kModelBlobAlignment;
+			new_offsets[starts[i]] = pos - new_res_start;
+			pos += embedded.back().size();
+		}
+		for (auto& e : offsets)
+			e = new_offsets[e];
+		WriteResourceTable(offsets, configs, os);
+		for (const auto& e : embedded) {
+			WriteAlignmentPadding(os);
+			os->write(e.data(), e.size());
+		}
+	}
+
+	static std::string ConvertModel(const std::shared_ptr<const MappedFile>& file, size_t begin, size_t end) {
+		MemoryStreamBuf buffer{file, begin, end};
+		std::istream is{&buffer};
+		if (is.get() != 0 || is.get() != 'B')
+			throw snowboy_exception{"Only binary models can be converted, model at offset " + std::to_string(begin) + " is either a text model or already converted"};
+
+		ModelContainerHeader header{};
+		memcpy(header.magic, global_snowboy_container_magic, sizeof(header.magic));
+		header.version = kModelContainerVersion;
+		header.header_size = sizeof(header);
+		std::stringstream os;
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		// Load the model with its regular reader while recording where matrices and vectors are stored,
+		// everything except those blobs is copied over unchanged.
+		auto type = PeekToken(true, &is);
+		if (type == 'R') {
+			ConvertPipelineResource(file, end, &is, &os);
+			return FinishContainer(os.str(), &header);
+		}
+		std::vector<ModelBlob> blobs;
+		buffer.SetBlobLog(&blobs);
+		switch (type) {
+		case 'N': {
+			Nnet nnet;
+			nnet.Read(true, &is);
+			break;
+		}
+		case 'U': {
+			UniversalDetectStream::ModelInfo model;
+			int hotword_id = 1;
+			model.ReadHotwordModel(true, &is, 1, &hotword_id);
+			break;
+		}
+		case 'P': {
+			TemplateContainer model;
+			model.ReadHotwordModel(true, &is);
+			break;
+		}
+		default: throw snowboy_exception{"Unknown model type at offset " + std::to_string(begin)};
+		}
+		buffer.SetBlobLog(nullptr);
+
+		size_t pos = begin + 2;
+		for (const auto& blob : blobs) {
+			SNOWBOY_ASSERT(blob.begin >= pos && blob.end >= blob.begin);
+			os.write(file->data() + pos, blob.begin - pos);
+			MemoryStreamBuf blob_buffer{file, blob.begin, blob.end};
+			std::istream blob_is{&blob_buffer};
+			if (blob.is_matrix) {
+				Matrix m;
+				m.Read(true, &blob_is);
+				m.WriteAligned(&os);
+			} else {
+				Vector v;
+				v.Read(true, &blob_is);
+				v.WriteAligned(&os);
+			}
+			pos = blob.end;
+		}
+		os.write(file->data() + pos, end - pos);
+		if (!os) throw snowboy_exception{"Failed to convert model at offset " + std::to_string(begin)};
+		return FinishContainer(os.str(), &header);
+	}
+
+	void ConvertToModelContainer(const std::string& in_filename, const std::string& out_filename) {
+		auto file = std::make_shared<const MappedFile>(in_filename);
+		auto res = ConvertModel(file, 0, file->size());
+		Output out{out_filename, false};
+		out.Stream()->write(res.data(), res.size());
+		if (!*out.Stream()) throw snowboy_exception{"Failed to write model container \"" + out_filename + "\""};
+		out.Close();
+	}
+
+	void UpdateModelCache(const std::string& filename) {
+		auto path = ModelCachePath(filename);
+		struct stat stat_buf;
+		if (path.empty() || stat(path.c_str(), &stat_buf) == 0) return;
+		if (Input{filename}.is_container()) return;
+		// Written under a unique name and renamed, so other processes never see a partial entry
+		auto temp = path + ".tmp" + std::to_string(std::random_device{}());
+		try {
+			ConvertToModelContainer(filename, temp);
+		} catch (const snowboy_exception&) {
+			// Models that can not be converted are loaded from the original file
+			std::remove(temp.c_str());
+			return;
+		}
+		if (std::rename(temp.c_str(), path.c_str()) != 0) std::remove(temp.c_str());
+	}
 } // namespace snowboy
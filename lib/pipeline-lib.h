@@ -5,4 +5,9 @@ namespace snowboy {
 	void PackPipelineResource(const std::string&, const std::string&);
 	void PackPipelineResource(bool, const std::string&, const std::string&);
 	void UnpackPipelineResource(const std::string&, std::string*);
+	// Converts a binary universal/personal model, neural network or pipeline resource into a model container,
+	// whose weights are used directly from a memory mapping when loaded.
+	void ConvertToModelContainer(const std::string& in_filename, const std::string& out_filename);
+	// Adds the container of `filename` to the model cache if the cache is enabled and has no entry for it yet.
+	void UpdateModelCache(const std::string& filename);
 } // namespace snowboy
\ No newline at end of file
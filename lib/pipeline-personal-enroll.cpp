@@ -110,6 +110,8 @@ namespace snowboy {
 		m_nnetStreamOptions->model_filename = "";
 		m_templateEnrollStreamOptions.reset(new TemplateEnrollStreamOptions{});
 		m_templateEnrollStreamOptions->combine_distance_metric = "euclidean";
+		m_templateEnrollStreamOptions->combine_band_width = -1;
+		m_templateEnrollStreamOptions->combine_num_threads = 0;
 		m_templateEnrollStreamOptions->model_filename = "";
 		m_templateEnrollStreamOptions->num_templates = 3;
 		m_templateEnrollStreamOptions->min_template_length = 20;
@@ -33,6 +33,8 @@ namespace snowboy {
 		if (!field_x2c) {
 			InitRawEnergyVad(mat, info);
 		} else {
+			const size_t keep = mat->rows() + m_options.raw_buffer_extra;
+			ReserveRawEnergies(keep);
 			for (size_t r = 0; r < mat->rows(); r++) {
 				auto dot = SubVector{*mat, r}.DotVec(SubVector{*mat, r});
 				dot = std::max(std::numeric_limits<float>::min(), dot);
@@ -43,11 +45,10 @@ namespace snowboy {
 				} else {
 					info->at(r).flags &= ~0x1;
 				}
-				field_x38.push_back({info->at(r).frame_id, dot});
-			}
-			while (field_x38.size() > mat->rows() + m_options.raw_buffer_extra) {
-				field_x38.pop_front();
+				PushRawEnergy(info->at(r).frame_id, dot);
 			}
+			while (m_raw_size > keep)
+				PopRawEnergy();
 		}
 		if ((sig & 0x18) != 0 && m_someMatrix.rows() != 0) {
 			mat->Swap(&m_someMatrix);
@@ -60,8 +61,11 @@ namespace snowboy {
 		m_bg_energy = 0;
 		field_x34 = 0;
 		field_x2c = m_options.init_bg_energy ^ 1;
-		field_x38.clear();
-		field_x88.clear();
+		m_raw_head = 0;
+		m_raw_size = 0;
+		m_bg_energies.resize(m_options.bg_buffer_size);
+		m_bg_head = 0;
+		m_bg_size = 0;
 		m_someMatrix.Resize(0, 0);
 		field_xf0.clear();
 		return true;
@@ -84,27 +88,28 @@ namespace snowboy {
 		mat->Resize(0, 0);
 		info->clear();
 		if (m_someMatrix.m_rows >= m_options.bg_buffer_size) {
-			field_x38.resize(m_someMatrix.rows());
-			for (size_t r = 0; r < m_someMatrix.rows(); r++) {
+			const size_t rows = m_someMatrix.rows();
+			m_raw_head = 0;
+			m_raw_size = 0;
+			ReserveRawEnergies(rows);
+			for (size_t r = 0; r < rows; r++) {
 				auto dot = SubVector{m_someMatrix, r}.DotVec(SubVector{m_someMatrix, r});
 				dot = std::max(std::numeric_limits<float>::min(), dot);
 				dot = logf(dot);
-				auto& e = field_x38[r];
-				e.first = field_xf0[r].frame_id;
-				e.second = dot;
+				PushRawEnergy(field_xf0[r].frame_id, dot);
 			}
 			m_bg_energy = 0.0;
-			for (size_t i = m_options.bg_buffer_size / 2; i < field_x38.size(); i++) {
-				m_bg_energy += field_x38[i].second;
+			for (size_t i = m_options.bg_buffer_size / 2; i < rows; i++) {
+				m_bg_energy += m_raw_energies[i].second;
 			}
-			auto s = static_cast<ssize_t>(field_x38.size()) - m_options.bg_buffer_size / 2;
+			auto s = static_cast<ssize_t>(rows) - m_options.bg_buffer_size / 2;
 			if (s < 0) {
 				s *= 2;
 			}
 			m_bg_energy /= static_cast<float>(s);
 			m_bg_energy = std::min(m_options.bg_energy_cap, m_bg_energy);
-			for (size_t i = m_options.bg_buffer_size / 2; i < field_x38.size(); i++) {
-				if (field_x38[i].second - m_bg_energy > m_options.bg_energy_threshold)
+			for (size_t i = m_options.bg_buffer_size / 2; i < rows; i++) {
+				if (m_raw_energies[i].second - m_bg_energy > m_options.bg_energy_threshold)
 					field_xf0[i].flags |= 1;
 				else
 					field_xf0[i].flags &= ~1;
@@ -116,32 +121,56 @@ namespace snowboy {
 	}
 
 	void RawEnergyVadStream::UpdateBackgroundEnergy(const std::vector<FrameInfo>& info) {
-		if (info.size() != 0) {
-			auto ppVar7 = field_x38.begin();
-			while (field_x38.size() != 0) {
-				if (info[0].frame_id <= ppVar7->first) {
-					for (size_t uVar20 = 0; uVar20 < info.size(); uVar20++) {
-						if (info[uVar20].frame_id == ppVar7->first) {
-							if ((info[uVar20].flags & 1) == 0) {
-								field_x88.push_back(ppVar7->second);
-							}
-							ppVar7 = field_x38.erase(ppVar7);
-						}
-					}
-					auto pfVar6 = field_x88.begin();
-					while (m_options.bg_buffer_size < field_x88.size()) {
-						this->field_x34 = this->field_x34 - *pfVar6;
-						pfVar6 = field_x88.erase(pfVar6);
-					}
-					if (m_options.bg_buffer_size != field_x88.size()) {
-						return;
-					}
-					m_bg_energy = std::min(field_x34 / (float)m_options.bg_buffer_size, m_options.bg_energy_cap);
-					return;
-				}
-				ppVar7 = field_x38.erase(ppVar7);
-			}
+		if (info.empty()) return;
+		while (m_raw_size != 0 && m_raw_energies[m_raw_head].first < info[0].frame_id)
+			PopRawEnergy();
+		if (m_raw_size == 0) return;
+		// The frames are matched in order, an info not matching the oldest buffered frame is skipped
+		for (auto& e : info) {
+			if (m_raw_size == 0) break;
+			const auto& raw = m_raw_energies[m_raw_head];
+			if (e.frame_id != raw.first) continue;
+			if ((e.flags & 1) == 0) PushBackgroundEnergy(raw.second);
+			PopRawEnergy();
+		}
+		if (m_bg_size != m_options.bg_buffer_size) return;
+		m_bg_energy = std::min(field_x34 / (float)m_options.bg_buffer_size, m_options.bg_energy_cap);
+	}
+
+	void RawEnergyVadStream::ReserveRawEnergies(size_t capacity) {
+		if (m_raw_energies.size() >= capacity) return;
+		std::vector<std::pair<unsigned int, float>> energies(capacity);
+		for (size_t i = 0; i < m_raw_size; i++)
+			energies[i] = m_raw_energies[(m_raw_head + i) % m_raw_energies.size()];
+		m_raw_energies.swap(energies);
+		m_raw_head = 0;
+	}
+
+	void RawEnergyVadStream::PushRawEnergy(unsigned int frame_id, float energy) {
+		if (m_raw_size == m_raw_energies.size()) PopRawEnergy();
+		m_raw_energies[(m_raw_head + m_raw_size) % m_raw_energies.size()] = {frame_id, energy};
+		m_raw_size++;
+	}
+
+	void RawEnergyVadStream::PopRawEnergy() {
+		m_raw_head = (m_raw_head + 1) % m_raw_energies.size();
+		m_raw_size--;
+	}
+
+	void RawEnergyVadStream::PushBackgroundEnergy(float energy) {
+		// The oldest energy leaves the buffer, in the order the original library erased them
+		if (m_bg_energies.empty()) {
+			field_x34 = field_x34 - energy;
+			return;
+		}
+		if (m_bg_size == m_bg_energies.size()) {
+			field_x34 = field_x34 - m_bg_energies[m_bg_head];
+			m_bg_energies[m_bg_head] = energy;
+			m_bg_head = (m_bg_head + 1) % m_bg_energies.size();
+			return;
 		}
+		m_bg_energies[(m_bg_head + m_bg_size) % m_bg_energies.size()] = energy;
+		m_bg_size++;
 	}
 
 } // namespace snowboy
@@ -1,7 +1,7 @@
 #pragma once
-#include <deque>
 #include <matrix-wrapper.h>
 #include <stream-itf.h>
+#include <vector>
 
 struct AGC_Instance;
 struct NS3_Instance;
@@ -19,9 +19,17 @@ namespace snowboy {
 		RawEnergyVadStreamOptions m_options;
 		bool field_x2c;
 		float m_bg_energy; // might be
+		// Only ever decreases by the energies leaving the background buffer, as in the original library. Adding the
+		// energies as well would change the detections.
 		int field_x34;
-		std::deque<std::pair<unsigned int, float>> field_x38;
-		std::deque<float> field_x88;
+		// Ring buffer of the frame ids and log energies of the last frames read, oldest first
+		std::vector<std::pair<unsigned int, float>> m_raw_energies;
+		size_t m_raw_head;
+		size_t m_raw_size;
+		// Ring buffer of the last bg_buffer_size log energies of frames without voice
+		std::vector<float> m_bg_energies;
+		size_t m_bg_head;
+		size_t m_bg_size;
 		Matrix m_someMatrix;
 		std::vector<FrameInfo> field_xf0;
 
@@ -33,5 +41,10 @@ namespace snowboy {
 
 		void InitRawEnergyVad(Matrix*, std::vector<FrameInfo>*);
 		void UpdateBackgroundEnergy(const std::vector<FrameInfo>&);
+		// Makes room for at least `capacity` raw energies, keeping the buffered ones
+		void ReserveRawEnergies(size_t capacity);
+		void PushRawEnergy(unsigned int frame_id, float energy);
+		void PopRawEnergy();
+		void PushBackgroundEnergy(float energy);
 	};
 } // namespace snowboy
@@ -0,0 +1,233 @@
+#include "msvc_compat.h"
+#include <algorithm>
+#include <cmath>
+#include <frame-info.h>
+#include <frontend-lib.h>
+#include <matrix-wrapper.h>
+#include <resample-stream.h>
+#include <snowboy-error.h>
+#include <snowboy-options.h>
+#ifdef TSPL_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace snowboy {
+	namespace {
+		size_t Gcd(size_t a, size_t b) {
+			while (b != 0) {
+				auto t = a % b;
+				a = b;
+				b = t;
+			}
+			return a;
+		}
+
+		size_t RoundUp4(size_t x) {
+			return (x + 3) & ~static_cast<size_t>(3);
+		}
+
+#ifdef TSPL_HAVE_SSE2
+		float HorizontalSum(__m128 v) {
+			v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+			v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+			return _mm_cvtss_f32(v);
+		}
+#endif
+
+		// `len` is a multiple of 4
+		float DotProduct(const float* a, const float* b, size_t len) {
+#ifdef TSPL_HAVE_SSE2
+			__m128 acc = _mm_setzero_ps();
+			for (size_t i = 0; i < len; i += 4)
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+			return HorizontalSum(acc);
+#else
+			float res = 0.0f;
+			for (size_t i = 0; i < len; i++)
+				res += a[i] * b[i];
+			return res;
+#endif
+		}
+	} // namespace
+
+	void ResampleStreamOptions::Register(const std::string& prefix, OptionsItf* opts) {
+		opts->Register(prefix, "input-sample-rate", "Sampling rate of the input.", &input_sample_rate);
+		opts->Register(prefix, "output-sample-rate", "Sampling rate of the output.", &output_sample_rate);
+		opts->Register(prefix, "num-zeros", "Zero crossings of the sinc on either side of the filter centre.", &num_zeros);
+	}
+
+	ResampleStream::ResampleStream(const ResampleStreamOptions& options)
+		: m_options{options} {
+		if (m_options.input_sample_rate <= 0 || m_options.output_sample_rate <= 0)
+			throw snowboy_exception{"sample rates must be positive"};
+		if (m_options.num_zeros <= 0) throw snowboy_exception{"num-zeros must be positive"};
+		CreateFilter();
+		Reset();
+	}
+
+	void ResampleStream::CreateFilter() {
+		const size_t in_rate = m_options.input_sample_rate;
+		const size_t out_rate = m_options.output_sample_rate;
+		const auto gcd = Gcd(in_rate, out_rate);
+		m_input_period = in_rate / gcd;
+		m_output_period = out_rate / gcd;
+
+		// Hann windowed sinc, cut off just below the lower Nyquist frequency
+		const double cutoff = 0.99 * 0.5 * std::min(in_rate, out_rate);
+		const double width = m_options.num_zeros / (2.0 * cutoff);
+		auto filter = [&](double t) {
+			if (std::abs(t) >= width) return 0.0;
+			auto window = 0.5 * (1.0 + cos(2.0 * M_PI * cutoff / m_options.num_zeros * t));
+			auto sinc = t != 0.0 ? sin(2.0 * M_PI * cutoff * t) / (M_PI * t) : 2.0 * cutoff;
+			return window * sinc / in_rate;
+		};
+
+		m_decimate = m_output_period == 1;
+		if (m_decimate) {
+			// The output falls on an input sample, so the filter is symmetric around it
+			const auto half = static_cast<size_t>(std::floor(width * in_rate));
+			m_half_taps = RoundUp4(std::max<size_t>(half, 1));
+			m_half_weights.assign(m_half_taps + 1, 0.0f);
+			for (size_t k = 0; k <= half; k++)
+				m_half_weights[k] = filter(static_cast<double>(k) / in_rate);
+			m_num_taps = 2 * m_half_taps + 1;
+			return;
+		}
+
+		m_first_index.resize(m_output_period);
+		std::vector<int64_t> num_taps(m_output_period);
+		m_num_taps = 0;
+		for (size_t j = 0; j < m_output_period; j++) {
+			const double t = static_cast<double>(j) / out_rate;
+			const auto first = static_cast<int64_t>(std::ceil((t - width) * in_rate));
+			const auto last = static_cast<int64_t>(std::floor((t + width) * in_rate));
+			m_first_index[j] = first;
+			num_taps[j] = last - first + 1;
+			m_num_taps = std::max<size_t>(m_num_taps, num_taps[j]);
+		}
+		m_num_taps = RoundUp4(m_num_taps);
+		m_weights.assign(m_output_period * m_num_taps, 0.0f);
+		for (size_t j = 0; j < m_output_period; j++) {
+			const double t = static_cast<double>(j) / out_rate;
+			for (int64_t k = 0; k < num_taps[j]; k++)
+				m_weights[j * m_num_taps + k] = filter(static_cast<double>(m_first_index[j] + k) / in_rate - t);
+		}
+	}
+
+	int64_t ResampleStream::FirstInput(int64_t n) const {
+		if (m_decimate) return n * static_cast<int64_t>(m_input_period) - static_cast<int64_t>(m_half_taps);
+		return (n / static_cast<int64_t>(m_output_period)) * static_cast<int64_t>(m_input_period) + m_first_index[n % m_output_period];
+	}
+
+	int64_t ResampleStream::NumOutputs(int64_t input_count) const {
+		auto n = m_output_count;
+		while (FirstInput(n) + static_cast<int64_t>(m_num_taps) <= input_count)
+			n++;
+		return n - m_output_count;
+	}
+
+	void ResampleStream::ResampleRow(const float* buffer, int64_t first_output, size_t num_outputs, float* out) const {
+		if (m_decimate) {
+			// Folding the symmetric filter halves the multiplications: w0 x[0] + sum_k w_k (x[-k] + x[k])
+			const auto w = m_half_weights.data();
+			for (size_t i = 0; i < num_outputs; i++) {
+				const float* x = buffer + (FirstInput(first_output + i) - m_buffer_start) + m_half_taps;
+				size_t k = 1;
+#ifdef TSPL_HAVE_SSE2
+				__m128 acc = _mm_setzero_ps();
+				for (; k + 4 <= m_half_taps + 1; k += 4) {
+					const __m128 fwd = _mm_loadu_ps(x + k);
+					__m128 bwd = _mm_loadu_ps(x - k - 3);
+					bwd = _mm_shuffle_ps(bwd, bwd, _MM_SHUFFLE(0, 1, 2, 3));
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(w + k), _mm_add_ps(fwd, bwd)));
+				}
+				float sum = HorizontalSum(acc);
+#else
+				float sum = 0.0f;
+#endif
+				for (; k <= m_half_taps; k++)
+					sum += w[k] * (x[k] + x[-static_cast<ptrdiff_t>(k)]);
+				out[i] = sum + w[0] * x[0];
+			}
+			return;
+		}
+		for (size_t i = 0; i < num_outputs; i++) {
+			const auto n = first_output + i;
+			const auto phase = n % m_output_period;
+			out[i] = DotProduct(m_weights.data() + phase * m_num_taps, buffer + (FirstInput(n) - m_buffer_start), m_num_taps);
+		}
+	}
+
+	int ResampleStream::Read(Matrix* mat, std::vector<FrameInfo>* info) {
+		Matrix matrix_in;
+		auto sig = m_connectedStream->Read(&matrix_in, info);
+		if ((sig & 0xc2) != 0 || (matrix_in.m_cols == 0 && (sig & 0x18) == 0)) {
+			mat->Resize(0, 0);
+			info->clear();
+			return sig;
+		}
+		// An empty read at the end still flushes the filter tail of the previous reads
+		if (matrix_in.m_cols != 0) {
+			if (m_buffers.size() != matrix_in.m_rows) {
+				m_buffers.resize(matrix_in.m_rows);
+				Reset();
+			}
+			for (size_t r = 0; r < matrix_in.m_rows; r++) {
+				auto row = matrix_in.m_data + r * matrix_in.m_stride;
+				m_buffers[r].insert(m_buffers[r].end(), row, row + matrix_in.m_cols);
+			}
+			m_input_count += matrix_in.m_cols;
+		}
+
+		const bool flush = (sig & 0x18) != 0;
+		int64_t num_outputs = NumOutputs(m_input_count);
+		if (flush) {
+			// Every output before the end of the input, the missing samples after the end are zero
+			const int64_t total = (m_input_count * static_cast<int64_t>(m_output_period) + m_input_period - 1) / m_input_period;
+			num_outputs = std::max<int64_t>(total - m_output_count, 0);
+			if (num_outputs > 0) {
+				const auto needed = FirstInput(total - 1) + static_cast<int64_t>(m_num_taps) - m_buffer_start;
+				for (auto& e : m_buffers) {
+					if (static_cast<int64_t>(e.size()) < needed) e.resize(needed, 0.0f);
+				}
+			}
+		}
+
+		if (num_outputs == 0) {
+			mat->Resize(0, 0);
+		} else {
+			mat->Resize(m_buffers.size(), num_outputs, MatrixResizeType::kUndefined);
+			for (size_t r = 0; r < m_buffers.size(); r++)
+				ResampleRow(m_buffers[r].data(), m_output_count, num_outputs, mat->m_data + r * mat->m_stride);
+		}
+		m_output_count += num_outputs;
+
+		if (flush) {
+			Reset();
+		} else {
+			const auto consumed = FirstInput(m_output_count) - m_buffer_start;
+			if (consumed > 0) {
+				for (auto& e : m_buffers)
+					e.erase(e.begin(), e.begin() + consumed);
+				m_buffer_start += consumed;
+			}
+		}
+		return sig;
+	}
+
+	bool ResampleStream::Reset() {
+		m_input_count = 0;
+		m_output_count = 0;
+		// The samples before the start are zero
+		m_buffer_start = std::min<int64_t>(FirstInput(0), 0);
+		for (auto& e : m_buffers)
+			e.assign(-m_buffer_start, 0.0f);
+		return true;
+	}
+
+	std::string ResampleStream::Name() const {
+		return "ResampleStream";
+	}
+
+	ResampleStream::~ResampleStream() {}
+} // namespace snowboy
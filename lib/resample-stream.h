@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <stream-itf.h>
+#include <vector>
+
+namespace snowboy {
+	struct OptionsItf;
+	struct ResampleStreamOptions {
+		int input_sample_rate;
+		int output_sample_rate;
+		int num_zeros = 8;
+		void Register(const std::string&, OptionsItf*);
+	};
+	// Converts the sample rate with a polyphase windowed sinc filter, the filter design follows Kaldi's LinearResample.
+	// Each row of the input is resampled on its own.
+	class ResampleStream : public StreamItf {
+		ResampleStreamOptions m_options;
+		// The filter phases repeat every m_output_period output samples, which span m_input_period input samples
+		size_t m_input_period;
+		size_t m_output_period;
+		size_t m_num_taps;
+		// Per phase the first input sample relative to the start of the period and m_num_taps weights
+		std::vector<int64_t> m_first_index;
+		std::vector<float> m_weights;
+		// Integer decimation uses the symmetric filter of its single phase: the centre weight followed by the weights
+		// on either side, padded to m_half_taps
+		bool m_decimate;
+		size_t m_half_taps;
+		std::vector<float> m_half_weights;
+
+		// Input samples still needed, one buffer per row. m_buffer_start is the index of their first sample in the
+		// whole input and negative for the zeros padding the start.
+		std::vector<std::vector<float>> m_buffers;
+		int64_t m_buffer_start;
+		int64_t m_input_count;
+		int64_t m_output_count;
+
+		void CreateFilter();
+		// Number of output samples whose input is complete when the input has `input_count` samples
+		int64_t NumOutputs(int64_t input_count) const;
+		// First input sample output `n` reads
+		int64_t FirstInput(int64_t n) const;
+		void ResampleRow(const float* buffer, int64_t first_output, size_t num_outputs, float* out) const;
+
+	public:
+		ResampleStream(const ResampleStreamOptions& options);
+		virtual int Read(Matrix* mat, std::vector<FrameInfo>* info) override;
+		virtual bool Reset() override;
+		virtual std::string Name() const override;
+		virtual ~ResampleStream();
+	};
+} // namespace snowboy
@@ -212,6 +212,75 @@ extern "C"
 		}
 	}
 
+	int SNOWMAN_Detect_SetInputSampleRate(SNOWMAN_Detect* instance, int sample_rate) {
+		if (instance == nullptr) {
+			errno = EINVAL;
+			return -1;
+		}
+		try {
+			instance->SetInputSampleRate(sample_rate);
+			return 0;
+		} catch (...) {
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	int SNOWMAN_Detect_SetNumChannels(SNOWMAN_Detect* instance, int num_channels) {
+		if (instance == nullptr) {
+			errno = EINVAL;
+			return -1;
+		}
+		try {
+			instance->SetNumChannels(num_channels);
+			return 0;
+		} catch (...) {
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	int SNOWMAN_Detect_SetChannelMix(SNOWMAN_Detect* instance, const char* method) {
+		if (instance == nullptr || method == nullptr) {
+			errno = EINVAL;
+			return -1;
+		}
+		try {
+			instance->SetChannelMix(method);
+			return 0;
+		} catch (...) {
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	int SNOWMAN_Detect_SetPowerSaving(SNOWMAN_Detect* instance, int enable) {
+		if (instance == nullptr) {
+			errno = EINVAL;
+			return -1;
+		}
+		try {
+			instance->SetPowerSaving(enable != 0);
+			return 0;
+		} catch (...) {
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	int SNOWMAN_Detect_GetLastDetectionChannel(SNOWMAN_Detect* instance) {
+		if (instance == nullptr) {
+			errno = EINVAL;
+			return -1;
+		}
+		try {
+			return instance->GetLastDetectionChannel();
+		} catch (...) {
+			errno = EIO;
+			return -1;
+		}
+	}
+
 	int SNOWMAN_Detect_SampleRate(SNOWMAN_Detect* instance) {
 		if (instance == nullptr) {
 			errno = EINVAL;
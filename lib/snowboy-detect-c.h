@@ -25,6 +25,11 @@ extern "C"
 	int SNOWMAN_Detect_UpdateModel(SNOWMAN_Detect* instance);
 	int SNOWMAN_Detect_NumHotwords(SNOWMAN_Detect* instance);
 	int SNOWMAN_Detect_ApplyFrontend(SNOWMAN_Detect* instance, int apply);
+	int SNOWMAN_Detect_SetInputSampleRate(SNOWMAN_Detect* instance, int sample_rate);
+	int SNOWMAN_Detect_SetNumChannels(SNOWMAN_Detect* instance, int num_channels);
+	int SNOWMAN_Detect_SetChannelMix(SNOWMAN_Detect* instance, const char* method);
+	int SNOWMAN_Detect_SetPowerSaving(SNOWMAN_Detect* instance, int enable);
+	int SNOWMAN_Detect_GetLastDetectionChannel(SNOWMAN_Detect* instance);
 	int SNOWMAN_Detect_SampleRate(SNOWMAN_Detect* instance);
 	int SNOWMAN_Detect_NumChannels(SNOWMAN_Detect* instance);
 	int SNOWMAN_Detect_BitsPerSample(SNOWMAN_Detect* instance);
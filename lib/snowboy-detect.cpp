@@ -7,9 +7,14 @@
 #include <pipeline-vad.h>
 #include <snowboy-detect.h>
 #include <snowboy-error.h>
+#include <snowboy-io.h>
 #include <wave-header.h>
 
 namespace snowboy {
+	void SnowboyDetect::SetModelCacheDirectory(const std::string& directory) {
+		snowboy::SetModelCacheDirectory(directory);
+	}
+
 	SnowboyDetect::SnowboyDetect(const std::string& resource_filename, const std::string& model_str) {
 		PipelineDetectOptions options{};
 		options.applyFrontend = false;
@@ -21,6 +26,7 @@ namespace snowboy {
 
 		wave_header_.reset(new WaveHeader{});
 		wave_header_->dwSamplesPerSec = detect_pipeline_->GetPipelineSampleRate();
+		input_.reset(new Matrix{});
 		detect_pipeline_->SetMaxAudioAmplitude(GetMaxWaveAmplitude(*wave_header_));
 	}
 
@@ -36,58 +42,29 @@ namespace snowboy {
 
 	int SnowboyDetect::RunDetection(const std::string& data, bool is_end) {
 		if ((data.size() % wave_header_->wBlockAlign) != 0) return -1;
-		Matrix data_mat;
-		ReadRawWaveFromString(*wave_header_, data, &data_mat);
-		return detect_pipeline_->RunDetection(data_mat, is_end);
+		ReadRawWaveFromString(*wave_header_, data, input_.get());
+		return detect_pipeline_->RunDetection(*input_, is_end);
 	}
 
 	int SnowboyDetect::RunDetection(const float* const data, const int array_length, bool is_end) {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyDetect: data is NULL"};
-		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
-		mat.Scale(GetMaxWaveAmplitude(*wave_header_));
-		return detect_pipeline_->RunDetection(mat, is_end);
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, GetMaxWaveAmplitude(*wave_header_), input_.get());
+		return detect_pipeline_->RunDetection(*input_, is_end);
 	}
 
 	int SnowboyDetect::RunDetection(const int16_t* const data, const int array_length, bool is_end) {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyDetect: data is NULL"};
-		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
-		return detect_pipeline_->RunDetection(mat, is_end);
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, input_.get());
+		return detect_pipeline_->RunDetection(*input_, is_end);
 	}
 
 	int SnowboyDetect::RunDetection(const int32_t* const data, const int array_length, bool is_end) {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyDetect: data is NULL"};
-		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
-		return detect_pipeline_->RunDetection(mat, is_end);
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, input_.get());
+		return detect_pipeline_->RunDetection(*input_, is_end);
 	}
 
 	void SnowboyDetect::SetSensitivity(const std::string& sensitivity_str) {
@@ -114,10 +91,71 @@ namespace snowboy {
 		return detect_pipeline_->NumHotwords();
 	}
 
+	uint64_t SnowboyDetect::GetLastDetectionFrameId() const {
+		return detect_pipeline_->GetLastDetectionFrameId();
+	}
+
+	float SnowboyDetect::GetLastDetectionScore() const {
+		return detect_pipeline_->GetLastDetectionScore();
+	}
+
+	int SnowboyDetect::GetLastDetectionChannel() const {
+		return detect_pipeline_->GetLastDetectionChannel();
+	}
+
+	void SnowboyDetect::ReplaceModels(const std::string& model_str) {
+		detect_pipeline_->ReplaceModels(model_str);
+	}
+
+	std::vector<float> SnowboyDetect::GetModelLoadTimes() const {
+		return detect_pipeline_->GetModelLoadTimes();
+	}
+
+	void SnowboyDetect::SetFrameScoreSink(FrameScoreSink* sink) {
+		detect_pipeline_->SetFrameScoreSink(sink);
+	}
+
+	void SnowboyDetect::StartScoreTrace(float min_rerun_seconds) {
+		detect_pipeline_->StartScoreTrace(min_rerun_seconds);
+	}
+
+	void SnowboyDetect::StopScoreTrace() {
+		detect_pipeline_->StopScoreTrace();
+	}
+
+	std::vector<HotwordDetection> SnowboyDetect::EvaluateScoreTrace(const std::string& sensitivity_str, const std::string& high_sensitivity_str) {
+		return detect_pipeline_->EvaluateScoreTrace(sensitivity_str, high_sensitivity_str);
+	}
+
 	void SnowboyDetect::ApplyFrontend(const bool apply_frontend) {
 		detect_pipeline_->ApplyFrontend(apply_frontend);
 	}
 
+	void SnowboyDetect::SetInputSampleRate(int sample_rate) {
+		detect_pipeline_->SetInputSampleRate(sample_rate);
+		wave_header_->dwSamplesPerSec = sample_rate;
+		wave_header_->dwAvgBytesPerSec = sample_rate * wave_header_->wBlockAlign;
+	}
+
+	void SnowboyDetect::SetNumChannels(int num_channels) {
+		if (num_channels <= 0) throw snowboy_exception{"number of channels must be positive"};
+		wave_header_->wChannels = num_channels;
+		wave_header_->wBlockAlign = num_channels * (wave_header_->wBitsPerSample / 8);
+		wave_header_->dwAvgBytesPerSec = wave_header_->dwSamplesPerSec * wave_header_->wBlockAlign;
+	}
+
+	void SnowboyDetect::SetChannelMix(const std::string& method) {
+		detect_pipeline_->SetChannelMix(method);
+	}
+
+	void SnowboyDetect::SetPowerSaving(bool enable) {
+		detect_pipeline_->SetPowerSaving(enable);
+	}
+
+	uint64_t SnowboyDetect::GetPowerSavingSkippedFrames() const {
+		return detect_pipeline_->GetPowerSavingSkippedFrames();
+	}
+
 	int SnowboyDetect::SampleRate() const {
 		return wave_header_->dwSamplesPerSec;
 	}
@@ -140,6 +178,7 @@ namespace snowboy {
 
 		wave_header_.reset(new WaveHeader{});
 		wave_header_->dwSamplesPerSec = vad_pipeline_->GetPipelineSampleRate();
+		input_.reset(new Matrix{});
 		vad_pipeline_->SetMaxAudioAmplitude(GetMaxWaveAmplitude(*wave_header_));
 	}
 
@@ -155,58 +194,29 @@ namespace snowboy {
 
 	int SnowboyVad::RunVad(const std::string& data, bool is_end) {
 		if ((data.size() % wave_header_->wBlockAlign) != 0) return -1;
-		Matrix data_mat;
-		ReadRawWaveFromString(*wave_header_, data, &data_mat);
-		return vad_pipeline_->RunVad(data_mat, is_end);
+		ReadRawWaveFromString(*wave_header_, data, input_.get());
+		return vad_pipeline_->RunVad(*input_, is_end);
 	}
 
 	int SnowboyVad::RunVad(const float* const data, const int array_length, bool is_end) {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyVad: data is NULL"};
-		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
-		mat.Scale(GetMaxWaveAmplitude(*wave_header_));
-		return vad_pipeline_->RunVad(mat, is_end);
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, GetMaxWaveAmplitude(*wave_header_), input_.get());
+		return vad_pipeline_->RunVad(*input_, is_end);
 	}
 
 	int SnowboyVad::RunVad(const int16_t* const data, const int array_length, bool is_end) {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyVad: data is NULL"};
-		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
-		return vad_pipeline_->RunVad(mat, is_end);
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, input_.get());
+		return vad_pipeline_->RunVad(*input_, is_end);
 	}
 
 	int SnowboyVad::RunVad(const int32_t* const data, const int array_length, bool is_end) {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyVad: data is NULL"};
-		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
-		return vad_pipeline_->RunVad(mat, is_end);
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, input_.get());
+		return vad_pipeline_->RunVad(*input_, is_end);
 	}
 
 	void SnowboyVad::SetAudioGain(const float audio_gain) {
@@ -252,16 +262,7 @@ namespace snowboy {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyPersonalEnroll: data is NULL"};
 		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
-		mat.Scale(GetMaxWaveAmplitude(*wave_header_));
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, GetMaxWaveAmplitude(*wave_header_), &mat);
 		return RunEnrollment(mat);
 	}
 
@@ -269,15 +270,7 @@ namespace snowboy {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyPersonalEnroll: data is NULL"};
 		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, &mat);
 		return RunEnrollment(mat);
 	}
 
@@ -285,15 +278,7 @@ namespace snowboy {
 		if (data == nullptr)
 			throw snowboy_exception{"SnowboyPersonalEnroll: data is NULL"};
 		Matrix mat;
-		mat.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		// No idea if this is correct, but it looks right...
-		for (size_t c = 0; c < mat.cols(); c++)
-		{
-			for (size_t r = 0; r < mat.rows(); r++)
-			{
-				mat(r, c) = data[c * mat.rows() + r];
-			}
-		}
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, &mat);
 		return RunEnrollment(mat);
 	}
 
@@ -356,11 +341,7 @@ namespace snowboy {
 		if (data == nullptr || data_out == nullptr)
 			throw snowboy_exception{"SnowboyPersonalEnroll: data or data_out is NULL"};
 		Matrix mat_data, mat_out;
-		mat_data.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		for (size_t c = 0; c < mat_data.cols(); c++)
-			for (size_t r = 0; r < mat_data.rows(); r++)
-				mat_data(r, c) = data[c * mat_data.rows() + r];
-		mat_data.Scale(GetMaxWaveAmplitude(*wave_header_));
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, GetMaxWaveAmplitude(*wave_header_), &mat_data);
 		auto res = cut_pipeline_->CutTemplate(mat_data, &mat_out);
 		if ((res & 2) == 0) {
 			for (size_t c = 0; c < mat_out.cols(); c++)
@@ -376,10 +357,7 @@ namespace snowboy {
 		if (data == nullptr || data_out == nullptr)
 			throw snowboy_exception{"SnowboyPersonalEnroll: data or data_out is NULL"};
 		Matrix mat_data, mat_out;
-		mat_data.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		for (size_t c = 0; c < mat_data.cols(); c++)
-			for (size_t r = 0; r < mat_data.rows(); r++)
-				mat_data(r, c) = data[c * mat_data.rows() + r];
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, &mat_data);
 		auto res = cut_pipeline_->CutTemplate(mat_data, &mat_out);
 		if ((res & 2) == 0) {
 			for (size_t c = 0; c < mat_out.cols(); c++)
@@ -395,10 +373,7 @@ namespace snowboy {
 		if (data == nullptr || data_out == nullptr)
 			throw snowboy_exception{"SnowboyPersonalEnroll: data or data_out is NULL"};
 		Matrix mat_data, mat_out;
-		mat_data.Resize(wave_header_->wChannels, array_length / wave_header_->wChannels, MatrixResizeType::kSetZero);
-		for (size_t c = 0; c < mat_data.cols(); c++)
-			for (size_t r = 0; r < mat_data.rows(); r++)
-				mat_data(r, c) = data[c * mat_data.rows() + r];
+		DeinterleaveSamples(data, wave_header_->wChannels, array_length / wave_header_->wChannels, &mat_data);
 		mat_data.Scale(GetMaxWaveAmplitude(*wave_header_));
 		auto res = cut_pipeline_->CutTemplate(mat_data, &mat_out);
 		if ((res & 2) == 0) {
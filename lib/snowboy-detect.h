@@ -1,6 +1,8 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace snowboy {
 	namespace testing {
@@ -11,7 +13,21 @@ namespace snowboy {
 	struct PipelineVad;
 	class PipelinePersonalEnroll;
 	class PipelineTemplateCut;
+	struct Matrix;
 	struct MatrixBase;
+	class FrameScoreSink;
+
+	/**
+	 * \brief Hotword found by SnowboyDetect::EvaluateScoreTrace().
+	 */
+	struct HotwordDetection {
+		/** Index of the hotword, as returned by RunDetection() */
+		int hotword;
+		/** Frame of the detection, see SnowboyDetect::GetLastDetectionFrameId() */
+		uint64_t frame_id;
+		/** Score of the detection, see SnowboyDetect::GetLastDetectionScore() */
+		float score;
+	};
 
 	/**
 	 * \brief Hotword detector class.
@@ -48,6 +64,20 @@ namespace snowboy {
 		SnowboyDetect(const std::string& resource_filename,
 					  const std::string& model_str);
 
+		/**
+		 * \brief Sets the directory of the model cache.
+		 *
+		 * Once set, every detector converts its resource and models into
+		 * model containers stored in <directory>, and later detectors map
+		 * those instead of parsing the original files. Entries are keyed by
+		 * path, size and modification time of the original file, so changed
+		 * models are converted again. The directory has to exist. An empty
+		 * string disables the cache, which is the default.
+		 *
+		 * @param [in]  directory   Directory of the cache.
+		 */
+		static void SetModelCacheDirectory(const std::string& directory);
+
 		/**
 		 * \brief Resets the detection.
 		 *
@@ -213,6 +243,123 @@ namespace snowboy {
 		 */
 		int NumHotwords() const;
 
+		/**
+		 * \brief Returns the frame of the last detected hotword.
+		 *
+		 * Frames are 10 ms apart and counted from the start of the audio,
+		 * counting restarts after a call of RunDetection() with is_end set.
+		 *
+		 * \return Frame id of the hotword returned by the last detection.
+		 */
+		uint64_t GetLastDetectionFrameId() const;
+
+		/**
+		 * \brief Returns the score of the last detected hotword.
+		 *
+		 * For universal models this is the posterior of the hotword, for
+		 * personal models the fraction of templates that matched.
+		 *
+		 * \return Score of the hotword returned by the last detection.
+		 */
+		float GetLastDetectionScore() const;
+
+		/**
+		 * \brief Returns the channel that heard the last detected hotword.
+		 *
+		 * Only set with SetChannelMix("separate"), otherwise the channels are
+		 * combined before detection and this is always 0.
+		 *
+		 * \return Index of the channel in the interleaved audio.
+		 */
+		int GetLastDetectionChannel() const;
+
+		/**
+		 * \brief Replaces the hotword models.
+		 *
+		 * Loads the models in <model_str> and swaps them in between two calls
+		 * of RunDetection(), so audio that is already buffered and the
+		 * background estimates of the VAD are kept. This may be called from
+		 * another thread while RunDetection() is running; detection is only
+		 * blocked for the swap itself. Sensitivities are reset to the defaults
+		 * of the new models and the hotword indices follow <model_str>.
+		 *
+		 * @param [in]  model_str           A string of multiple hotword models,
+		 *                                  separated by comma.
+		 */
+		void ReplaceModels(const std::string& model_str);
+
+		/**
+		 * \brief Returns the time it took to load each model.
+		 *
+		 * Models are parsed in parallel, so the sum can exceed the
+		 * construction time of the detector.
+		 *
+		 * \return Load time in milliseconds of each model in <model_str>.
+		 */
+		std::vector<float> GetModelLoadTimes() const;
+
+		/**
+		 * \brief Exports the per-frame scores of the detector.
+		 *
+		 * While set, <sink> receives the posterior of every universal
+		 * keyword and the DTW distance of every personal template at each
+		 * step of the detection, together with the frame id and VAD flags.
+		 * See frame-score-sink.h for a buffered trace file writer and an
+		 * in-memory ring buffer.
+		 *
+		 * @param [in]  sink  Receiver of the scores, nullptr to disable. It is
+		 *                    not owned and has to outlive its use.
+		 */
+		void SetFrameScoreSink(FrameScoreSink* sink);
+
+		/**
+		 * \brief Starts recording a score trace.
+		 *
+		 * Until StopScoreTrace() is called, RunDetection() keeps the raw
+		 * per-frame scores of the hotword models instead of detecting and
+		 * never returns a hotword. EvaluateScoreTrace() then finds the
+		 * detections of the recorded audio for any sensitivity, which is
+		 * much cheaper than running the audio once per sensitivity.
+		 * Only universal models are supported.
+		 *
+		 * @param [in]  min_rerun_seconds  Audio run again after a detection
+		 *                                 before the scores of the whole audio
+		 *                                 may be used, see EvaluateScoreTrace().
+		 *                                 0 never uses them.
+		 */
+		void StartScoreTrace(float min_rerun_seconds = 0);
+
+		/**
+		 * \brief Drops the score trace and resumes normal detection.
+		 */
+		void StopScoreTrace();
+
+		/**
+		 * \brief Finds the detections in the recorded score trace.
+		 *
+		 * Returns the hotwords RunDetection() would have returned for the
+		 * recorded audio on a freshly constructed detector, had SetSensitivity()
+		 * and SetHighSensitivity() been called with the given values. A
+		 * detection resets the detector, so the audio following the chunk a
+		 * detection happened in is run again up to the next detection and
+		 * kept for later calls. With min_rerun_seconds passed to
+		 * StartScoreTrace() it is only run until, after that much audio, a
+		 * chunk gives the same frames, scores and VAD flags as the whole
+		 * audio, whose scores are used from there on. The VAD may still
+		 * differ in state it does not show, so the detections can then
+		 * differ from a full run.
+		 * All audio has to be recorded before the first call.
+		 *
+		 * @param [in]  sensitivity_str      Sensitivities as in SetSensitivity(),
+		 *                                   empty to keep the current ones.
+		 * @param [in]  high_sensitivity_str High sensitivities as in
+		 *                                   SetHighSensitivity(), empty to keep
+		 *                                   the current ones.
+		 * \return Detections in the order they occur in the audio.
+		 */
+		std::vector<HotwordDetection> EvaluateScoreTrace(const std::string& sensitivity_str,
+														 const std::string& high_sensitivity_str = "");
+
 		/**
 		 * \brief Enable or disable audio frontend (NS & AGC).
 		 *
@@ -229,6 +376,69 @@ namespace snowboy {
 		 */
 		void ApplyFrontend(const bool apply_frontend);
 
+		/**
+		 * \brief Declares the sample rate of the audio passed to RunDetection().
+		 *
+		 * The detector runs at 16000 Hz. Audio of any other rate, e.g. 48000 Hz
+		 * from a capture device, is resampled internally, with a fast path for
+		 * integer ratios such as 48000 Hz. SampleRate() returns the new rate
+		 * afterwards.
+		 *
+		 * \param [in] sample_rate Sample rate of the audio in Hz
+		 */
+		void SetInputSampleRate(int sample_rate);
+
+		/**
+		 * \brief Declares the number of interleaved channels passed to RunDetection().
+		 *
+		 * The channels are combined into one before detection, or detected
+		 * on separately, see SetChannelMix(). NumChannels() returns the new count afterwards.
+		 *
+		 * \param [in] num_channels Number of channels, e.g. 4 for a 4 mic array
+		 */
+		void SetNumChannels(int num_channels);
+
+		/**
+		 * \brief Sets how multi-channel audio is combined into one channel.
+		 *
+		 * - "beamform" (default): delay-and-sum beamforming. Every channel is
+		 *   delayed onto the first one by the lag maximizing their cross
+		 *   correlation, then the channels are averaged.
+		 * - "select": passes the loudest channel, switching only to a clearly
+		 *   louder one.
+		 * - "first": passes only the first channel, like the original library.
+		 * - "separate": detects on every channel on its own and reports the
+		 *   channel of a hotword with GetLastDetectionChannel(). The models are
+		 *   loaded once and the networks evaluate all channels in one batch.
+		 *   Only supported for universal models.
+		 *
+		 * \param [in] method One of "beamform", "select", "first" or "separate"
+		 */
+		void SetChannelMix(const std::string& method);
+
+		/**
+		 * \brief Skips the expensive part of detection during silence.
+		 *
+		 * While the VAD network hears no voice, audio close to the background
+		 * energy is dropped before the FFT instead of running through the FFT,
+		 * MFCC and the VAD network. When the energy rises again, the last
+		 * dropped audio is processed first, so the VAD's look-back in front of
+		 * speech is the same as without power saving. Off by default.
+		 *
+		 * \param [in] enable True to skip silence
+		 */
+		void SetPowerSaving(bool enable);
+
+		/**
+		 * \brief Returns how much audio power saving skipped.
+		 *
+		 * Counts the frames of all channels since power saving was last
+		 * enabled, or since the channel mix was changed.
+		 *
+		 * \return Number of 10 ms frames that were not run through the FFT.
+		 */
+		uint64_t GetPowerSavingSkippedFrames() const;
+
 		/**
 		 * \brief Returns the expected sample rate for audio provided to RunDetection().
 		 * \return The expected samplerate.
@@ -253,6 +463,8 @@ namespace snowboy {
 	private:
 		std::unique_ptr<WaveHeader> wave_header_;
 		std::unique_ptr<PipelineDetect> detect_pipeline_;
+		// Deinterleaved audio of the last call, reused so streaming does not allocate per chunk
+		std::unique_ptr<Matrix> input_;
 	};
 
 	/**
@@ -414,6 +626,8 @@ namespace snowboy {
 	private:
 		std::unique_ptr<WaveHeader> wave_header_;
 		std::unique_ptr<PipelineVad> vad_pipeline_;
+		// Deinterleaved audio of the last call, reused so streaming does not allocate per chunk
+		std::unique_ptr<Matrix> input_;
 	};
 
 	/**
@@ -1,9 +1,36 @@
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
 #include <snowboy-error.h>
 #include <snowboy-io.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace snowboy {
 	std::string global_snowboy_offset_delimiter{1, char(1)};
 	std::string global_snowboy_string_delimiter{","};
+	const char global_snowboy_container_magic[8] = {'\0', 'S', 'n', 'o', 'w', 'M', 'd', 'l'};
 
 	void CheckToken(const char* token) {
 		if (token == nullptr || *token == '\0')
@@ -134,6 +161,176 @@ namespace snowboy {
 		WriteToken(binary, token.c_str(), os);
 	}
 
+	static bool IsTextSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+	}
+
+	// Parses the integer in [begin, end), returns false if it is not a complete integer
+	template <typename T>
+	static bool ParseTextNumber(const char* begin, const char* end, T* res) {
+		if (begin == end) return false;
+		bool negative = *begin == '-';
+		if (*begin == '-' || *begin == '+') begin++;
+		if (begin == end) return false;
+		uint64_t value = 0;
+		for (; begin != end; begin++) {
+			if (*begin < '0' || *begin > '9' || value > std::numeric_limits<uint64_t>::max() / 10) return false;
+			value = value * 10 + (*begin - '0');
+			if (value > static_cast<uint64_t>(std::numeric_limits<T>::max()) + 1) return false;
+		}
+		if (!negative && value > static_cast<uint64_t>(std::numeric_limits<T>::max())) return false;
+		*res = negative ? static_cast<T>(0 - value) : static_cast<T>(value);
+		return true;
+	}
+
+	// Parses the float in [begin, end). Numbers with at most 19 significant digits and a small exponent are
+	// computed exactly in double precision and rounded once to float; strtof handles everything else.
+	template <>
+	bool ParseTextNumber<float>(const char* begin, const char* end, float* res) {
+		static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+		if (begin == end) return false;
+		auto p = begin;
+		bool negative = *p == '-';
+		if (*p == '-' || *p == '+') p++;
+		uint64_t mantissa = 0;
+		int digits = 0, exponent = 0;
+		bool any_digit = false, truncated = false;
+		for (; p != end && *p >= '0' && *p <= '9'; p++, any_digit = true) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) digits++;
+			} else {
+				truncated |= *p != '0';
+				exponent++;
+			}
+		}
+		if (p != end && *p == '.') {
+			for (p++; p != end && *p >= '0' && *p <= '9'; p++, any_digit = true) {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa != 0) digits++;
+					exponent--;
+				} else
+					truncated |= *p != '0';
+			}
+		}
+		if (any_digit && p != end && (*p == 'e' || *p == 'E')) {
+			int e = 0;
+			if (!ParseTextNumber<int>(p + 1, end, &e)) return false;
+			exponent += std::max(-1000, std::min(1000, e));
+			p = end;
+		}
+		if (any_digit && !truncated && p == end && mantissa <= (uint64_t{1} << 53) && exponent >= -22 && exponent <= 22) {
+			double d = exponent < 0 ? mantissa / powers[-exponent] : mantissa * powers[exponent];
+			// A double that lies exactly between two floats could have been rounded onto the midpoint, and
+			// subnormal floats round at a different bit, both are left to strtof.
+			uint64_t bits;
+			memcpy(&bits, &d, sizeof(bits));
+			if ((d == 0.0 || d >= FLT_MIN) && d <= FLT_MAX && (bits & 0x1fffffff) != 0x10000000) {
+				*res = static_cast<float>(negative ? -d : d);
+				return true;
+			}
+		}
+		char buf[128];
+		if (end - begin >= static_cast<ptrdiff_t>(sizeof(buf))) return false;
+		memcpy(buf, begin, end - begin);
+		buf[end - begin] = '\0';
+		char* parsed = nullptr;
+		*res = strtof(buf, &parsed);
+		return parsed == buf + (end - begin) && parsed != buf;
+	}
+
+	// Returns the memory the stream reads from if it is backed by a MemoryStreamBuf
+	static MemoryStreamBuf* TextBuffer(std::istream* is) {
+		return dynamic_cast<MemoryStreamBuf*>(is->rdbuf());
+	}
+
+	// Reads one whitespace delimited text token, in place if possible
+	template <typename T>
+	static bool ReadTextNumber(std::istream* is, T* t) {
+		if (auto buffer = TextBuffer(is)) {
+			const char* p = buffer->Current();
+			const char* end = p + buffer->Remaining();
+			while (p != end && IsTextSpace(*p))
+				p++;
+			auto begin = p;
+			while (p != end && !IsTextSpace(*p))
+				p++;
+			if (begin == p || !ParseTextNumber<T>(begin, p, t)) return false;
+			is->seekg(p - buffer->Current(), std::ios_base::cur);
+			return true;
+		}
+		std::string token;
+		*is >> token;
+		return !token.empty() && ParseTextNumber<T>(token.data(), token.data() + token.size(), t);
+	}
+
+	template <typename T>
+	static void ParseTextBlock(const char* p, const char* end, std::vector<T>* values, std::vector<size_t>* row_lengths) {
+		size_t row_start = values->size();
+		while (p != end) {
+			if (*p == '\n') {
+				if (row_lengths != nullptr && values->size() != row_start) row_lengths->push_back(values->size() - row_start);
+				row_start = values->size();
+			}
+			if (IsTextSpace(*p)) {
+				p++;
+				continue;
+			}
+			auto begin = p;
+			while (p != end && !IsTextSpace(*p))
+				p++;
+			T value;
+			if (!ParseTextNumber<T>(begin, p, &value))
+				throw snowboy_exception{"Fail to read number in text block: \"" + std::string(begin, std::min<size_t>(p - begin, 32)) + "\""};
+			values->push_back(value);
+		}
+		if (row_lengths != nullptr && values->size() != row_start) row_lengths->push_back(values->size() - row_start);
+	}
+
+	template <typename T>
+	void ReadTextBlock(std::istream* is, std::vector<T>* values, std::vector<size_t>* row_lengths) {
+		values->clear();
+		if (row_lengths != nullptr) row_lengths->clear();
+		if (auto buffer = TextBuffer(is)) {
+			const char* p = buffer->Current();
+			const char* end = p + buffer->Remaining();
+			while (p != end && IsTextSpace(*p))
+				p++;
+			if (p == end || *p != '[')
+				throw snowboy_exception{"Expected token \"[\" at position " + std::to_string(buffer->Position())};
+			auto close = static_cast<const char*>(memchr(p, ']', end - p));
+			if (close == nullptr) throw snowboy_exception{"Fail to read text block: missing \"]\""};
+			ParseTextBlock(p + 1, close, values, row_lengths);
+			is->seekg(close + 1 - buffer->Current(), std::ios_base::cur);
+			return;
+		}
+		ExpectToken(false, "[", is);
+		std::string block;
+		std::getline(*is, block, ']');
+		if (!*is || is->eof()) throw snowboy_exception{"Fail to read text block: missing \"]\""};
+		ParseTextBlock(block.data(), block.data() + block.size(), values, row_lengths);
+	}
+
+	template void ReadTextBlock<float>(std::istream* is, std::vector<float>* values, std::vector<size_t>* row_lengths);
+	template void ReadTextBlock<int>(std::istream* is, std::vector<int>* values, std::vector<size_t>* row_lengths);
+
+	void WriteTextValues(const float* values, size_t count, std::ostream* os) {
+		// Formatted in blocks, a stream insertion per value is several times slower
+		std::string out;
+		char buf[32];
+		for (size_t i = 0; i < count; i++) {
+			auto len = snprintf(buf, sizeof(buf), "%.9g ", values[i]);
+			out.append(buf, len);
+			if (out.size() > 4096) {
+				os->write(out.data(), out.size());
+				out.clear();
+			}
+		}
+		os->write(out.data(), out.size());
+	}
+
 	template <>
 	void ReadBasicType<bool>(bool binary, bool* t, std::istream* is) {
 		if (!binary) {
@@ -153,7 +350,7 @@ namespace snowboy {
 	template <>
 	void ReadBasicType<float>(bool binary, float* t, std::istream* is) {
 		if (!binary) {
-			*is >> *t;
+			if (!ReadTextNumber(is, t)) is->setstate(std::ios_base::failbit);
 		} else {
 			auto c = is->peek();
 			if (c == sizeof(float)) {
@@ -170,7 +367,7 @@ namespace snowboy {
 	template <>
 	void ReadBasicType<int32_t>(bool binary, int32_t* t, std::istream* is) {
 		if (!binary) {
-			*is >> *t;
+			if (!ReadTextNumber(is, t)) is->setstate(std::ios_base::failbit);
 		} else {
 			auto c = is->peek();
 			if (c == sizeof(int32_t)) {
@@ -187,7 +384,7 @@ namespace snowboy {
 	template <>
 	void ReadBasicType<int64_t>(bool binary, int64_t* t, std::istream* is) {
 		if (!binary) {
-			*is >> *t;
+			if (!ReadTextNumber(is, t)) is->setstate(std::ios_base::failbit);
 		} else {
 			auto c = is->peek();
 			if (c == sizeof(int64_t)) {
@@ -269,15 +466,7 @@ namespace snowboy {
 	template <>
 	void ReadIntegerVector<int>(bool binary, std::vector<int>* data, std::istream* is) {
 		if (!binary) {
-			ExpectToken(binary, "[", is);
-			*is >> std::ws;
-			for (auto c = is->peek(); c != ']'; c = is->peek()) {
-				int x;
-				*is >> x >> std::ws;
-				if (!*is) throw snowboy_exception{"Fail to ReadIntegerVector."};
-				data->push_back(x);
-			}
-			is->get(); // read closing bracket
+			ReadTextBlock<int>(is, data, nullptr);
 		} else {
 			auto c = is->peek();
 			if (c != sizeof(int))
@@ -311,11 +500,230 @@ namespace snowboy {
 		if (!*os) throw snowboy_exception{"Fail to write integer vector in WriteIntegerVector()."};
 	}
 
-	Output::Output(const std::string& filename, bool binary) {
+	static std::atomic<size_t> num_mappings{0};
+
+	MappedFile::MappedFile(const std::string& filename) {
+#ifdef _WIN32
+		auto file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw snowboy_exception{"Fail to open input file \"" + filename + "\""};
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) {
+			CloseHandle(file);
+			throw snowboy_exception{"Fail to get size of input file \"" + filename + "\""};
+		}
+		m_size = static_cast<size_t>(size.QuadPart);
+		if (m_size != 0) {
+			m_mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			if (m_mapping != nullptr) m_data = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0));
+		}
+		CloseHandle(file);
+		if (m_size != 0 && m_data == nullptr) {
+			if (m_mapping != nullptr) CloseHandle(m_mapping);
+			throw snowboy_exception{"Fail to map input file \"" + filename + "\""};
+		}
+#else
+		auto fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw snowboy_exception{"Fail to open input file \"" + filename + "\""};
+		struct stat stat_buf;
+		if (fstat(fd, &stat_buf) != 0) {
+			close(fd);
+			throw snowboy_exception{"Fail to get size of input file \"" + filename + "\""};
+		}
+		m_size = static_cast<size_t>(stat_buf.st_size);
+		if (m_size != 0) {
+			// Private writable mapping, so matrices pointing into it can still be modified in place
+			auto ptr = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (ptr == MAP_FAILED) {
+				close(fd);
+				throw snowboy_exception{"Fail to map input file \"" + filename + "\""};
+			}
+			m_data = static_cast<char*>(ptr);
+		}
+		close(fd);
+#endif
+		num_mappings++;
+	}
+
+	MappedFile::~MappedFile() {
+#ifdef _WIN32
+		if (m_data != nullptr) UnmapViewOfFile(m_data);
+		if (m_mapping != nullptr) CloseHandle(m_mapping);
+#else
+		if (m_data != nullptr) munmap(m_data, m_size);
+#endif
+	}
+
+	size_t MappedFile::NumMappings() noexcept {
+		return num_mappings;
+	}
+
+	void MappedFile::ResetNumMappings() noexcept {
+		num_mappings = 0;
+	}
+
+	// Files that can not be mapped, like pipes and devices, are read as a stream. Missing files count as regular,
+	// so opening them fails with the usual error.
+	static bool IsRegularFile(const std::string& filename) {
+		struct stat stat_buf;
+		return stat(filename.c_str(), &stat_buf) != 0 || (stat_buf.st_mode & S_IFMT) == S_IFREG;
+	}
+
+	namespace {
+		struct FilePin {
+			std::shared_ptr<const MappedFile> file;
+			time_t mtime;
+		};
+		std::mutex pinned_files_mutex;
+		std::map<std::string, std::weak_ptr<FilePin>> pinned_files;
+	} // namespace
+
+	std::shared_ptr<const MappedFile> PinMappedFile(const std::string& name) {
+		auto filename = ResolveModelFile(name);
+		if (auto file = FindPinnedFile(filename)) return file;
+		struct stat stat_buf;
+		if (stat(filename.c_str(), &stat_buf) != 0)
+			throw snowboy_exception{"Fail to open input file \"" + filename + "\""};
+		if ((stat_buf.st_mode & S_IFMT) != S_IFREG) return nullptr;
+		auto pin = std::make_shared<FilePin>();
+		pin->file = std::make_shared<const MappedFile>(filename);
+		pin->mtime = stat_buf.st_mtime;
+		std::lock_guard<std::mutex> lock{pinned_files_mutex};
+		for (auto it = pinned_files.begin(); it != pinned_files.end();) {
+			if (it->second.expired())
+				it = pinned_files.erase(it);
+			else
+				++it;
+		}
+		pinned_files[filename] = pin;
+		// The handle keeps the pin alive, the pin keeps the mapping alive
+		return std::shared_ptr<const MappedFile>{pin, pin->file.get()};
+	}
+
+	std::shared_ptr<const MappedFile> FindPinnedFile(const std::string& filename) {
+		std::shared_ptr<FilePin> pin;
+		{
+			std::lock_guard<std::mutex> lock{pinned_files_mutex};
+			auto it = pinned_files.find(filename);
+			if (it == pinned_files.end()) return nullptr;
+			pin = it->second.lock();
+		}
+		if (pin == nullptr) return nullptr;
+		struct stat stat_buf;
+		if (stat(filename.c_str(), &stat_buf) != 0 || static_cast<size_t>(stat_buf.st_size) != pin->file->size()
+			|| stat_buf.st_mtime != pin->mtime)
+			return nullptr;
+		return std::shared_ptr<const MappedFile>{pin, pin->file.get()};
+	}
+
+	static std::mutex model_cache_mutex;
+	static std::string model_cache_directory;
+
+	void SetModelCacheDirectory(const std::string& directory) {
+		std::lock_guard<std::mutex> lock{model_cache_mutex};
+		model_cache_directory = directory;
+	}
+
+	std::string GetModelCacheDirectory() {
+		std::lock_guard<std::mutex> lock{model_cache_mutex};
+		return model_cache_directory;
+	}
+
+	std::string ModelCachePath(const std::string& filename) {
+		auto directory = GetModelCacheDirectory();
+		if (directory.empty()) return "";
+		struct stat stat_buf;
+		if (stat(filename.c_str(), &stat_buf) != 0 || (stat_buf.st_mode & S_IFMT) != S_IFREG) return "";
+#ifdef _WIN32
+		auto full_path = _fullpath(nullptr, filename.c_str(), 0);
+#else
+		auto full_path = realpath(filename.c_str(), nullptr);
+#endif
+		if (full_path == nullptr) return "";
+		std::string key{full_path};
+		free(full_path);
+		key += '\0' + std::to_string(stat_buf.st_size) + '\0' + std::to_string(stat_buf.st_mtime);
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (auto c : key) {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+		if (directory.back() != '/' && directory.back() != '\\') directory += '/';
+		return directory + name + ".snowmdl";
+	}
+
+	std::string ResolveModelFile(const std::string& filename) {
+		auto path = ModelCachePath(filename);
+		struct stat stat_buf;
+		if (!path.empty() && stat(path.c_str(), &stat_buf) == 0) return path;
+		return filename;
+	}
+
+	MemoryStreamBuf::MemoryStreamBuf(std::shared_ptr<const MappedFile> file, size_t begin, size_t end)
+		: m_file{std::move(file)} {
+		if (begin > end || end > m_file->size())
+			throw snowboy_exception{"Invalid range [" + std::to_string(begin) + ", " + std::to_string(end)
+									+ ") for file of size " + std::to_string(m_file->size())};
+		setg(m_file->data() + begin, m_file->data() + begin, m_file->data() + end);
+	}
+
+	void MemoryStreamBuf::LogBlob(size_t begin, bool is_matrix) {
+		if (m_blob_log != nullptr) m_blob_log->push_back({begin, Position(), is_matrix});
+	}
+
+	MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+		if ((which & std::ios_base::in) == 0) return pos_type(off_type(-1));
+		char* ptr;
+		if (dir == std::ios_base::beg)
+			ptr = m_file->data() + off;
+		else if (dir == std::ios_base::cur)
+			ptr = gptr() + off;
+		else
+			ptr = egptr() + off;
+		if (ptr < eback() || ptr > egptr()) return pos_type(off_type(-1));
+		setg(eback(), ptr, egptr());
+		return pos_type(off_type(ptr - m_file->data()));
+	}
+
+	MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+		return seekoff(off_type(pos), std::ios_base::beg, which);
+	}
+
+	void WriteBlobPadding(std::ostream* os) {
+		// 5 bytes for the padding length itself
+		auto pos = static_cast<size_t>(os->tellp()) + 1 + sizeof(int32_t);
+		int32_t pad = (kModelBlobAlignment - pos % kModelBlobAlignment) % kModelBlobAlignment;
+		WriteBasicType<int32_t>(true, pad, os);
+		static const char zeros[kModelBlobAlignment] = {};
+		os->write(zeros, pad);
+	}
+
+	void ReadBlobPadding(std::istream* is) {
+		int32_t pad = -1;
+		ReadBasicType<int32_t>(true, &pad, is);
+		if (pad < 0 || static_cast<size_t>(pad) >= kModelBlobAlignment)
+			throw snowboy_exception{"Invalid blob padding " + std::to_string(pad)};
+		// Not a seek, so the padding can be skipped on pipes as well
+		is->ignore(pad);
+	}
+
+	Output::Output(const std::string& filename, bool binary)
+		: m_filename{filename} {
 		auto pos = filename.find_first_of(global_snowboy_offset_delimiter);
 		if (pos != std::string::npos) throw snowboy_exception{"Filename contains offset delimiter."};
-		m_stream.open(filename, std::ios::out | std::ios::binary);
+		// Pipes and devices are written directly, there is nothing to replace
+		struct stat stat_buf;
+		bool exists = stat(filename.c_str(), &stat_buf) == 0;
+		if (!exists || (stat_buf.st_mode & S_IFMT) == S_IFREG) m_temp_filename = filename + ".tmp" + std::to_string(std::random_device{}());
+		m_stream.open(m_temp_filename.empty() ? filename : m_temp_filename, std::ios::out | std::ios::binary);
 		if (!m_stream.is_open()) throw snowboy_exception{"Failed to open output file \"" + filename + "\""};
+#ifndef _WIN32
+		if (exists && !m_temp_filename.empty()) chmod(m_temp_filename.c_str(), stat_buf.st_mode & 07777);
+#endif
 		if (binary) {
 			m_stream.put(0x00);
 			m_stream.put('B');
@@ -326,32 +734,110 @@ namespace snowboy {
 		return &m_stream;
 	}
 
-	Output::~Output() {}
+	void Output::Close() {
+		if (!m_stream.is_open()) return;
+		m_stream.close();
+		if (m_temp_filename.empty()) {
+			if (!m_stream) throw snowboy_exception{"Failed to write output file \"" + m_filename + "\""};
+			return;
+		}
+		bool ok = static_cast<bool>(m_stream);
+#ifdef _WIN32
+		ok = ok && MoveFileExA(m_temp_filename.c_str(), m_filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		ok = ok && std::rename(m_temp_filename.c_str(), m_filename.c_str()) == 0;
+#endif
+		if (!ok) {
+			std::remove(m_temp_filename.c_str());
+			throw snowboy_exception{"Failed to write output file \"" + m_filename + "\""};
+		}
+	}
+
+	Output::~Output() {
+		if (!m_stream.is_open()) return;
+		m_stream.close();
+		if (!m_temp_filename.empty()) std::remove(m_temp_filename.c_str());
+	}
+
+	static void CheckContainerHeader(const ModelContainerHeader& header, const std::string& filename) {
+		if (header.version > kModelContainerVersion)
+			throw snowboy_exception{"Model container \"" + filename + "\" has version " + std::to_string(header.version)
+									+ ", only versions up to " + std::to_string(kModelContainerVersion) + " are supported"};
+		if (header.header_size < sizeof(header))
+			throw snowboy_exception{"Model container \"" + filename + "\" has a header of " + std::to_string(header.header_size) + " bytes"};
+	}
 
 	Input::Input(const std::string& filename) {
 		std::string real_name;
 		std::streampos pos = -1;
 		ParseFilename(filename, &real_name, &pos);
-		m_stream.open(real_name, std::ios::binary | std::ios::in);
-		if (!m_stream.is_open())
-			throw snowboy_exception{"Fail to open input file \"" + real_name + "\""};
-		if (pos != -1) {
-			m_stream.seekg(pos);
-			if (!m_stream)
-				throw snowboy_exception{"Fail to open input file \"" + real_name + "\" at offset " + std::to_string(pos)};
-		}
-		pos = m_stream.tellg();
-		auto c = m_stream.get();
-		if (c == 0x00 && m_stream.get() == 'B') {
+		// Offsets refer to the file named, only whole files are substituted by their cached container
+		if (filename.find(global_snowboy_offset_delimiter) == std::string::npos) real_name = ResolveModelFile(real_name);
+		m_filename = real_name;
+		auto file = FindPinnedFile(real_name);
+		if (file == nullptr && !IsRegularFile(real_name)) {
+			OpenStream(real_name, pos);
+			return;
+		}
+		if (file == nullptr) file = std::make_shared<const MappedFile>(real_name);
+		size_t begin = static_cast<size_t>(pos);
+		size_t end = file->size();
+		if (begin > end)
+			throw snowboy_exception{"Fail to open input file \"" + real_name + "\" at offset " + std::to_string(pos)};
+		auto data = file->data() + begin;
+		ModelContainerHeader header;
+		m_is_container = false;
+		if (end - begin >= 2 && data[0] == 0x00 && data[1] == 'B') {
+			m_is_binary = true;
+			begin += 2;
+		} else if (end - begin >= sizeof(header) && memcmp(data, global_snowboy_container_magic, sizeof(header.magic)) == 0) {
+			memcpy(&header, data, sizeof(header));
+			CheckContainerHeader(header, real_name);
+			begin += header.header_size;
+			end = begin + header.payload_size;
 			m_is_binary = true;
+			m_is_container = true;
 		} else {
-			m_stream.seekg(pos);
 			m_is_binary = false;
 		}
+		m_buffer.reset(new MemoryStreamBuf{std::move(file), begin, end});
+		m_stream.reset(new std::istream{m_buffer.get()});
+	}
+
+	void Input::OpenStream(const std::string& filename, std::streampos offset) {
+		std::unique_ptr<std::ifstream> stream{new std::ifstream{filename, std::ios::binary | std::ios::in}};
+		if (!stream->is_open())
+			throw snowboy_exception{"Fail to open input file \"" + filename + "\""};
+		if (offset != 0) {
+			stream->seekg(offset);
+			if (!*stream)
+				throw snowboy_exception{"Fail to open input file \"" + filename + "\" at offset " + std::to_string(offset)};
+		}
+		m_is_binary = false;
+		m_is_container = false;
+		// Only the first character can be put back, so the container header is read once the 'B' is ruled out
+		if (stream->peek() == 0x00) {
+			stream->get();
+			if (stream->peek() == 'B') {
+				stream->get();
+				m_is_binary = true;
+			} else {
+				ModelContainerHeader header;
+				header.magic[0] = 0x00;
+				stream->read(reinterpret_cast<char*>(&header) + 1, sizeof(header) - 1);
+				if (!*stream || memcmp(header.magic, global_snowboy_container_magic, sizeof(header.magic)) != 0)
+					throw snowboy_exception{"Input file \"" + filename + "\" is neither a text nor a binary model"};
+				CheckContainerHeader(header, filename);
+				stream->ignore(header.header_size - sizeof(header));
+				m_is_binary = true;
+				m_is_container = true;
+			}
+		}
+		m_stream = std::move(stream);
 	}
 
 	std::istream* Input::Stream() {
-		return &m_stream;
+		return m_stream.get();
 	}
 
 	Input::~Input() {}
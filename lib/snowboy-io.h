@@ -1,6 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <fstream>
+#include <memory>
 #include <snowboy-utils.h>
+#include <streambuf>
 #include <vector>
 
 namespace snowboy {
@@ -28,19 +31,123 @@ namespace snowboy {
 	void WriteIntegerVector(bool binary, const std::vector<T>& data, std::ostream* os);
 	template <>
 	void WriteIntegerVector<int>(bool binary, const std::vector<int>& data, std::ostream* os);
+	// Reads the numbers of a text mode "[ ... ]" block, parsing in place if the stream reads from a MemoryStreamBuf.
+	// `row_lengths` (optional) receives the number of values on each non empty line, which separates the rows of
+	// text matrices.
+	template <typename T>
+	void ReadTextBlock(std::istream* is, std::vector<T>* values, std::vector<size_t>* row_lengths);
+	// Writes the values separated by spaces, with enough digits to read back the same floats
+	void WriteTextValues(const float* values, size_t count, std::ostream* os);
+
+	// Header of a model container. The payload is the regular binary model stream (without the leading
+	// "\0B"), with matrices and vectors stored as 64 byte aligned blobs so they can be used in place.
+	struct ModelContainerHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t header_size;
+		uint64_t payload_size;
+		char reserved[40];
+	};
+	static_assert(sizeof(ModelContainerHeader) == 64, "container header has to keep blobs aligned");
+	extern const char global_snowboy_container_magic[8];
+	constexpr uint32_t kModelContainerVersion = 1;
+	constexpr size_t kModelBlobAlignment = 64;
+
+	// Copy on write mapping of a whole file, pages are shared between processes until written to.
+	class MappedFile {
+		char* m_data{nullptr};
+		size_t m_size{0};
+#ifdef _WIN32
+		void* m_mapping{nullptr};
+#endif
+
+	public:
+		explicit MappedFile(const std::string& filename);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		char* data() const noexcept { return m_data; }
+		size_t size() const noexcept { return m_size; }
+
+		// Number of files mapped since the last reset, used to check that resources are opened only once
+		static size_t NumMappings() noexcept;
+		static void ResetNumMappings() noexcept;
+	};
+
+	// Maps `filename` and shares the mapping with every Input opened on it while the returned handle is alive, so the
+	// streams of a pipeline read their models from a single mapping of the resource instead of reopening the file.
+	// Returns nullptr for files that can not be mapped, like pipes.
+	std::shared_ptr<const MappedFile> PinMappedFile(const std::string& filename);
+	// Returns the pinned mapping of `filename`, or nullptr if it is not pinned or the file changed on disk since.
+	std::shared_ptr<const MappedFile> FindPinnedFile(const std::string& filename);
+
+	// Directory holding model containers converted from the models and resources opened by Input. An empty directory
+	// (the default) disables the cache. Entries are added by UpdateModelCache().
+	void SetModelCacheDirectory(const std::string& directory);
+	std::string GetModelCacheDirectory();
+	// Path of the cache entry for `filename`, keyed by its absolute path, size and modification time. Empty if the
+	// cache is disabled or the file does not exist.
+	std::string ModelCachePath(const std::string& filename);
+	// Returns the cached container of `filename` if there is one, `filename` otherwise.
+	std::string ResolveModelFile(const std::string& filename);
 
+	// Position and kind of a matrix or vector read from a MemoryStreamBuf, used to rewrite models.
+	struct ModelBlob {
+		size_t begin;
+		size_t end;
+		bool is_matrix;
+	};
+
+	// Read only stream buffer over [begin, end) of a mapped file. Positions are absolute file offsets.
+	class MemoryStreamBuf : public std::streambuf {
+		std::shared_ptr<const MappedFile> m_file;
+		std::vector<ModelBlob>* m_blob_log{nullptr};
+
+	public:
+		MemoryStreamBuf(std::shared_ptr<const MappedFile> file, size_t begin, size_t end);
+
+		const std::shared_ptr<const MappedFile>& File() const noexcept { return m_file; }
+		char* Current() const noexcept { return gptr(); }
+		size_t Position() const noexcept { return gptr() - m_file->data(); }
+		size_t Remaining() const noexcept { return egptr() - gptr(); }
+		void SetBlobLog(std::vector<ModelBlob>* log) noexcept { m_blob_log = log; }
+		void LogBlob(size_t begin, bool is_matrix);
+
+	protected:
+		pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+		pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+	};
+
+	// Writes the padding length and padding in front of an aligned blob, the stream position is relative to
+	// the start of the container.
+	void WriteBlobPadding(std::ostream* os);
+	void ReadBlobPadding(std::istream* is);
+
+	// Writes to a temporary file that Close() renames to `filename`, so a model mapped from `filename` stays intact
+	// while it is written. Output that is not closed, e.g. after an error, is discarded.
 	class Output {
 		std::ofstream m_stream;
+		std::string m_filename;
+		std::string m_temp_filename;
 
 	public:
 		Output(const std::string& filename, bool binary);
 		std::ostream* Stream();
+		void Close();
 		~Output();
 	};
 
+	// Reads a model from a mapping of the file, reusing a pinned mapping if there is one. Pipes and other files that
+	// can not be mapped are read through an ifstream.
 	class Input {
-		std::ifstream m_stream;
+		std::string m_filename;
 		bool m_is_binary;
+		bool m_is_container;
+		std::unique_ptr<MemoryStreamBuf> m_buffer;
+		std::unique_ptr<std::istream> m_stream;
+
+		void OpenStream(const std::string& filename, std::streampos offset);
 
 	public:
 		Input(const std::string& filename);
@@ -48,6 +155,9 @@ namespace snowboy {
 		~Input();
 
 		bool is_binary() const noexcept { return m_is_binary; }
+		bool is_container() const noexcept { return m_is_container; }
+		// File actually read, which is the cached container if the model cache has one
+		const std::string& Filename() const noexcept { return m_filename; }
 
 		void ParseFilename(const std::string& filename, std::string* real_name, std::streampos* offset) const;
 	};
@@ -1,11 +1,16 @@
 #include <snowboy-error.h>
 #include <snowboy-utils.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #if defined(_MSC_VER)
@@ -81,6 +86,38 @@ namespace snowboy {
 		}
 	}
 
+	void ParallelFor(size_t num_tasks, const std::function<void(size_t)>& task, size_t num_threads) {
+		if (num_threads == 0) num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		num_threads = std::min(num_threads, num_tasks);
+		if (num_threads <= 1) {
+			for (size_t i = 0; i < num_tasks; i++)
+				task(i);
+			return;
+		}
+		std::atomic<size_t> next{0};
+		std::exception_ptr error;
+		std::mutex error_mutex;
+		auto worker = [&]() {
+			for (size_t i = next++; i < num_tasks; i = next++) {
+				try {
+					task(i);
+				} catch (...) {
+					std::unique_lock<std::mutex> lck{error_mutex};
+					if (!error) error = std::current_exception();
+					next = num_tasks;
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		threads.reserve(num_threads - 1);
+		for (size_t i = 1; i < num_threads; i++)
+			threads.emplace_back(worker);
+		worker();
+		for (auto& t : threads)
+			t.join();
+		if (error) std::rethrow_exception(error);
+	}
+
 	void FilterConfigString(bool invert, const std::string& prefix, std::string* config_str) {
 		if (!prefix.empty()) {
 			std::vector<std::string> parts;
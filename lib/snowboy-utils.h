@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -14,6 +15,9 @@ namespace snowboy {
 	bool ConvertStringToBoolean(const std::string& val);
 	template <typename T>
 	inline T ConvertStringToIntegerOrFloat(const std::string& s) { return ConvertStringTo<T>(s); }
+	// Runs task(0) .. task(num_tasks - 1) on up to num_threads threads (0 = hardware concurrency).
+	// The calling thread takes part in the work, the first exception thrown by a task is rethrown.
+	void ParallelFor(size_t num_tasks, const std::function<void(size_t)>& task, size_t num_threads = 0);
 	void FilterConfigString(bool, const std::string& prefix, std::string* config_str);
 	void* SnowboyMemalign(size_t align, size_t size);
 	void SnowboyMemalignFree(void* ptr);
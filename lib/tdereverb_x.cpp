@@ -1 +1,49 @@
-// TODO
\ No newline at end of file
+#include <cstdlib>
+#include <cstring>
+#include <tdereverb_x.h>
+
+extern "C"
+{
+	// 50 ms between the direct sound and what is treated as late reverb
+	static const int kDereverbDelay = 5;
+	// Per power level: decay after the delay for a reverb time of about 0.3, 0.5 and 0.8 s, and the gain floor
+	static const int16_t kDereverbAttenuation[4] = {0, 10362, 16423, 21300};
+	static const int16_t kDereverbFloor[4] = {32767, 16384, 11469, 8192};
+
+	int Init_TDereverb_x_Params(TDereverb_x_Params* params, int bins) {
+		Delete_TDereverb_x_Params(params);
+		params->history = static_cast<uint32_t*>(calloc(kDereverbDelay * bins, sizeof(uint32_t)));
+		if (params->history == nullptr) return -1;
+		params->bins = bins;
+		params->delay = kDereverbDelay;
+		params->position = 0;
+		return Set_TDereverb_x_Power(params, 0);
+	}
+
+	int Set_TDereverb_x_Power(TDereverb_x_Params* params, long power) {
+		if (power < 0 || power > 3) return -1;
+		params->attenuation = kDereverbAttenuation[power];
+		params->floor = kDereverbFloor[power];
+		return 0;
+	}
+
+	void Process_TDereverb_x(TDereverb_x_Params* params, const uint32_t* magn, int16_t* gain) {
+		uint32_t* delayed = params->history + params->position * params->bins;
+		if (params->attenuation != 0) {
+			for (int k = 0; k < params->bins; k++) {
+				uint64_t late = (static_cast<uint64_t>(delayed[k]) * params->attenuation) >> 15;
+				if (magn[k] == 0) continue;
+				int32_t g = late >= magn[k] ? 0 : 32767 - static_cast<int32_t>((late << 15) / magn[k]);
+				if (g < params->floor) g = params->floor;
+				if (g < gain[k]) gain[k] = static_cast<int16_t>(g);
+			}
+		}
+		memcpy(delayed, magn, params->bins * sizeof(uint32_t));
+		params->position = (params->position + 1) % params->delay;
+	}
+
+	void Delete_TDereverb_x_Params(TDereverb_x_Params* params) {
+		free(params->history);
+		params->history = nullptr;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+
+extern "C"
+{
+	// Late reverberation suppression, runs on the magnitude spectrum of the noise suppressor
+	struct TDereverb_x_Params {
+		int bins;
+		int delay; // blocks between the direct sound and the late reverb
+		int position;
+		int16_t attenuation; // Q15, magnitude of the direct sound left after `delay` blocks
+		int16_t floor;		 // Q15, lowest gain
+		uint32_t* history;	 // delay * bins magnitudes
+	};
+	int Init_TDereverb_x_Params(TDereverb_x_Params* params, int bins);
+	int Set_TDereverb_x_Power(TDereverb_x_Params* params, long power);
+	// Adds `magn` to the history and lowers the Q15 `gain` of bins that are mostly late reverb
+	void Process_TDereverb_x(TDereverb_x_Params* params, const uint32_t* magn, int16_t* gain);
+	void Delete_TDereverb_x_Params(TDereverb_x_Params* params);
+}
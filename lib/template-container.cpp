@@ -2,6 +2,7 @@
 #include <limits>
 #include <snowboy-error.h>
 #include <snowboy-io.h>
+#include <snowboy-utils.h>
 #include <template-container.h>
 #include <vector-wrapper.h>
 
@@ -29,13 +30,15 @@ namespace snowboy {
 			WriteToken(binary, "<Template>", os);
 			e.Write(binary, os);
 		}
+		out.Close();
 	}
 
 	void TemplateContainer::ReadHotwordModel(const std::string& filename) {
 		Input in{filename};
-		auto is = in.Stream();
-		auto binary = in.is_binary();
+		ReadHotwordModel(in.is_binary(), in.Stream());
+	}
 
+	void TemplateContainer::ReadHotwordModel(bool binary, std::istream* is) {
 		ExpectToken(binary, "<PersonalModel>", is);
 		ExpectToken(binary, "<Sensitivity>", is);
 		ReadBasicType<float>(binary, &m_sensitivity, is);
@@ -67,15 +70,25 @@ namespace snowboy {
 		m_templates.erase(m_templates.begin() + index);
 	}
 
-	void TemplateContainer::CombineTemplates(DistanceType distance) {
+	void TemplateContainer::CombineTemplates(DistanceType distance, int band_width, size_t num_threads) {
 		if (m_templates.size() < 2) return;
+		const auto num = m_templates.size();
+		// DtwAlign is not symmetric, so all n * (n - 1) pairs are aligned. The sums below are accumulated
+		// in the same order as a sequential run to keep the result independent of the thread count.
+		std::vector<float> pair_distances(num * num, 0.0f);
+		ParallelFor(
+			num * num, [&](size_t idx) {
+				auto i = idx / num, i2 = idx % num;
+				if (i != i2) pair_distances[idx] = snowboy::DtwAlign(distance, m_templates[i], m_templates[i2], nullptr, band_width);
+			},
+			num_threads);
 		auto min_val = std::numeric_limits<float>::max();
 		size_t min_idx = 0;
-		for (size_t i = 0; i < m_templates.size(); i++) {
+		for (size_t i = 0; i < num; i++) {
 			auto sum = 0.0;
-			for (size_t i2 = 0; i2 < m_templates.size(); i2++) {
+			for (size_t i2 = 0; i2 < num; i2++) {
 				if (i != i2) {
-					sum += snowboy::DtwAlign(distance, m_templates[i], m_templates[i2], nullptr);
+					sum += pair_distances[i * num + i2];
 				}
 			}
 			if (sum < min_val) {
@@ -86,10 +99,11 @@ namespace snowboy {
 		std::vector<int> local_a0;
 		local_a0.resize(m_templates[min_idx].m_rows, 1); // Not sure if int
 
-		for (size_t local_90 = 0; local_90 < m_templates.size(); local_90++) {
+		for (size_t local_90 = 0; local_90 < num; local_90++) {
 			if (min_idx != local_90) {
+				// The medoid is updated in place, so each alignment depends on the previous ones
 				std::vector<std::vector<size_t>> local_58;
-				snowboy::DtwAlign(distance, m_templates[min_idx], m_templates[local_90], &local_58);
+				snowboy::DtwAlign(distance, m_templates[min_idx], m_templates[local_90], &local_58, band_width);
 				for (size_t local_a8 = 0; local_a8 < m_templates[min_idx].rows(); local_a8 += 1) {
 					if (local_58[local_a8].size() != 0) {
 						SubVector{m_templates[min_idx], local_a8}.Scale(local_a0[local_a8]);
@@ -12,10 +12,12 @@ namespace snowboy {
 		virtual ~TemplateContainer();
 		void WriteHotwordModel(bool binary, const std::string& filename) const;
 		void ReadHotwordModel(const std::string& filename);
+		void ReadHotwordModel(bool binary, std::istream* is);
 		size_t NumTemplates() const;
 		const Matrix* GetTemplate(size_t index) const;
 		void DeleteTemplate(size_t index);
-		void CombineTemplates(DistanceType distance);
+		// band_width is passed on to DtwAlign, the alignments run on num_threads threads (0 = hardware concurrency)
+		void CombineTemplates(DistanceType distance, int band_width = -1, size_t num_threads = 0);
 		void Clear();
 		void AddTemplate(const MatrixBase& tpl);
 	};
@@ -1,4 +1,6 @@
+#include <chrono>
 #include <frame-info.h>
+#include <frame-score-sink.h>
 #include <limits>
 #include <nnet-lib.h>
 #include <snowboy-error.h>
@@ -29,9 +31,12 @@ namespace snowboy {
 		if (models.empty())
 			throw snowboy_exception{"no model can be extracted from --model-str:" + m_options.model_str};
 		m_models.resize(models.size());
-		for (size_t i = 0; i < models.size(); i++) {
+		m_model_load_ms.resize(models.size());
+		ParallelFor(models.size(), [&](size_t i) {
+			auto start = std::chrono::steady_clock::now();
 			m_models[i].ReadHotwordModel(models[i]);
-		}
+			m_model_load_ms[i] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		});
 		InitDtw();
 		if (m_options.sensitivity_str != "") {
 			SetSensitivity(m_options.sensitivity_str);
@@ -52,6 +57,8 @@ namespace snowboy {
 			for (size_t slide_pos = 0; slide_pos < read_mat.rows(); slide_pos += m_options.slide_step) {
 				for (size_t model_id = 0; model_id < field_x58.size(); model_id++) {
 					auto matched_templates = 0;
+					m_frame_scores.clear();
+					const int hotword = m_frame_score_hotwords.empty() ? static_cast<int>(model_id) : m_frame_score_hotwords[model_id];
 					for (size_t template_id = 0; template_id < field_x58[model_id].size(); template_id++) {
 						auto step = m_options.slide_step;
 						if (read_mat.m_rows < slide_pos + step) step = read_mat.m_rows - slide_pos;
@@ -61,8 +68,14 @@ namespace snowboy {
 						if (window_size < 0) window_size = 0;
 						auto distance = field_x58[model_id][template_id].ComputeDtwDistance(step, field_x78.RowRange(window_size, (iVar2 - window_size) + 1));
 						if (distance < m_models[model_id].m_sensitivity) matched_templates++;
+						if (m_frame_score_sink != nullptr) {
+							m_frame_scores.push_back({read_info[slide_pos].frame_id, static_cast<uint16_t>(read_info[slide_pos].flags), FrameScore::kTemplateDistance,
+													  static_cast<uint8_t>(template_id), static_cast<uint32_t>(hotword), distance});
+						}
 					}
+					if (m_frame_score_sink != nullptr) m_frame_score_sink->Write(m_frame_scores.data(), m_frame_scores.size());
 					if (field_x58[model_id].size() * 0.5f < matched_templates) {
+						m_detected_score = static_cast<float>(matched_templates) / field_x58[model_id].size();
 						mat->Resize(1, 1, MatrixResizeType::kSetZero);
 						mat->m_data[0] = model_id + 1;
 						info->resize(1);
@@ -1,6 +1,7 @@
 #pragma once
 #include <deque>
 #include <dtw-lib.h>
+#include <frame-score-sink.h>
 #include <matrix-wrapper.h>
 #include <memory>
 #include <stream-itf.h>
@@ -20,6 +21,15 @@ namespace snowboy {
 	struct TemplateDetectStream : StreamItf {
 		TemplateDetectStreamOptions m_options;
 		std::vector<TemplateContainer> m_models;
+		// Time it took to read each model in milliseconds
+		std::vector<float> m_model_load_ms;
+		// Fraction of the templates that matched in the last detection
+		float m_detected_score = 0.0f;
+		// If set, receives the DTW distance of every template at each step
+		FrameScoreSink* m_frame_score_sink = nullptr;
+		std::vector<FrameScore> m_frame_scores;
+		// Hotword written to the frame scores for each model, the pipeline's ids. Empty for the model index.
+		std::vector<int> m_frame_score_hotwords;
 		std::vector<std::vector<SlidingDtw>> field_x58;
 		size_t field_x70;
 		Matrix field_x78;
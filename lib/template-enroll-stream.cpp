@@ -9,6 +9,8 @@ namespace snowboy {
 		opts->Register(prefix, "min-template-length", "Minimal required length of template.", &min_template_length);
 		opts->Register(prefix, "max-template-length", "Maximal possible length of template.", &max_template_length);
 		opts->Register(prefix, "combine-distance-metric", "If not empty, combines all templates into one template using dynamic time warping with the specified distance type.", &combine_distance_metric);
+		opts->Register(prefix, "combine-band-width", "Sakoe-Chiba band half width used when combining templates, negative values disable the band.", &combine_band_width);
+		opts->Register(prefix, "combine-num-threads", "Number of threads used to align templates when combining them, 0 uses all cores.", &combine_num_threads);
 		opts->Register(prefix, "model-filename", "File that we want to write the templates to.", &model_filename);
 	}
 
@@ -44,9 +46,9 @@ namespace snowboy {
 		}
 		if (field_x38.NumTemplates() == m_options.num_templates) {
 			if (m_options.combine_distance_metric == "cosine") {
-				field_x38.CombineTemplates(DistanceType::cosine);
+				field_x38.CombineTemplates(DistanceType::cosine, m_options.combine_band_width, m_options.combine_num_threads);
 			} else if (m_options.combine_distance_metric == "euclidean") {
-				field_x38.CombineTemplates(DistanceType::euclidean);
+				field_x38.CombineTemplates(DistanceType::euclidean, m_options.combine_band_width, m_options.combine_num_threads);
 			} else if (m_options.combine_distance_metric != "") {
 				throw snowboy_exception{"unknown distance metric \"" + m_options.combine_distance_metric + "\""};
 				return -1;
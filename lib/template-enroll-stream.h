@@ -12,6 +12,8 @@ namespace snowboy {
 		uint32_t min_template_length;
 		uint32_t max_template_length;
 		std::string combine_distance_metric;
+		int32_t combine_band_width;
+		uint32_t combine_num_threads;
 		std::string model_filename;
 		void Register(const std::string&, OptionsItf*);
 	};
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <frame-info.h>
+#include <frame-score-sink.h>
 #include <limits>
 #include <math.h>
 #include <nnet-lib.h>
+#include <snowboy-debug.h>
 #include <snowboy-error.h>
 #include <snowboy-io.h>
 #include <snowboy-options.h>
@@ -40,8 +45,11 @@ namespace snowboy {
 			if (!m_options.sensitivity_str.empty()) SetHighSensitivity(m_options.sensitivity_str);
 		} else
 			SetHighSensitivity(m_options.high_sensitivity_str);
-		for (auto& e : m_model_info)
+		for (auto& e : m_model_info) {
 			e.CheckLicense();
+			e.InitSlideBuffer(m_model_info.size());
+			e.UpdateThresholds();
+		}
 		field_x60 = false;
 		field_x64 = 0;
 		field_x68 = false;
@@ -62,91 +70,320 @@ namespace snowboy {
 				m_model_info[file].network.Compute(read_mat, read_info, &nnet_out_mat, &nnet_out_info);
 			else
 				m_model_info[file].network.FlushOutput(read_mat, read_info, &nnet_out_mat, &nnet_out_info);
-			m_model_info[file].SmoothPosterior(&nnet_out_mat);
-			for (size_t r = 0; r < nnet_out_mat.m_rows; r += m_options.slide_step) {
-				auto max = 0;
-				if (r + m_options.slide_step > nnet_out_mat.m_rows)
-					max = nnet_out_mat.m_rows;
-				else
-					max = r + m_options.slide_step;
-				PushSlideWindow(file, nnet_out_mat.RowRange(r, max - r));
-				const auto max_frame_id = nnet_out_info[max - 1].frame_id;
-				float fVar8 = 0.0f;
-				int local_130 = -1;
-				for (size_t i = 0; i < m_model_info[file].keywords.size(); i++) {
-					auto posterior = GetHotwordPosterior(file, i, max_frame_id);
-					if (!field_x68 || max_frame_id - field_x6c < 0x33) {
-						if (field_x60) {
-							if (3000 < max_frame_id - field_x64) {
-								field_x60 = false;
-							}
-							if (1.0f - m_model_info[file].keywords[i].high_sensitivity <= posterior && m_options.min_detection_interval < max_frame_id - field_x58)
-							{
-								if (fVar8 < posterior) {
-									local_130 = i;
-									fVar8 = posterior;
-								}
-								field_x64 = max_frame_id;
-							}
-						} else {
-							if (posterior < 1.0f - m_model_info[file].keywords[i].sensitivity || max_frame_id - field_x58 <= m_options.min_detection_interval) {
-								if (!field_x68
-									&& 1.0f - m_model_info[file].keywords[i].high_sensitivity <= posterior
-									&& posterior < 1.0f - m_model_info[file].keywords[i].sensitivity
-									&& max_frame_id - field_x58 <= m_options.min_detection_interval) {
-									field_x68 = true;
-									field_x6c = max_frame_id;
-								}
-							} else {
-								if (fVar8 < posterior) {
-									local_130 = i;
-									fVar8 = posterior;
-								}
-								if (!field_x68 && m_model_info[file].keywords[i].sensitivity < m_model_info[file].keywords[i].high_sensitivity) {
-									field_x68 = true;
-									field_x6c = max_frame_id;
-								}
-							}
+			if (m_score_trace != nullptr) {
+				if (file == 0) m_score_trace->push_back({read_res, {}, {}});
+				m_score_trace->back().outputs.push_back(std::move(nnet_out_mat));
+				m_score_trace->back().info.push_back(std::move(nnet_out_info));
+				continue;
+			}
+			if (ScoreOutputs(file, &nnet_out_mat, nnet_out_info, mat, info)) return read_res;
+		}
+		if ((read_res & 0x18) != 0) {
+			this->Reset();
+		}
+		return read_res;
+	}
+
+	void UniversalDetectStream::SetNumChannels(size_t num_channels) {
+		m_channels.clear();
+		if (num_channels <= 1) return;
+		m_channels.resize(num_channels);
+		for (size_t c = 0; c < num_channels; c++) {
+			auto& channel = m_channels[c];
+			channel.field_x58 = m_options.min_detection_interval;
+			channel.field_x5c = m_options.min_detection_interval;
+			channel.field_x60 = false;
+			channel.field_x64 = 0;
+			channel.field_x68 = false;
+			channel.field_x6c = 0;
+			for (auto& e : m_model_info)
+				channel.models.push_back(e.NewScoreState());
+			if (c == 0) continue;
+			channel.networks.resize(m_model_info.size());
+			for (size_t file = 0; file < m_model_info.size(); file++)
+				channel.networks[file].ShareComponents(m_model_info[file].network);
+		}
+	}
+
+	size_t UniversalDetectStream::NumChannels() const {
+		return std::max<size_t>(m_channels.size(), 1);
+	}
+
+	void UniversalDetectStream::SwapChannel(size_t channel) {
+		auto& e = m_channels[channel];
+		std::swap(field_x58, e.field_x58);
+		std::swap(field_x5c, e.field_x5c);
+		std::swap(field_x60, e.field_x60);
+		std::swap(field_x64, e.field_x64);
+		std::swap(field_x68, e.field_x68);
+		std::swap(field_x6c, e.field_x6c);
+		for (size_t file = 0; file < m_model_info.size(); file++)
+			m_model_info[file].SwapScoreState(&e.models[file]);
+	}
+
+	int UniversalDetectStream::ReadChannels(const std::vector<Matrix>& features, const std::vector<std::vector<FrameInfo>>& features_info,
+											const std::vector<int>& signals, Matrix* mat, std::vector<FrameInfo>* info) {
+		mat->Resize(0, 0);
+		if (info) info->clear();
+		const auto num_channels = m_channels.size();
+		if (features.size() != num_channels || features_info.size() != num_channels || signals.size() != num_channels)
+			throw snowboy_exception{"expected the features of " + std::to_string(num_channels) + " channels, got " + std::to_string(features.size())};
+
+		std::vector<Matrix> outputs(num_channels);
+		std::vector<std::vector<FrameInfo>> outputs_info(num_channels);
+		std::vector<Nnet*> nets;
+		std::vector<const MatrixBase*> inputs;
+		std::vector<const std::vector<FrameInfo>*> inputs_info;
+		std::vector<size_t> batch;
+		std::vector<Matrix> batch_outputs;
+		std::vector<std::vector<FrameInfo>> batch_outputs_info;
+		for (size_t file = 0; file < m_model_info.size(); file++) {
+			nets.clear();
+			inputs.clear();
+			inputs_info.clear();
+			batch.clear();
+			for (size_t c = 0; c < num_channels; c++) {
+				outputs[c].Resize(0, 0);
+				outputs_info[c].clear();
+				if ((signals[c] & 0xc2) != 0) continue;
+				auto& network = c == 0 ? m_model_info[file].network : m_channels[c].networks[file];
+				if ((signals[c] & 0x18) != 0) {
+					// Only the end of a voiced segment flushes a channel, which is rare enough to not batch it
+					network.FlushOutput(features[c], features_info[c], &outputs[c], &outputs_info[c]);
+				} else {
+					nets.push_back(&network);
+					inputs.push_back(&features[c]);
+					inputs_info.push_back(&features_info[c]);
+					batch.push_back(c);
+				}
+			}
+			if (!nets.empty()) {
+				Nnet::ComputeBatch(nets, inputs, inputs_info, &batch_outputs, &batch_outputs_info);
+				for (size_t i = 0; i < batch.size(); i++) {
+					outputs[batch[i]] = std::move(batch_outputs[i]);
+					outputs_info[batch[i]] = std::move(batch_outputs_info[i]);
+				}
+			}
+			for (size_t c = 0; c < num_channels; c++) {
+				if (outputs[c].m_rows == 0) continue;
+				SwapChannel(c);
+				auto detected = ScoreOutputs(file, &outputs[c], outputs_info[c], mat, info);
+				SwapChannel(c);
+				if (detected) {
+					// All channels heard the same hotword, so the minimum interval to the next detection applies to all
+					m_detected_channel = c;
+					field_x58 = field_x5c = m_channels[c].field_x58;
+					for (auto& e : m_channels)
+						e.field_x58 = e.field_x5c = field_x58;
+					return signals[c];
+				}
+			}
+		}
+		int res = 0;
+		for (size_t c = 0; c < num_channels; c++) {
+			res |= signals[c];
+			if ((signals[c] & 0x18) != 0) {
+				SwapChannel(c);
+				ResetDetection();
+				SwapChannel(c);
+			}
+		}
+		return res;
+	}
+
+	bool UniversalDetectStream::ScoreOutputs(size_t file, Matrix* nnet_out_mat, const std::vector<FrameInfo>& nnet_out_info, Matrix* mat,
+											 std::vector<FrameInfo>* info) {
+		m_model_info[file].SmoothPosterior(nnet_out_mat);
+		for (size_t r = 0; r < nnet_out_mat->m_rows; r += m_options.slide_step) {
+			auto max = 0;
+			if (r + m_options.slide_step > nnet_out_mat->m_rows)
+				max = nnet_out_mat->m_rows;
+			else
+				max = r + m_options.slide_step;
+			PushSlideWindow(file, nnet_out_mat->RowRange(r, max - r));
+			const auto max_frame_id = nnet_out_info[max - 1].frame_id;
+			auto& model = m_model_info[file];
+			for (size_t i = 0; i < model.keywords.size(); i++) {
+				model.kw_posterior[i] = GetHotwordPosterior(file, i, max_frame_id);
+			}
+			if (m_frame_score_sink != nullptr) {
+				m_frame_scores.clear();
+				for (size_t i = 0; i < model.keywords.size(); i++) {
+					const int hotword_id = model.keywords[i].hotword_id;
+					const int hotword = m_frame_score_hotwords.empty() ? hotword_id : m_frame_score_hotwords[hotword_id - 1];
+					m_frame_scores.push_back({max_frame_id, static_cast<uint16_t>(nnet_out_info[max - 1].flags), FrameScore::kUniversalPosterior, 0,
+											  static_cast<uint32_t>(hotword), model.kw_posterior[i]});
+				}
+				m_frame_score_sink->Write(m_frame_scores.data(), m_frame_scores.size());
+			}
+			int local_130 = -1;
+			if (model.AnyKeywordTriggered()) {
+				local_130 = ScoreKeywords(file, max_frame_id);
+			} else if (!model.keywords.empty()) {
+				// No keyword reached any of its thresholds, so only the timeouts of
+				// the high sensitivity logic in ScoreKeywords() can change state.
+				if (field_x68 && !(max_frame_id - field_x6c < 0x33)) {
+					field_x68 = false;
+					field_x60 = true;
+					field_x64 = max_frame_id;
+				} else if (field_x60 && 3000 < max_frame_id - field_x64) {
+					field_x60 = false;
+				}
+			}
+			if (local_130 != -1) {
+				m_detected_posterior = model.kw_posterior[local_130];
+				m_model_info[file].CheckLicense();
+				field_x58 = max_frame_id;
+				field_x5c = max_frame_id;
+				ResetDetection();
+				mat->Resize(1, 1);
+				mat->m_data[0] = m_model_info[file].keywords[local_130].hotword_id;
+				if (info != nullptr) {
+					auto i = nnet_out_info[r];
+					info->push_back(i);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	std::vector<UniversalDetectStream::TraceDetection> UniversalDetectStream::ReplayScoreTrace(const std::string& sensitivity,
+																							  const std::string& high_sensitivity,
+																							  const std::function<const ScoreTraceBatch*(bool)>& next_batch) {
+		// The replay runs on the state of a fresh stream, everything it touches is restored afterwards
+		std::vector<std::pair<float, float>> saved_sensitivities;
+		for (auto& e : m_model_info) {
+			for (auto& kw : e.keywords)
+				saved_sensitivities.emplace_back(kw.sensitivity, kw.high_sensitivity);
+		}
+		const auto saved_x58 = field_x58, saved_x5c = field_x5c, saved_x64 = field_x64, saved_x6c = field_x6c;
+		const auto saved_x60 = field_x60, saved_x68 = field_x68;
+		const auto saved_posterior = m_detected_posterior;
+		const auto saved_sink = m_frame_score_sink;
+		m_frame_score_sink = nullptr;
+		if (!sensitivity.empty()) SetSensitivity(sensitivity);
+		if (!high_sensitivity.empty()) SetHighSensitivity(high_sensitivity);
+		field_x58 = m_options.min_detection_interval;
+		field_x5c = m_options.min_detection_interval;
+		field_x60 = false;
+		field_x64 = 0;
+		field_x68 = false;
+		field_x6c = 0;
+		ResetDetection();
+
+		std::vector<TraceDetection> res;
+		Matrix nnet_out_mat, mat;
+		std::vector<FrameInfo> info;
+		bool detected = false;
+		while (auto batch = next_batch(detected)) {
+			detected = false;
+			for (size_t file = 0; file < batch->outputs.size() && !detected; file++) {
+				nnet_out_mat = batch->outputs[file];
+				info.clear();
+				detected = ScoreOutputs(file, &nnet_out_mat, batch->info[file], &mat, &info);
+			}
+			if (detected) {
+				res.push_back({static_cast<int>(mat.m_data[0]), info[0].frame_id, m_detected_posterior});
+				ResetDetection();
+			} else if ((batch->signal & 0x18) != 0) {
+				ResetDetection();
+			}
+		}
+
+		size_t i = 0;
+		for (auto& e : m_model_info) {
+			for (auto& kw : e.keywords) {
+				kw.sensitivity = saved_sensitivities[i].first;
+				kw.high_sensitivity = saved_sensitivities[i].second;
+				i++;
+			}
+			e.UpdateThresholds();
+		}
+		field_x58 = saved_x58;
+		field_x5c = saved_x5c;
+		field_x60 = saved_x60;
+		field_x64 = saved_x64;
+		field_x68 = saved_x68;
+		field_x6c = saved_x6c;
+		m_detected_posterior = saved_posterior;
+		m_frame_score_sink = saved_sink;
+		ResetDetection();
+		return res;
+	}
+
+	int UniversalDetectStream::ScoreKeywords(size_t model_id, unsigned int max_frame_id) {
+		auto& model = m_model_info[model_id];
+		float fVar8 = 0.0f;
+		int local_130 = -1;
+		for (size_t i = 0; i < model.keywords.size(); i++) {
+			const auto posterior = model.kw_posterior[i];
+			const auto threshold = model.kw_threshold[i];
+			const auto high_threshold = model.kw_high_threshold[i];
+			if (!field_x68 || max_frame_id - field_x6c < 0x33) {
+				if (field_x60) {
+					if (3000 < max_frame_id - field_x64) {
+						field_x60 = false;
+					}
+					if (high_threshold <= posterior && m_options.min_detection_interval < max_frame_id - field_x58) {
+						if (fVar8 < posterior) {
+							local_130 = i;
+							fVar8 = posterior;
 						}
-					} else {
-						field_x68 = false;
-						field_x60 = true;
 						field_x64 = max_frame_id;
-						if (1.0f - m_model_info[file].keywords[i].high_sensitivity <= posterior && m_options.min_detection_interval < max_frame_id - field_x58)
-						{
-							if (fVar8 < posterior) {
-								local_130 = i;
-								fVar8 = posterior;
-							}
-							field_x64 = max_frame_id;
+					}
+				} else {
+					if (posterior < threshold || max_frame_id - field_x58 <= m_options.min_detection_interval) {
+						if (!field_x68
+							&& high_threshold <= posterior
+							&& posterior < threshold
+							&& max_frame_id - field_x58 <= m_options.min_detection_interval) {
+							field_x68 = true;
+							field_x6c = max_frame_id;
+						}
+					} else {
+						if (fVar8 < posterior) {
+							local_130 = i;
+							fVar8 = posterior;
+						}
+						if (!field_x68 && model.keywords[i].sensitivity < model.keywords[i].high_sensitivity) {
+							field_x68 = true;
+							field_x6c = max_frame_id;
 						}
 					}
 				}
-				if (local_130 != -1) {
-					m_model_info[file].CheckLicense();
-					field_x58 = max_frame_id;
-					field_x5c = max_frame_id;
-					ResetDetection();
-					mat->Resize(1, 1);
-					mat->m_data[0] = m_model_info[file].keywords[local_130].hotword_id;
-					if (info != nullptr) {
-						auto i = nnet_out_info[r];
-						info->push_back(i);
-						return read_res;
+			} else {
+				field_x68 = false;
+				field_x60 = true;
+				field_x64 = max_frame_id;
+				if (high_threshold <= posterior && m_options.min_detection_interval < max_frame_id - field_x58) {
+					if (fVar8 < posterior) {
+						local_130 = i;
+						fVar8 = posterior;
 					}
+					field_x64 = max_frame_id;
 				}
 			}
 		}
-		if ((read_res & 0x18) != 0) {
-			this->Reset();
-		}
-		return read_res;
+		return local_130;
 	}
 
 	bool UniversalDetectStream::Reset() {
 		for (auto& e : m_model_info)
 			e.network.ResetComputation();
+		for (auto& channel : m_channels) {
+			for (auto& e : channel.networks)
+				e.ResetComputation();
+		}
+		// While a score trace is recorded the scores belong to ReplayScoreTrace(), which may run the pipeline for more
+		// of the trace in between
+		if (m_score_trace != nullptr) return true;
 		ResetDetection();
+		for (size_t c = 0; c < m_channels.size(); c++) {
+			SwapChannel(c);
+			ResetDetection();
+			SwapChannel(c);
+		}
 		return true;
 	}
 
@@ -156,6 +393,26 @@ namespace snowboy {
 
 	UniversalDetectStream::~UniversalDetectStream() {}
 
+	bool UniversalDetectStream::ModelInfo::AnyKeywordTriggered() const {
+		bool triggered = false;
+		for (size_t i = 0; i < kw_posterior.size(); i++) {
+			triggered |= kw_posterior[i] >= kw_trigger[i];
+		}
+		return triggered;
+	}
+
+	void UniversalDetectStream::ModelInfo::UpdateThresholds() {
+		kw_threshold.resize(keywords.size());
+		kw_high_threshold.resize(keywords.size());
+		kw_trigger.resize(keywords.size());
+		kw_posterior.resize(keywords.size(), 0.0f);
+		for (size_t i = 0; i < keywords.size(); i++) {
+			kw_threshold[i] = 1.0f - keywords[i].sensitivity;
+			kw_high_threshold[i] = 1.0f - keywords[i].high_sensitivity;
+			kw_trigger[i] = std::min(kw_threshold[i], kw_high_threshold[i]);
+		}
+	}
+
 	void UniversalDetectStream::ModelInfo::CheckLicense() const {
 		if (license_days > 0.0f) {
 			time_t t;
@@ -200,13 +457,17 @@ namespace snowboy {
 	}
 
 	float UniversalDetectStream::ModelInfo::HotwordNaiveSearch(size_t keyword_id) const {
+		auto& kw = keywords[keyword_id];
+		auto row = SlideWindowRow(std::min(slide_buffer_fill, slide_search_depth) - 1);
+		// Reject on the floors first, most keywords fail here and never need the logs.
+		for (size_t i = 0; i < kw.field_x88.size(); i++) {
+			if (kw.search_floor[i] > row[kw.field_x88[i]]) return 0.0f;
+		}
 		float sum = 0.0f;
-		for (size_t i = 0; i < keywords[keyword_id].field_x88.size(); i++) {
-			auto& x = field_x250[keywords[keyword_id].field_x88[i]];
-			if (keywords[keyword_id].search_floor[i] > x.front()) return 0.0f;
-			sum += logf(std::max(x.front(), std::numeric_limits<float>::min()));
+		for (size_t i = 0; i < kw.search_slots.size(); i++) {
+			sum += slide_log_posterior[kw.search_slots[i]];
 		}
-		return expf(sum / static_cast<float>(keywords[keyword_id].field_x88.size()));
+		return expf(sum / static_cast<float>(kw.field_x88.size()));
 	}
 
 	float UniversalDetectStream::HotwordPiecewiseSearch(int, int) const {
@@ -222,10 +483,10 @@ namespace snowboy {
 		x[0] = 0.0f;
 		std::vector<float> x2;
 		x2.resize(m_model_info[model_id].keywords[param_2].field_x88.size(), 0);
-		auto& f250 = m_model_info[model_id].field_x250[0];
-		size_t i = f250.size() - m_model_info[model_id].keywords[param_2].search_mask.back();
+		auto f250_size = m_model_info[model_id].slide_buffer_fill;
+		size_t i = f250_size - m_model_info[model_id].keywords[param_2].search_mask.back();
 		do {
-			if (f250.size() <= i) {
+			if (f250_size <= i) {
 				auto fVar2 = m_model_info[model_id].keywords[param_2].search_floor.back();
 				if (fVar2 <= x2.back()) {
 					if (m_model_info[model_id].keywords[param_2].search_max && !x.empty()) {
@@ -281,15 +542,58 @@ namespace snowboy {
 	}
 
 	void UniversalDetectStream::PushSlideWindow(size_t model_id, const MatrixBase& param_2) {
-		// TODO: Optimize this by calculating offsets and doing a memcpy
-		for (size_t r = 0; r < param_2.m_rows; r++) {
-			for (size_t c = 0; c < param_2.m_cols; c++) {
-				m_model_info[model_id].field_x250[c].push_back(param_2.m_data[r * param_2.m_stride + c]);
-				if (m_model_info[model_id].field_x250[c].size() > m_model_info.size()) {
-					m_model_info[model_id].field_x250[c].pop_front();
-				}
+		m_model_info[model_id].PushSlideWindow(param_2);
+	}
+
+	void UniversalDetectStream::ModelInfo::InitSlideBuffer(size_t search_depth) {
+		// The reversed search only ever looks `search_depth` frames back (the deque based
+		// implementation was bounded by the number of loaded models), but we keep the full
+		// slide window around so the other search methods can use it once implemented.
+		slide_search_depth = std::max<size_t>(search_depth, 1);
+		slide_buffer.Resize(std::max(slide_window, slide_search_depth), network.OutputDim(), MatrixResizeType::kSetZero);
+		slide_buffer_head = 0;
+		slide_buffer_fill = 0;
+
+		// Keywords of a model usually share most of their phones, so the log posteriors
+		// are computed once per frame for the union of all referenced outputs.
+		search_outputs.clear();
+		for (auto& kw : keywords)
+			search_outputs.insert(search_outputs.end(), kw.field_x88.begin(), kw.field_x88.end());
+		std::sort(search_outputs.begin(), search_outputs.end());
+		search_outputs.erase(std::unique(search_outputs.begin(), search_outputs.end()), search_outputs.end());
+		for (auto& kw : keywords) {
+			kw.search_slots.resize(kw.field_x88.size());
+			for (size_t i = 0; i < kw.field_x88.size(); i++) {
+				kw.search_slots[i] = std::lower_bound(search_outputs.begin(), search_outputs.end(), kw.field_x88[i]) - search_outputs.begin();
 			}
 		}
+		slide_log_posterior.Resize(search_outputs.size());
+	}
+
+	void UniversalDetectStream::ModelInfo::UpdateSlideLogPosterior() {
+		auto row = SlideWindowRow(std::min(slide_buffer_fill, slide_search_depth) - 1);
+		for (size_t i = 0; i < search_outputs.size(); i++) {
+			slide_log_posterior[i] = row[search_outputs[i]];
+		}
+		slide_log_posterior.ApplyFloor(std::numeric_limits<float>::min());
+		slide_log_posterior.ApplyLog();
+	}
+
+	void UniversalDetectStream::ModelInfo::PushSlideWindow(const MatrixBase& posteriors) {
+		SNOWBOY_ASSERT(posteriors.m_cols == slide_buffer.m_cols);
+		const auto rows = slide_buffer.m_rows;
+		for (size_t r = 0; r < posteriors.m_rows; r++) {
+			memcpy(slide_buffer.data(slide_buffer_head), posteriors.data(r), posteriors.m_cols * sizeof(float));
+			slide_buffer_head = slide_buffer_head + 1 == rows ? 0 : slide_buffer_head + 1;
+		}
+		slide_buffer_fill = std::min(slide_buffer_fill + posteriors.m_rows, rows);
+		if (posteriors.m_rows != 0) UpdateSlideLogPosterior();
+	}
+
+	const float* UniversalDetectStream::ModelInfo::SlideWindowRow(size_t lag) const {
+		SNOWBOY_ASSERT(lag < slide_buffer_fill);
+		const auto rows = slide_buffer.m_rows;
+		return slide_buffer.data((slide_buffer_head + rows - 1 - lag) % rows);
 	}
 
 	void UniversalDetectStream::KeyWordInfo::ReadKeyword(bool binary, std::istream* is, int slide_window) {
@@ -372,8 +676,6 @@ namespace snowboy {
 		}
 		ExpectToken(binary, "</KwInfo>", is);
 		network.Read(binary, is);
-		field_x238.resize(field_x238.size() + network.OutputDim());
-		field_x250.resize(field_x250.size() + network.OutputDim());
 		field_x268.resize(field_x268.size() + network.OutputDim());
 		if (keywords[0].search_method == 4) {
 			throw snowboy_exception{"Not implemented!"};
@@ -388,23 +690,26 @@ namespace snowboy {
 			throw snowboy_exception{"no model can be extracted from --model-str: " + filename};
 		auto s = files.size();
 		m_model_info.resize(s);
+		m_model_load_ms.resize(s);
 
-		int hotword_id = 1;
-		for (size_t f = 0; f < files.size(); f++) {
+		// Models are independent, so they are parsed concurrently and the hotword ids numbered afterwards
+		ParallelFor(files.size(), [&](size_t f) {
+			auto start = std::chrono::steady_clock::now();
 			Input in{files[f]};
-			auto binary = in.is_binary();
-			auto is = in.Stream();
-			m_model_info[f].ReadHotwordModel(binary, is, m_options.num_repeats, &hotword_id);
+			int local_id = 1;
+			m_model_info[f].ReadHotwordModel(in.is_binary(), in.Stream(), m_options.num_repeats, &local_id);
+			m_model_load_ms[f] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		});
+		int hotword_id = 1;
+		for (auto& model : m_model_info) {
+			for (auto& kw : model.keywords)
+				kw.hotword_id = hotword_id++;
 		}
 	}
 
 	void UniversalDetectStream::ModelInfo::ResetDetection() {
-		for (size_t x = 0; x < field_x238.size(); x++) {
-			field_x238[x].clear();
-		}
-		for (size_t x = 0; x < field_x250.size(); x++) {
-			field_x250[x].clear();
-		}
+		slide_buffer_head = 0;
+		slide_buffer_fill = 0;
 		for (size_t x = 0; x < field_x268.size(); x++) {
 			field_x268[x] = 0.0f;
 		}
@@ -419,6 +724,24 @@ namespace snowboy {
 		}
 	}
 
+	UniversalDetectStream::ModelInfo::ScoreState UniversalDetectStream::ModelInfo::NewScoreState() const {
+		ScoreState res;
+		res.smooth_sum.resize(field_x268.size(), 0.0f);
+		res.slide_buffer.Resize(slide_buffer.m_rows, slide_buffer.m_cols);
+		res.slide_log_posterior.Resize(slide_log_posterior.size());
+		res.kw_posterior.resize(kw_posterior.size(), 0.0f);
+		return res;
+	}
+
+	void UniversalDetectStream::ModelInfo::SwapScoreState(ScoreState* state) {
+		std::swap(field_x268, state->smooth_sum);
+		std::swap(slide_buffer, state->slide_buffer);
+		std::swap(slide_buffer_head, state->slide_buffer_head);
+		std::swap(slide_buffer_fill, state->slide_buffer_fill);
+		std::swap(slide_log_posterior, state->slide_log_posterior);
+		std::swap(kw_posterior, state->kw_posterior);
+	}
+
 	void UniversalDetectStream::ResetDetection() {
 		for (auto& e : m_model_info) {
 			e.ResetDetection();
@@ -444,6 +767,8 @@ namespace snowboy {
 			throw snowboy_exception{"Number of sensitivities does not match number of hotwords ("
 									+ std::to_string(parts.size()) + " v.s. " + std::to_string(m_model_info.size())
 									+ "). Note that each universal model may have multiple hotwords."};
+		for (auto& e : m_model_info)
+			e.UpdateThresholds();
 	}
 
 	void UniversalDetectStream::SetSensitivity(const std::string& param_1) {
@@ -465,6 +790,8 @@ namespace snowboy {
 			throw snowboy_exception{"Number of sensitivities does not match number of hotwords ("
 									+ std::to_string(parts.size()) + " v.s. " + std::to_string(m_model_info.size())
 									+ "). Note that each universal model may have multiple hotwords."};
+		for (auto& e : m_model_info)
+			e.UpdateThresholds();
 	}
 
 	void UniversalDetectStream::SetSlideWindowSize(const std::string& param_1) {
@@ -472,7 +799,10 @@ namespace snowboy {
 		SplitStringToIntegers<int>(param_1, global_snowboy_string_delimiter, &parts);
 		for (size_t i = 0; i < std::min(m_model_info.size(), parts.size()); i++) {
 			m_model_info[i].slide_window = parts[i];
+			m_model_info[i].InitSlideBuffer(m_model_info.size());
 		}
+		// The slide buffers of the channels have to match
+		if (!m_channels.empty()) SetNumChannels(m_channels.size());
 	}
 
 	void UniversalDetectStream::SetSmoothWindowSize(const std::string& param_1) {
@@ -484,15 +814,15 @@ namespace snowboy {
 	}
 
 	void UniversalDetectStream::ModelInfo::SmoothPosterior(Matrix* param_2) {
+		// NOTE: The running sum is never reduced by values leaving the smoothing window.
+		// This matches the reversed behaviour, which the naive search thresholds rely on,
+		// so there is no need to keep the window contents around.
+		auto sum = field_x268.data();
 		for (size_t r = 0; r < param_2->m_rows; r++) {
+			auto row = param_2->data(r);
 			for (size_t c = 0; c < param_2->m_cols; c++) {
-				auto val = param_2->m_data[r * param_2->m_stride + c];
-				field_x268[c] += val;
-				field_x238[c].push_back(val);
-				if (field_x238[c].size() > smooth_window) {
-					field_x238[c].pop_front();
-				}
-				param_2->m_data[r * param_2->m_stride + c] = field_x268[c] / smooth_window;
+				sum[c] += row[c];
+				row[c] = sum[c] / smooth_window;
 			}
 		}
 	}
@@ -566,6 +896,7 @@ namespace snowboy {
 			Output out{parts[file], binary};
 			auto os = out.Stream();
 			m_model_info[file].WriteHotwordModel(binary, os);
+			out.Close();
 		}
 	}
 
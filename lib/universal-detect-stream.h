@@ -1,8 +1,11 @@
 #pragma once
-#include <deque>
+#include <frame-info.h>
+#include <frame-score-sink.h>
+#include <functional>
 #include <matrix-wrapper.h>
 #include <memory>
 #include <nnet-lib.h>
+#include <vector-wrapper.h>
 #include <stream-itf.h>
 #include <string>
 
@@ -57,6 +60,8 @@ namespace snowboy {
 			std::vector<int> search_mask;
 			// Kw SearchFloor
 			std::vector<float> search_floor;
+			// Position of each field_x88 entry in ModelInfo::slide_log_posterior
+			std::vector<int> search_slots;
 			// Kw SearchMax
 			bool search_max;
 			int field_x1c0;
@@ -82,22 +87,97 @@ namespace snowboy {
 			size_t smooth_window;
 			// Slide window
 			size_t slide_window;
-			std::vector<std::deque<float>> field_x238;
-			std::vector<std::deque<float>> field_x250;
+			// Running sum of posteriors per output used by SmoothPosterior
 			std::vector<float> field_x268;
 			std::vector<float> field_x2b0;
+			// Ring buffer of smoothed posteriors, one row per frame (slide_window x OutputDim)
+			Matrix slide_buffer;
+			size_t slide_buffer_head;
+			size_t slide_buffer_fill;
+			// Number of frames the naive search looks back into the slide buffer
+			size_t slide_search_depth;
+			// Outputs referenced by any keyword and their log posterior for the searched frame
+			std::vector<int> search_outputs;
+			Vector slide_log_posterior;
+			// Per keyword scoring state, laid out as arrays so the common "nothing
+			// triggered" case is a single pass over contiguous floats.
+			std::vector<float> kw_threshold;
+			std::vector<float> kw_high_threshold;
+			std::vector<float> kw_trigger;
+			std::vector<float> kw_posterior;
 
+			// Scoring state of the model that differs between the channels of per-channel detection
+			struct ScoreState {
+				std::vector<float> smooth_sum;
+				Matrix slide_buffer;
+				size_t slide_buffer_head = 0;
+				size_t slide_buffer_fill = 0;
+				Vector slide_log_posterior;
+				std::vector<float> kw_posterior;
+			};
+
+			bool AnyKeywordTriggered() const;
+			void UpdateThresholds();
 			void CheckLicense() const;
+			void InitSlideBuffer(size_t search_depth);
+			void PushSlideWindow(const MatrixBase& posteriors);
+			void UpdateSlideLogPosterior();
+			const float* SlideWindowRow(size_t lag) const;
 			void SmoothPosterior(Matrix* param_2);
 			float HotwordNaiveSearch(size_t keyword_id) const;
 			size_t NumHotwords() const;
 			void ReadHotwordModel(bool binary, std::istream* is, int num_repeats, int* hotword_id);
 			void WriteHotwordModel(bool binary, std::ostream* os) const;
 			void ResetDetection();
+			// State of a channel that has not scored anything yet
+			ScoreState NewScoreState() const;
+			void SwapScoreState(ScoreState* state);
 			void UpdateLicense(long, float);
 		};
 
+		// Detection state of one channel in per-channel detection
+		struct ChannelState {
+			int field_x58;
+			int field_x5c;
+			bool field_x60;
+			int field_x64;
+			bool field_x68;
+			int field_x6c;
+			std::vector<ModelInfo::ScoreState> models;
+			// Networks sharing the weights of ModelInfo::network, empty for channel 0 which uses those directly
+			std::vector<Nnet> networks;
+		};
+
+		// Network outputs of one Read(), one entry per model
+		struct ScoreTraceBatch {
+			int signal;
+			std::vector<Matrix> outputs;
+			std::vector<std::vector<FrameInfo>> info;
+		};
+
+		// Detection found in a recorded score trace
+		struct TraceDetection {
+			int hotword_id;
+			uint64_t frame_id;
+			float posterior;
+		};
+
 		std::vector<ModelInfo> m_model_info;
+		// Time it took to read each model in milliseconds
+		std::vector<float> m_model_load_ms;
+		// Posterior of the keyword of the last detection
+		float m_detected_posterior = 0.0f;
+		// If set, Read() appends the network outputs here instead of searching for hotwords
+		std::vector<ScoreTraceBatch>* m_score_trace = nullptr;
+		// If set, receives the posterior of every keyword at each step
+		FrameScoreSink* m_frame_score_sink = nullptr;
+		std::vector<FrameScore> m_frame_scores;
+		// Hotword written to the frame scores for each hotword_id - 1, the pipeline's ids. Empty for the hotword_id.
+		std::vector<int> m_frame_score_hotwords;
+		// One entry per channel after SetNumChannels() with more than one channel
+		std::vector<ChannelState> m_channels;
+		// Channel of the last detection of ReadChannels()
+		size_t m_detected_channel = 0;
 
 		UniversalDetectStream(const UniversalDetectStreamOptions& options);
 		virtual int Read(Matrix* mat, std::vector<FrameInfo>* info) override;
@@ -105,6 +185,14 @@ namespace snowboy {
 		virtual std::string Name() const override;
 		virtual ~UniversalDetectStream();
 
+		// Detects on every channel separately with ReadChannels(), 1 returns to the single channel Read()
+		void SetNumChannels(size_t num_channels);
+		size_t NumChannels() const;
+		// Like Read() for the features of every channel, as read from each channel's stream with signal `signals[c]`.
+		// The networks of all channels are computed in one batch, see Nnet::ComputeBatch(). On a detection the hotword
+		// is returned in `mat` and its channel in m_detected_channel.
+		int ReadChannels(const std::vector<Matrix>& features, const std::vector<std::vector<FrameInfo>>& features_info, const std::vector<int>& signals,
+						 Matrix* mat, std::vector<FrameInfo>* info);
 		float GetHotwordPosterior(size_t model_id, int, int);
 		std::string GetSensitivity() const;
 		float HotwordDtwSearch(int, int) const;
@@ -119,10 +207,20 @@ namespace snowboy {
 		void PushSlideWindow(size_t model_id, const MatrixBase&);
 		void ReadHotwordModel(const std::string& filename);
 		void ResetDetection();
+		int ScoreKeywords(size_t model_id, unsigned int max_frame_id);
+		bool ScoreOutputs(size_t model_id, Matrix* nnet_out_mat, const std::vector<FrameInfo>& nnet_out_info, Matrix* mat,
+						  std::vector<FrameInfo>* info);
+		// Searches recorded network outputs for hotwords with the given sensitivities, as Read() would have done on a freshly
+		// constructed stream. `next_batch` is told whether the previous batch had a detection and returns the next batch to
+		// search, or nullptr at the end of the audio.
+		std::vector<TraceDetection> ReplayScoreTrace(const std::string& sensitivity, const std::string& high_sensitivity,
+													 const std::function<const ScoreTraceBatch*(bool)>& next_batch);
 		void SetHighSensitivity(const std::string&);
 		void SetSensitivity(const std::string&);
 		void SetSlideWindowSize(const std::string&);
 		void SetSmoothWindowSize(const std::string&);
+		// Exchanges the detection state of channel `channel` with the one of the stream and its models
+		void SwapChannel(size_t channel);
 		void UpdateLicense(size_t model_id, long, float);
 		void UpdateModel() const;
 		void WriteHotwordModel(bool binary, const std::string& filename) const;
@@ -2,6 +2,8 @@ extern "C"
 {
 #include <cblas.h>
 }
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <limits>
@@ -253,9 +255,7 @@ namespace snowboy {
 		if (!*os) throw snowboy_exception{"Failed to write Vector to stream"};
 		if (!binary) {
 			*os << " [ ";
-			for (uint32_t i = 0; i < m_size; i++) {
-				*os << m_data[i] << " ";
-			}
+			WriteTextValues(m_data, m_size, os);
 			*os << "]\n";
 		} else {
 			WriteToken(binary, "FV", os);
@@ -265,6 +265,14 @@ namespace snowboy {
 		if (!*os) throw snowboy_exception{"Failed to write Vector to stream"};
 	}
 
+	void VectorBase::WriteAligned(std::ostream* os) const {
+		WriteToken(true, "AV", os);
+		WriteBasicType<int32_t>(true, m_size, os);
+		WriteBlobPadding(os);
+		os->write(reinterpret_cast<const char*>(m_data), m_size * sizeof(float));
+		if (!*os) throw snowboy_exception{"Failed to write Vector to stream"};
+	}
+
 	bool VectorBase::HasNan() const noexcept {
 		for (size_t i = 0; i < size(); i++) {
 			if (m_data[i] != m_data[i]) return true;
@@ -279,8 +287,8 @@ namespace snowboy {
 		return false;
 	}
 
-	static size_t allocs = 0;
-	static size_t frees = 0;
+	static std::atomic<size_t> allocs{0};
+	static std::atomic<size_t> frees{0};
 	void Vector::Resize(size_t size, MatrixResizeType resize) {
 		SNOWBOY_ASSERT(m_size <= m_cap);
 		if (size <= m_cap) {
@@ -299,7 +307,9 @@ namespace snowboy {
 		if (ptr == nullptr) throw std::bad_alloc();
 		if (resize == MatrixResizeType::kCopyData)
 			memcpy(ptr, m_data, m_size * sizeof(float));
-		if (m_data) {
+		if (m_mapping) {
+			m_mapping.reset();
+		} else if (m_data) {
 			frees++;
 			free(m_data);
 		}
@@ -313,7 +323,7 @@ namespace snowboy {
 	}
 
 	Vector::~Vector() noexcept {
-		if (m_data) {
+		if (m_data && !m_mapping) {
 			SnowboyMemalignFree(m_data);
 			frees++;
 		}
@@ -335,42 +345,38 @@ namespace snowboy {
 
 	void Vector::Read(bool binary, bool add, std::istream* is) {
 		if (!binary) {
-			// TODO: Is this still accurate ?
-			throw snowboy_exception{"Not implemented"};
-			ExpectToken(binary, "[", is);
-			uint32_t i = 0;
-			auto s = m_size;
-			for (; i < m_size; i++) {
-				float f = 0.0f;
-				if (!isspace(is->get())) {
-					throw snowboy_exception{"Expecting space after number"};
-				}
-				if (is->peek() == ']') {
-					Resize(i, MatrixResizeType::kCopyData);
-					break;
-				}
-				*is >> f;
-				if (add)
-					m_data[i] += f;
-				else
-					m_data[i] = f;
-			}
-			if (i == s) {
-				if (!isspace(is->get())) {
-					throw snowboy_exception{"Expecting space after numbers"};
-				}
-				if (is->get() != ']') {
-					throw snowboy_exception{"Expecting closing bracket after data"};
-				}
-			}
-			if (is->get() != '\n') {
-				throw snowboy_exception{"Expecting newline after data"};
+			std::vector<float> values;
+			ReadTextBlock<float>(is, &values, nullptr);
+			if (!add) {
+				Resize(values.size(), MatrixResizeType::kUndefined);
+				std::copy(values.begin(), values.end(), m_data);
+			} else {
+				if (values.size() != m_size)
+					throw snowboy_exception{"Fail to read Vector: size mismatch " + std::to_string(values.size()) + " v.s. " + std::to_string(m_size)};
+				for (size_t i = 0; i < values.size(); i++)
+					m_data[i] += values[i];
 			}
 		} else {
-			ExpectToken(binary, "FV", is);
+			auto buffer = dynamic_cast<MemoryStreamBuf*>(is->rdbuf());
+			auto begin = buffer != nullptr ? buffer->Position() : 0;
+			std::string token;
+			ReadToken(binary, &token, is);
+			if (token != "FV" && token != "AV")
+				throw snowboy_exception{"Expected token \"FV\", got instead \"" + token + "\"."};
 			int size;
 			ReadBasicType<int32_t>(binary, &size, is);
-			if (!add) {
+			if (token == "AV") ReadBlobPadding(is);
+			if (token == "AV" && !add && buffer != nullptr && size > 0 && buffer->Remaining() >= size * sizeof(float)
+				&& reinterpret_cast<uintptr_t>(buffer->Current()) % 16 == 0) {
+				// Use the data in place, the mapping stays alive as long as this vector refers to it
+				Vector temp;
+				temp.m_data = reinterpret_cast<float*>(buffer->Current());
+				temp.m_size = size;
+				temp.m_cap = size;
+				temp.m_mapping = buffer->File();
+				Swap(&temp);
+				is->seekg(size * sizeof(float), std::ios_base::cur);
+			} else if (!add) {
 				Resize(size, MatrixResizeType::kUndefined);
 				if (size != 0) {
 					is->read(reinterpret_cast<char*>(m_data), size * sizeof(float));
@@ -383,6 +389,7 @@ namespace snowboy {
 				}
 				AddVec(1.0f, temp);
 			}
+			if (buffer != nullptr && *is) buffer->LogBlob(begin, false);
 		}
 	}
 
@@ -394,6 +401,7 @@ namespace snowboy {
 		std::swap(m_data, other->m_data);
 		std::swap(m_size, other->m_size);
 		std::swap(m_cap, other->m_cap);
+		std::swap(m_mapping, other->m_mapping);
 	}
 
 	void Vector::RemoveElement(size_t index) noexcept {
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <matrix-types.h>
+#include <memory>
 #include <snowboy-debug.h>
 #include <stdexcept>
 #include <string>
@@ -57,6 +58,8 @@ namespace snowboy {
 		void SetRandomUniform();
 		float Sum() const noexcept;
 		void Write(bool, std::ostream*) const;
+		// Binary only, writes the vector as a 64 byte aligned blob for model containers
+		void WriteAligned(std::ostream*) const;
 
 		bool HasNan() const noexcept;
 		bool HasInfinity() const noexcept;
@@ -64,6 +67,8 @@ namespace snowboy {
 	class Vector : public VectorBase {
 	protected:
 		size_t m_cap{0};
+		// Set if m_data points into a mapped model container instead of memory owned by this vector
+		std::shared_ptr<const void> m_mapping;
 
 	public:
 		Vector() noexcept {}
@@ -79,6 +84,7 @@ namespace snowboy {
 			m_size = other.m_size;
 			m_cap = other.m_cap;
 			m_data = other.m_data;
+			m_mapping = std::move(other.m_mapping);
 			other.m_data = nullptr;
 			other.m_size = 0;
 			other.m_cap = 0;
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstring>
+#include <snowboy-error.h>
+#include <snowboy-io.h>
+#include <wave-reader.h>
+
+namespace snowboy {
+	template <typename T>
+	static T ReadLittleEndian(const char* ptr) {
+		T res;
+		memcpy(&res, ptr, sizeof(T));
+		return res;
+	}
+
+	WaveReader::WaveReader(const std::string& filename)
+		: m_file{std::make_shared<const MappedFile>(filename)} {
+		auto data = m_file->data();
+		auto size = m_file->size();
+		if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+			throw snowboy_exception{"\"" + filename + "\" is not a RIFF/WAVE file"};
+
+		// Chunks can appear in any order and unknown ones (LIST, fact, ...) are skipped
+		bool has_format = false;
+		size_t pos = 12;
+		while (pos + 8 <= size) {
+			auto id = data + pos;
+			auto chunk_size = ReadLittleEndian<uint32_t>(data + pos + 4);
+			auto body = pos + 8;
+			if (memcmp(id, "fmt ", 4) == 0) {
+				if (chunk_size < 16 || body + 16 > size)
+					throw snowboy_exception{"\"" + filename + "\" has a truncated format chunk"};
+				m_header.fmtChunkSize = chunk_size;
+				m_header.wFormatTag = ReadLittleEndian<uint16_t>(data + body);
+				m_header.wChannels = ReadLittleEndian<uint16_t>(data + body + 2);
+				m_header.dwSamplesPerSec = ReadLittleEndian<uint32_t>(data + body + 4);
+				m_header.dwAvgBytesPerSec = ReadLittleEndian<uint32_t>(data + body + 8);
+				m_header.wBlockAlign = ReadLittleEndian<uint16_t>(data + body + 12);
+				m_header.wBitsPerSample = ReadLittleEndian<uint16_t>(data + body + 14);
+				has_format = true;
+			} else if (memcmp(id, "data", 4) == 0) {
+				if (!has_format)
+					throw snowboy_exception{"\"" + filename + "\" has no format chunk before its data"};
+				// Recorders that were interrupted leave a wrong (often 0 or ~0) size, use what is actually there
+				size_t available = size - body;
+				m_header.dataChunkSize = chunk_size;
+				m_header.chunkSize = ReadLittleEndian<uint32_t>(data + 4);
+				if (m_header.wFormatTag != 1)
+					throw snowboy_exception{"\"" + filename + "\" is not linear PCM (format " + std::to_string(m_header.wFormatTag) + ")"};
+				if (m_header.wBitsPerSample != 16 || m_header.wChannels == 0 || m_header.wBlockAlign != 2 * m_header.wChannels)
+					throw snowboy_exception{"\"" + filename + "\" has " + std::to_string(m_header.wBitsPerSample) + " bits per sample and "
+											+ std::to_string(m_header.wChannels) + " channels, only 16 bit samples are supported"};
+				m_samples = reinterpret_cast<const int16_t*>(data + body);
+				m_num_frames = std::min<size_t>(chunk_size == 0 ? available : chunk_size, available) / m_header.wBlockAlign;
+				return;
+			}
+			// Chunks are padded to an even size
+			pos = body + chunk_size + (chunk_size & 1);
+		}
+		throw snowboy_exception{"\"" + filename + "\" has no data chunk"};
+	}
+
+	void WaveReader::CheckFormat(int sample_rate, int num_channels, int bits_per_sample) const {
+		if (static_cast<int>(m_header.dwSamplesPerSec) != sample_rate || m_header.wChannels != num_channels
+			|| m_header.wBitsPerSample != bits_per_sample)
+			throw snowboy_exception{"wave format mismatch, expecting " + std::to_string(sample_rate) + " Hz, "
+									+ std::to_string(num_channels) + " channels, " + std::to_string(bits_per_sample) + " bits, got "
+									+ std::to_string(m_header.dwSamplesPerSec) + " Hz, " + std::to_string(m_header.wChannels)
+									+ " channels, " + std::to_string(m_header.wBitsPerSample) + " bits"};
+	}
+
+	const int16_t* WaveReader::NextChunk(size_t max_frames, size_t* num_frames) {
+		*num_frames = std::min(max_frames, m_num_frames - m_position);
+		if (*num_frames == 0) return nullptr;
+		auto res = m_samples + m_position * m_header.wChannels;
+		m_position += *num_frames;
+		return res;
+	}
+
+	void WaveReader::Seek(size_t frame) {
+		if (frame > m_num_frames)
+			throw snowboy_exception{"cannot seek to frame " + std::to_string(frame) + " of " + std::to_string(m_num_frames)};
+		m_position = frame;
+	}
+} // namespace snowboy
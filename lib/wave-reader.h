@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <wave-header.h>
+
+namespace snowboy {
+	class MappedFile;
+
+	// Reads 16 bit PCM wave files from a memory mapping. Chunks point straight into the mapping, so scanning large
+	// recordings does not copy or allocate per chunk.
+	class WaveReader {
+		std::shared_ptr<const MappedFile> m_file;
+		WaveHeader m_header;
+		const int16_t* m_samples{nullptr};
+		size_t m_num_frames{0};
+		size_t m_position{0};
+
+	public:
+		explicit WaveReader(const std::string& filename);
+
+		const WaveHeader& Header() const noexcept { return m_header; }
+		// Number of frames, each holding one sample per channel
+		size_t NumFrames() const noexcept { return m_num_frames; }
+		size_t Position() const noexcept { return m_position; }
+		const int16_t* Samples() const noexcept { return m_samples; }
+
+		// Throws if the file does not have the given format, e.g. the one expected by SnowboyDetect.
+		void CheckFormat(int sample_rate, int num_channels, int bits_per_sample) const;
+		// Returns up to `max_frames` interleaved frames from the current position and advances past them.
+		// Returns nullptr once the end is reached.
+		const int16_t* NextChunk(size_t max_frames, size_t* num_frames);
+		void Seek(size_t frame);
+	};
+} // namespace snowboy
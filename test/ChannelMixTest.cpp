@@ -0,0 +1,214 @@
+#include <channel-mix-stream.h>
+#include <chrono>
+#include <cmath>
+#include <frame-info.h>
+#include <helper.h>
+#include <intercept-stream.h>
+#include <matrix-wrapper.h>
+#include <snowboy-detect.h>
+#include <snowboy-error.h>
+
+const static auto root = detect_project_root();
+
+// Channel c is `source` delayed by delays[c] samples with independent noise of `noise` amplitude
+static snowboy::Matrix mic_array(const std::vector<float>& source, const std::vector<int>& delays, int noise, unsigned int* seed) {
+	snowboy::Matrix res;
+	res.Resize(delays.size(), source.size());
+	for (size_t c = 0; c < delays.size(); c++) {
+		for (size_t i = 0; i < source.size(); i++) {
+			auto idx = static_cast<int64_t>(i) - delays[c];
+			auto v = idx >= 0 && idx < static_cast<int64_t>(source.size()) ? source[idx] : 0.0f;
+			res(c, i) = v + (noise != 0 ? static_cast<float>(static_cast<int>(rand_r(seed) % (2 * noise + 1)) - noise) : 0.0f);
+		}
+	}
+	return res;
+}
+
+// Feeds the columns [begin, end) of `input`
+static snowboy::Matrix mix(snowboy::ChannelMixStream* stream, snowboy::InterceptStream* intercept, const snowboy::Matrix& input, size_t begin,
+						   size_t end, bool is_end) {
+	snowboy::Matrix chunk;
+	chunk.Resize(input.rows(), end - begin);
+	for (size_t r = 0; r < input.rows(); r++) {
+		for (size_t c = begin; c < end; c++)
+			chunk(r, c - begin) = input(r, c);
+	}
+	intercept->SetData(chunk, std::vector<snowboy::FrameInfo>(input.rows()), static_cast<snowboy::SnowboySignal>(is_end ? 0x30 : 0x20));
+	snowboy::Matrix out;
+	std::vector<snowboy::FrameInfo> info;
+	stream->Read(&out, &info);
+	return out;
+}
+
+TEST(ChannelMixTest, BeamformingFindsDelays) {
+	const std::vector<int> delays{0, 3, -5, 7};
+	std::vector<float> source(16000);
+	unsigned int seed = 12;
+	for (auto& e : source)
+		e = static_cast<float>(static_cast<int>(rand_r(&seed) % 20001) - 10000);
+	auto input = mic_array(source, delays, 10000, &seed);
+
+	snowboy::ChannelMixStreamOptions options;
+	snowboy::ChannelMixStream stream{options};
+	snowboy::InterceptStream intercept;
+	stream.Connect(&intercept);
+	std::vector<float> output;
+	for (size_t i = 0; i < source.size(); i += 1600) {
+		auto out = mix(&stream, &intercept, input, i, i + 1600, i + 1600 == source.size());
+		if (i + 1600 < source.size()) {
+			ASSERT_EQ(out.rows(), 1);
+			for (size_t c = 0; c < delays.size(); c++)
+				ASSERT_EQ(stream.Lags()[c], delays[c]) << "channel " << c << " at " << i;
+		}
+		for (size_t c = 0; c < out.cols(); c++)
+			output.push_back(out(0, c));
+	}
+	ASSERT_EQ(output.size(), source.size());
+	// Averaging four aligned channels with independent noise gains 6 dB
+	double noise_in = 0, noise_out = 0;
+	for (size_t i = 100; i + 100 < source.size(); i++) {
+		noise_in += (input(0, i) - source[i]) * (input(0, i) - source[i]);
+		noise_out += (output[i] - source[i]) * (output[i] - source[i]);
+	}
+	const auto gain = 10 * log10(noise_in / noise_out);
+	ASSERT_GT(gain, 5.0);
+}
+
+TEST(ChannelMixTest, EmptyEndFlushes) {
+	const std::vector<int> delays{0, 2, -3};
+	std::vector<float> source(3200);
+	unsigned int seed = 4;
+	for (auto& e : source)
+		e = static_cast<float>(static_cast<int>(rand_r(&seed) % 20001) - 10000);
+	auto input = mic_array(source, delays, 0, &seed);
+
+	snowboy::ChannelMixStreamOptions options;
+	snowboy::ChannelMixStream stream{options};
+	snowboy::InterceptStream intercept;
+	stream.Connect(&intercept);
+	std::vector<std::vector<float>> outputs(2);
+	for (auto& output : outputs) {
+		for (size_t i = 0; i <= source.size(); i += 1600) {
+			// The last read is empty and marks the end
+			auto out = mix(&stream, &intercept, input, i, std::min(i + 1600, source.size()), i == source.size());
+			for (size_t c = 0; c < out.cols(); c++)
+				output.push_back(out(0, c));
+		}
+	}
+	// The held back samples came out at the end and the second stream started from scratch
+	ASSERT_EQ(outputs[0].size(), source.size());
+	ASSERT_EQ(outputs[0], outputs[1]);
+}
+
+TEST(ChannelMixTest, SelectsLoudestChannel) {
+	std::vector<float> source(16000);
+	for (size_t i = 0; i < source.size(); i++)
+		source[i] = static_cast<float>(5000 * sin(2 * M_PI * 440 * i / 16000.0));
+	unsigned int seed = 1;
+	auto input = mic_array(source, {0, 0, 0}, 0, &seed);
+	for (size_t i = 0; i < source.size(); i++) {
+		input(0, i) *= 0.1f;
+		input(1, i) *= 0.2f;
+	}
+	snowboy::ChannelMixStreamOptions options;
+	options.method = "select";
+	snowboy::ChannelMixStream stream{options};
+	snowboy::InterceptStream intercept;
+	stream.Connect(&intercept);
+	auto first = mix(&stream, &intercept, input, 0, 1600, false);
+	ASSERT_EQ(stream.SelectedChannel(), 2);
+	// The first samples fade over from channel 0
+	ASSERT_LT(std::abs(first(0, 10) - input(2, 10)), std::abs(input(0, 10) - input(2, 10)));
+	for (size_t c = 160; c < 1600; c++)
+		ASSERT_EQ(first(0, c), input(2, c));
+	auto second = mix(&stream, &intercept, input, 1600, 3200, false);
+	for (size_t c = 0; c < 1600; c++)
+		ASSERT_EQ(second(0, c), input(2, 1600 + c));
+}
+
+TEST(ChannelMixTest, DetectsOnMicArray) {
+	if (!file_exists(root + "audio_samples/snowboy.wav")) {
+		GTEST_WARN("Skiping test because audio file is missing!");
+		return;
+	}
+	auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+	std::vector<float> source(data.begin(), data.end());
+	unsigned int seed = 3;
+	auto array = mic_array(source, {0, 2, -3, 4}, 300, &seed);
+	std::vector<short> interleaved(array.rows() * array.cols());
+	for (size_t c = 0; c < array.cols(); c++) {
+		for (size_t r = 0; r < array.rows(); r++)
+			interleaved[c * array.rows() + r] = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, array(r, c))));
+	}
+
+	auto run = [&](const std::string& method, double* ms) {
+		snowboy::SnowboyDetect detector(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+		detector.SetNumChannels(4);
+		detector.SetChannelMix(method);
+		EXPECT_EQ(detector.NumChannels(), 4);
+		std::vector<int> hits;
+		auto start = std::chrono::steady_clock::now();
+		const size_t chunk = 1600 * 4;
+		for (size_t i = 0; i < interleaved.size(); i += chunk) {
+			auto res = detector.RunDetection(interleaved.data() + i, std::min(chunk, interleaved.size() - i));
+			if (res > 0) hits.push_back(res);
+		}
+		*ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return hits;
+	};
+	double beamform_ms = 0, select_ms = 0, first_ms = 0;
+	ASSERT_EQ(run("beamform", &beamform_ms), std::vector<int>{1});
+	ASSERT_EQ(run("select", &select_ms), std::vector<int>{1});
+	ASSERT_EQ(run("first", &first_ms), std::vector<int>{1});
+	ASSERT_THROW(snowboy::SnowboyDetect(root + "resources/common.res", root + "resources/models/snowboy.umdl").SetChannelMix("sum"),
+				 snowboy::snowboy_exception);
+	GTEST_WARN("4 channels, %.1f s of audio: beamform %.2f ms, select %.2f ms, first %.2f ms", source.size() / 16000.0, beamform_ms, select_ms,
+			   first_ms);
+}
+
+TEST(ChannelMixTest, DetectsPerChannel) {
+	if (!file_exists(root + "audio_samples/snowboy.wav")) {
+		GTEST_WARN("Skiping test because audio file is missing!");
+		return;
+	}
+	auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+	// Only the third channel hears the hotword, the others hear noise
+	const size_t num_channels = 4;
+	std::vector<short> interleaved(data.size() * num_channels);
+	unsigned int seed = 5;
+	for (size_t i = 0; i < data.size(); i++) {
+		for (size_t c = 0; c < num_channels; c++)
+			interleaved[i * num_channels + c] = c == 2 ? data[i] : static_cast<short>(static_cast<int>(rand_r(&seed) % 601) - 300);
+	}
+
+	auto run = [&](snowboy::SnowboyDetect& detector, const short* audio, size_t len, size_t chunk, double* ms) {
+		std::vector<int> hits;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < len; i += chunk) {
+			auto res = detector.RunDetection(audio + i, std::min(chunk, len - i));
+			if (res > 0) hits.push_back(res);
+		}
+		*ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return hits;
+	};
+	snowboy::SnowboyDetect detector(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+	detector.SetNumChannels(num_channels);
+	detector.SetChannelMix("separate");
+	double separate_ms = 0;
+	ASSERT_EQ(run(detector, interleaved.data(), interleaved.size(), 1600 * num_channels, &separate_ms), std::vector<int>{1});
+	ASSERT_EQ(detector.GetLastDetectionChannel(), 2);
+
+	// The same as a detector on the hotword channel alone
+	snowboy::SnowboyDetect single(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+	double single_ms = 0;
+	ASSERT_EQ(run(single, data.data(), data.size(), 1600, &single_ms), std::vector<int>{1});
+	ASSERT_EQ(detector.GetLastDetectionFrameId(), single.GetLastDetectionFrameId());
+	ASSERT_EQ(detector.GetLastDetectionScore(), single.GetLastDetectionScore());
+
+	// Personal models are rejected before they are swapped in, detection goes on with the old ones
+	ASSERT_THROW(detector.ReplaceModels(root + "resources/pmdl/hey_casper.pmdl," + root + "resources/models/snowboy.umdl"),
+				 snowboy::snowboy_exception);
+	double again_ms = 0;
+	ASSERT_EQ(run(detector, interleaved.data(), interleaved.size(), 1600 * num_channels, &again_ms), std::vector<int>{1});
+	GTEST_WARN("%zu channels detected separately in %.2f ms, one channel %.2f ms", num_channels, separate_ms, single_ms);
+}
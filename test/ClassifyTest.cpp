@@ -1,6 +1,12 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <helper.h>
 #include <matrix-wrapper.h>
 #include <snowboy-detect.h>
+#include <snowboy-error.h>
+#include <snowboy-io.h>
+#include <thread>
 #include <vad-lib.h>
 #include <vector-wrapper.h>
 
@@ -226,3 +232,138 @@ TEST(ClassifyTest, LoadModels) {
 	}
 	ASSERT_FALSE(skipped_all);
 }
+
+TEST(ClassifyTest, LoadModelsAtOnce) {
+	std::string models;
+	std::vector<std::string> files;
+	int expected_hotwords = 0;
+	for (auto& e : model_map) {
+		if (!file_exists(root + "resources/models/" + e)) continue;
+		snowboy::SnowboyDetect detector(root + "resources/common.res", root + "resources/models/" + e);
+		expected_hotwords += detector.NumHotwords();
+		files.push_back(root + "resources/models/" + e);
+	}
+	files.push_back(root + "resources/pmdl/hey_casper.pmdl");
+	expected_hotwords++;
+	for (auto& e : files)
+		models += (models.empty() ? "" : ",") + e;
+
+	auto resource = snowboy::PinMappedFile(root + "resources/common.res");
+	snowboy::MappedFile::ResetNumMappings();
+	auto start = std::chrono::steady_clock::now();
+	snowboy::SnowboyDetect detector(root + "resources/common.res", models);
+	auto time = std::chrono::steady_clock::now() - start;
+	// Every model file is mapped exactly once, even though it is read for classification and by its stream
+	ASSERT_EQ(snowboy::MappedFile::NumMappings(), files.size());
+	ASSERT_EQ(detector.NumHotwords(), expected_hotwords);
+	auto load_times = detector.GetModelLoadTimes();
+	ASSERT_EQ(load_times.size(), files.size());
+	for (size_t i = 0; i < files.size(); i++)
+		GTEST_WARN("%s: %.2f ms", files[i].substr(files[i].find_last_of('/') + 1).c_str(), load_times[i]);
+	GTEST_WARN("detector construction with %zu models: %.2f ms", files.size(),
+			   std::chrono::duration<double, std::milli>(time).count());
+
+	// Hotword ids follow the order of the model string, snowboy.umdl comes after jarvis.umdl with two hotwords
+	if (!file_exists(root + "audio_samples/snowboy.wav")) return;
+	snowboy::SnowboyDetect ordered(root + "resources/common.res",
+								   root + "resources/models/jarvis.umdl," + root + "resources/pmdl/hey_casper.pmdl," + root + "resources/models/snowboy.umdl");
+	ordered.SetSensitivity("0.1,0.1,0.1,0.5");
+	ordered.ApplyFrontend(false);
+	auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+	ASSERT_EQ(ordered.RunDetection(data.data(), data.size()), 4);
+}
+
+TEST(ClassifyTest, ReplaceModels) {
+	if (!file_exists(root + "audio_samples/snowboy.wav") || !file_exists(root + "audio_samples/noise1.wav")) {
+		GTEST_WARN("Skiping because audio file is missing!");
+		return;
+	}
+	auto noise = read_sample_file(root + "audio_samples/noise1.wav");
+	auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+	snowboy::SnowboyDetect detector(root + "resources/common.res", root + "resources/models/jarvis.umdl");
+	detector.ApplyFrontend(false);
+	ASSERT_EQ(detector.NumHotwords(), 2);
+
+	// Keep detecting on noise while the models are replaced from another thread
+	std::atomic<bool> replaced{false};
+	std::thread loader{[&]() {
+		detector.ReplaceModels(root + "resources/pmdl/hey_casper.pmdl," + root + "resources/models/snowboy.umdl");
+		replaced = true;
+	}};
+	const size_t chunksize = 1600;
+	for (size_t i = 0; !replaced || i < noise.size(); i += chunksize) {
+		auto offset = i % noise.size();
+		auto len = std::min<size_t>(chunksize, noise.size() - offset);
+		EXPECT_LE(detector.RunDetection(noise.data() + offset, len), 0);
+		// Both model sets have two hotwords, the accessors see one of them as a whole
+		EXPECT_EQ(detector.NumHotwords(), 2);
+		auto num_models = detector.GetModelLoadTimes().size();
+		auto sensitivity = detector.GetSensitivity();
+		EXPECT_EQ(std::count(sensitivity.begin(), sensitivity.end(), ',') + 1, num_models) << sensitivity;
+	}
+	loader.join();
+	ASSERT_FALSE(::testing::Test::HasFailure());
+	ASSERT_EQ(detector.NumHotwords(), 2);
+	ASSERT_EQ(detector.GetModelLoadTimes().size(), 2);
+
+	int result = 0;
+	for (size_t i = 0; i < data.size(); i += chunksize) {
+		auto len = std::min<size_t>(chunksize, data.size() - i);
+		result = std::max(result, detector.RunDetection(data.data() + i, len));
+	}
+	ASSERT_EQ(result, 2);
+	ASSERT_THROW(detector.ReplaceModels(""), snowboy::snowboy_exception);
+}
+
+TEST(ClassifyTest, PowerSavingParity) {
+	// Every sample on its own, then all of them with 5 s of quiet noise in between. Unlike digital silence the noise
+	// passes the energy VAD of the resource, so only the gate drops it.
+	std::vector<std::pair<std::string, std::vector<short>>> inputs;
+	std::vector<short> joined;
+	unsigned int seed = 7;
+	auto add_noise = [&]() {
+		for (size_t i = 0; i < 5 * 16000; i++)
+			joined.push_back(static_cast<short>(static_cast<int>(rand_r(&seed) % 61) - 30));
+	};
+	for (auto& e : sample_map) {
+		if (!file_exists(root + "audio_samples/" + e.first)) continue;
+		auto data = read_sample_file(root + "audio_samples/" + e.first);
+		add_noise();
+		joined.insert(joined.end(), data.begin(), data.end());
+		inputs.emplace_back(e.first, std::move(data));
+	}
+	if (inputs.empty()) {
+		GTEST_SKIP() << "audio files are missing";
+	}
+	add_noise();
+	inputs.emplace_back("joined samples", std::move(joined));
+
+	uint64_t skipped = 0;
+	auto run = [&](const std::vector<short>& data, bool power_saving, std::vector<snowboy::HotwordDetection>* detections) {
+		snowboy::SnowboyDetect detector(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+		detector.SetPowerSaving(power_saving);
+		const size_t chunksize = 1600;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < data.size(); i += chunksize) {
+			auto len = std::min<size_t>(chunksize, data.size() - i);
+			auto res = detector.RunDetection(data.data() + i, len, i + len == data.size());
+			if (res > 0) detections->push_back({res, detector.GetLastDetectionFrameId(), detector.GetLastDetectionScore()});
+		}
+		skipped = detector.GetPowerSavingSkippedFrames();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+	double time = 0, time_saving = 0;
+	for (auto& e : inputs) {
+		std::vector<snowboy::HotwordDetection> expected, detections;
+		time = run(e.second, false, &expected);
+		time_saving = run(e.second, true, &detections);
+		if (&e == &inputs.back()) ASSERT_GT(skipped, 0) << "the gate dropped none of the noise";
+		ASSERT_EQ(expected.size(), detections.size()) << e.first;
+		for (size_t i = 0; i < expected.size(); i++) {
+			ASSERT_EQ(expected[i].hotword, detections[i].hotword) << e.first << " detection " << i;
+			ASSERT_EQ(expected[i].frame_id, detections[i].frame_id) << e.first << " detection " << i;
+		}
+	}
+	GTEST_WARN("%.1f s of joined samples: %.2f ms, with power saving %.2f ms, %lu frames skipped", inputs.back().second.size() / 16000.0, time,
+			   time_saving, static_cast<unsigned long>(skipped));
+}
@@ -0,0 +1,85 @@
+#include <audio-lib.h>
+#include <chrono>
+#include <helper.h>
+#include <matrix-wrapper.h>
+
+// The column major loop RunDetection used to fill its matrix with
+template <typename T>
+static void reference_deinterleave(const T* data, size_t channels, size_t frames, snowboy::Matrix* mat) {
+	mat->Resize(channels, frames, snowboy::MatrixResizeType::kSetZero);
+	for (size_t c = 0; c < mat->cols(); c++) {
+		for (size_t r = 0; r < mat->rows(); r++)
+			(*mat)(r, c) = data[c * mat->rows() + r];
+	}
+}
+
+template <typename T>
+static void check_deinterleave(int range) {
+	unsigned int seed = 2;
+	for (size_t channels : {1, 2, 3}) {
+		for (size_t frames : {0, 1, 7, 8, 1601}) {
+			std::vector<T> data(channels * frames);
+			for (auto& e : data)
+				e = static_cast<T>(static_cast<int64_t>(rand_r(&seed) % (2 * range + 1)) - range);
+			snowboy::Matrix expected, mat;
+			reference_deinterleave(data.data(), channels, frames, &expected);
+			snowboy::DeinterleaveSamples(data.data(), channels, frames, &mat);
+			ASSERT_EQ(mat.rows(), expected.rows());
+			ASSERT_EQ(mat.cols(), expected.cols());
+			for (size_t r = 0; r < mat.rows(); r++) {
+				for (size_t c = 0; c < mat.cols(); c++)
+					ASSERT_EQ(mat(r, c), expected(r, c)) << channels << " channels, " << frames << " frames, " << r << "," << c;
+			}
+		}
+	}
+}
+
+TEST(DeinterleaveTest, MatchesColumnLoop) {
+	check_deinterleave<int8_t>(128);
+	check_deinterleave<int16_t>(32768);
+	check_deinterleave<int32_t>(1 << 30);
+
+	std::vector<float> data(2 * 1001);
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = static_cast<float>(i) / data.size() - 0.5f;
+	snowboy::Matrix expected, mat;
+	reference_deinterleave(data.data(), 2, 1001, &expected);
+	expected.Scale(32767.0f);
+	snowboy::DeinterleaveSamples(data.data(), 2, 1001, 32767.0f, &mat);
+	for (size_t r = 0; r < 2; r++) {
+		for (size_t c = 0; c < 1001; c++)
+			ASSERT_EQ(mat(r, c), expected(r, c));
+	}
+}
+
+TEST(DeinterleaveTest, ReusesBuffer) {
+	std::vector<int16_t> data(2 * 1600, 1);
+	snowboy::Matrix mat;
+	snowboy::DeinterleaveSamples(data.data(), 2, 1600, &mat);
+	auto ptr = mat.data();
+	snowboy::DeinterleaveSamples(data.data(), 2, 1600, &mat);
+	ASSERT_EQ(mat.data(), ptr);
+	snowboy::DeinterleaveSamples(data.data(), 1, 1600, &mat);
+	ASSERT_EQ(mat.data(), ptr);
+}
+
+TEST(DeinterleaveTest, Speed) {
+	const size_t frames = 1600, iterations = 2000;
+	std::vector<int16_t> data(2 * frames);
+	unsigned int seed = 8;
+	for (auto& e : data)
+		e = static_cast<int16_t>(rand_r(&seed));
+	snowboy::Matrix mat;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		snowboy::Matrix fresh;
+		reference_deinterleave(data.data(), 2, frames, &fresh);
+	}
+	auto mid = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++)
+		snowboy::DeinterleaveSamples(data.data(), 2, frames, &mat);
+	auto end = std::chrono::steady_clock::now();
+	GTEST_WARN("deinterleaving 100 ms of 16 bit stereo: column loop %.2f us, vectorized %.2f us",
+			   std::chrono::duration<double, std::micro>(mid - start).count() / iterations,
+			   std::chrono::duration<double, std::micro>(end - mid).count() / iterations);
+}
@@ -1,6 +1,9 @@
+#include <chrono>
 #include <dtw-lib.h>
 #include <helper.h>
+#include <limits>
 #include <matrix-wrapper.h>
+#include <template-container.h>
 
 const static auto root = detect_project_root();
 
@@ -78,3 +81,91 @@ TEST(DtwTest, Random2) {
 		EXPECT_EQ(t[i][0], 32);
 	}
 }
+
+TEST(DtwTest, BandCoveringPath) {
+	unsigned int seed = 7;
+	for (int i = 0; i < 20; i++) {
+		auto m1 = random_matrix(&seed);
+		auto m2 = random_matrix(&seed);
+		std::vector<std::vector<size_t>> t_full, t_band;
+		auto full = snowboy::DtwAlign(snowboy::euclidean, m1, m2, &t_full);
+		// A band wider than both templates has to give the exact same alignment
+		auto band = snowboy::DtwAlign(snowboy::euclidean, m1, m2, &t_band, std::max(m1.rows(), m2.rows()));
+		ASSERT_EQ(full, band);
+		ASSERT_EQ(t_full, t_band);
+		// A narrow band can only restrict the search
+		auto narrow = snowboy::DtwAlign(snowboy::euclidean, m1, m2, &t_band, 2);
+		ASSERT_GE(narrow, full);
+		ASSERT_EQ(t_band.size(), m1.rows());
+	}
+}
+
+TEST(DtwTest, LongTemplatesBanded) {
+	// 4000 x 4000 cells would need two 64MB matrices with a full cost matrix and traceback
+	unsigned int seed = 11;
+	snowboy::Matrix m1, m2;
+	m1.Resize(4000, 16);
+	m2.Resize(3700, 16);
+	for (size_t i = 0; i < m1.m_rows * m1.m_stride; i++)
+		m1.m_data[i] = (rand_r(&seed) % 1000) / 100.0f;
+	for (size_t i = 0; i < m2.m_rows * m2.m_stride; i++)
+		m2.m_data[i] = (rand_r(&seed) % 1000) / 100.0f;
+	std::vector<std::vector<size_t>> t;
+	auto start = std::chrono::steady_clock::now();
+	auto res = snowboy::DtwAlign(snowboy::euclidean, m1, m2, &t, 40);
+	auto time = std::chrono::steady_clock::now() - start;
+	ASSERT_LT(res, std::numeric_limits<float>::max());
+	ASSERT_EQ(t.size(), m1.rows());
+	for (size_t i = 1; i < t.size(); i++) {
+		ASSERT_EQ(t[i].size(), 1);
+		ASSERT_GE(t[i][0], t[i - 1][0]);
+		ASSERT_LT(t[i][0], m2.rows());
+	}
+	GTEST_WARN("banded alignment of 4000x3700 frames: %.1f ms", std::chrono::duration<double, std::milli>(time).count());
+}
+
+static snowboy::TemplateContainer random_templates(size_t num, unsigned int* seed) {
+	snowboy::TemplateContainer res;
+	for (size_t i = 0; i < num; i++) {
+		snowboy::Matrix m;
+		m.Resize(80 + rand_r(seed) % 60, 32);
+		for (size_t r = 0; r < m.rows(); r++) {
+			for (size_t c = 0; c < m.cols(); c++)
+				m(r, c) = (rand_r(seed) % 1000) / 100.0f;
+		}
+		res.AddTemplate(m);
+	}
+	return res;
+}
+
+TEST(DtwTest, CombineTemplatesParallel) {
+	unsigned int seed = 3;
+	auto templates = random_templates(20, &seed);
+
+	// Combines a copy of `templates` and returns the time it took
+	auto combine = [&](int band_width, size_t num_threads, snowboy::TemplateContainer* res) {
+		*res = templates;
+		auto start = std::chrono::steady_clock::now();
+		res->CombineTemplates(snowboy::euclidean, band_width, num_threads);
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+	auto expect_same = [](const snowboy::TemplateContainer& a, const snowboy::TemplateContainer& b) {
+		ASSERT_EQ(a.NumTemplates(), 1);
+		ASSERT_EQ(b.NumTemplates(), 1);
+		ASSERT_EQ(a.m_templates[0].rows(), b.m_templates[0].rows());
+		for (size_t r = 0; r < a.m_templates[0].rows(); r++) {
+			for (size_t c = 0; c < a.m_templates[0].cols(); c++)
+				ASSERT_EQ(a.m_templates[0](r, c), b.m_templates[0](r, c));
+		}
+	};
+	snowboy::TemplateContainer serial, parallel, banded_serial, banded;
+	auto ms_serial = combine(-1, 1, &serial);
+	auto ms_parallel = combine(-1, 0, &parallel);
+	combine(10, 1, &banded_serial);
+	auto ms_banded = combine(10, 0, &banded);
+	// The thread count never changes the result
+	expect_same(serial, parallel);
+	expect_same(banded_serial, banded);
+
+	GTEST_WARN("combine 20 templates: serial %.1f ms, parallel %.1f ms, parallel banded %.1f ms", ms_serial, ms_parallel, ms_banded);
+}
@@ -0,0 +1,65 @@
+#include <cmath>
+#include <energy-gate-stream.h>
+#include <frame-info.h>
+#include <helper.h>
+#include <intercept-stream.h>
+#include <matrix-wrapper.h>
+#include <snowboy-error.h>
+
+// A read of 10 frames of 400 samples, quiet noise or a loud tone, numbered from `first_id`
+static void set_read(snowboy::InterceptStream* intercept, bool loud, int first_id, unsigned int* seed) {
+	snowboy::Matrix mat;
+	mat.Resize(10, 400);
+	std::vector<snowboy::FrameInfo> info(10);
+	for (size_t r = 0; r < mat.rows(); r++) {
+		for (size_t c = 0; c < mat.cols(); c++)
+			mat(r, c) = loud ? static_cast<float>(5000 * sin(2 * M_PI * 440 * c / 16000.0)) : static_cast<float>(static_cast<int>(rand_r(seed) % 61) - 30);
+		info[r].frame_id = first_id + r;
+	}
+	intercept->SetData(mat, info, static_cast<snowboy::SnowboySignal>(0x20));
+}
+
+TEST(EnergyGateTest, DropsSilenceAndReplaysLookBack) {
+	snowboy::EnergyGateStreamOptions options;
+	options.min_silence_frames = 30;
+	options.look_back_frames = 25;
+	snowboy::EnergyGateStream gate{options};
+	snowboy::InterceptStream intercept;
+	gate.Connect(&intercept);
+	gate.AllowSkipping(true);
+	unsigned int seed = 2;
+	snowboy::Matrix mat;
+	std::vector<snowboy::FrameInfo> info;
+
+	int id = 0;
+	// The first three reads pass until the gate closed, the next ones are dropped
+	for (int i = 0; i < 10; i++, id += 10) {
+		set_read(&intercept, false, id, &seed);
+		ASSERT_EQ(gate.Read(&mat, &info), 0x20);
+		ASSERT_EQ(mat.rows(), i < 3 ? 10 : 0) << "read " << i;
+		ASSERT_EQ(gate.IsOpen(), i < 2);
+		ASSERT_FALSE(gate.HasPending());
+	}
+	// The three reads holding the last 25 dropped frames come first, then the loud one
+	set_read(&intercept, true, id, &seed);
+	std::vector<int> first_ids;
+	do {
+		ASSERT_EQ(gate.Read(&mat, &info), 0x20);
+		ASSERT_EQ(mat.rows(), 10);
+		ASSERT_EQ(info.size(), 10);
+		first_ids.push_back(info[0].frame_id);
+	} while (gate.HasPending());
+	ASSERT_EQ(first_ids, (std::vector<int>{70, 80, 90, 100}));
+	ASSERT_TRUE(gate.IsOpen());
+	ASSERT_EQ(gate.SkippedFrames(), 40);
+	ASSERT_EQ(mat(0, 100), static_cast<float>(5000 * sin(2 * M_PI * 440 * 100 / 16000.0)));
+
+	// Nothing is dropped while skipping is not allowed
+	gate.AllowSkipping(false);
+	for (int i = 0; i < 10; i++, id += 10) {
+		set_read(&intercept, false, id, &seed);
+		gate.Read(&mat, &info);
+		ASSERT_EQ(mat.rows(), 10);
+	}
+	ASSERT_THROW(snowboy::EnergyGateStream(snowboy::EnergyGateStreamOptions{1.0f, 0, 50, 50}), snowboy::snowboy_exception);
+}
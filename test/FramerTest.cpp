@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cmath>
+#include <framer-stream.h>
+#include <helper.h>
+#include <matrix-wrapper.h>
+#include <random>
+
+static snowboy::FramerStreamOptions dither_options(int seed) {
+	snowboy::FramerStreamOptions options;
+	options.sample_rate = 16000;
+	options.frame_length_ms = 25;
+	options.frame_shift_ms = 10;
+	options.dither_coeff = 1.0f;
+	options.dither_seed = seed;
+	options.preemphasis_coeff = 0.0f;
+	options.subtract_mean = false;
+	options.window_type = "rectangular";
+	return options;
+}
+
+TEST(FramerTest, DitherStatistics) {
+	snowboy::DitherGenerator gen;
+	gen.Seed(1);
+	std::vector<float> data(1000003, 0.0f);
+	gen.AddNoise(data.data(), data.size(), 1.0f);
+	double sum = 0, sum2 = 0, sum4 = 0;
+	size_t above = 0;
+	for (auto e : data) {
+		sum += e;
+		sum2 += e * e;
+		sum4 += e * e * e * e;
+		if (std::abs(e) > 1.96f) above++;
+	}
+	auto mean = sum / data.size();
+	auto var = sum2 / data.size() - mean * mean;
+	ASSERT_NEAR(mean, 0.0, 0.01);
+	ASSERT_NEAR(var, 1.0, 0.01);
+	// A sum of four uniforms has slightly lighter tails than a Gaussian (kurtosis 2.7 instead of 3)
+	ASSERT_NEAR(sum4 / data.size() / (var * var), 2.7, 0.05);
+	ASSERT_NEAR(static_cast<double>(above) / data.size(), 0.05, 0.01);
+}
+
+TEST(FramerTest, DitherIsReproducible) {
+	std::vector<short> audio(16000);
+	unsigned int seed = 3;
+	for (auto& e : audio)
+		e = rand_r(&seed) % 2000 - 1000;
+	snowboy::Vector input;
+	input.Resize(audio.size());
+	for (size_t i = 0; i < audio.size(); i++)
+		input[i] = audio[i];
+
+	snowboy::FramerStream a{dither_options(7)}, b{dither_options(7)}, c{dither_options(8)};
+	snowboy::Matrix ma, mb, mc, ma2;
+	a.CreateFrames(input, &ma);
+	b.CreateFrames(input, &mb);
+	c.CreateFrames(input, &mc);
+	a.Reset();
+	a.CreateFrames(input, &ma2);
+	ASSERT_EQ(ma.rows(), mb.rows());
+	bool differs = false;
+	for (size_t r = 0; r < ma.rows(); r++) {
+		for (size_t col = 0; col < ma.cols(); col++) {
+			ASSERT_EQ(ma(r, col), mb(r, col));
+			ASSERT_EQ(ma(r, col), ma2(r, col));
+			differs |= ma(r, col) != mc(r, col);
+		}
+	}
+	ASSERT_TRUE(differs);
+	// The noise continues over calls instead of repeating
+	snowboy::Matrix again;
+	b.CreateFrames(input, &again);
+	ASSERT_NE(again(0, 0), mb(0, 0));
+}
+
+TEST(FramerTest, DitherSpeed) {
+	const size_t len = 400 * 100 * 60;
+	std::vector<float> data(len, 0.0f);
+	auto start = std::chrono::steady_clock::now();
+	{
+		// What CreateFrames used to do: Kaldi's RandGauss with Box-Muller
+		std::mt19937 gen;
+		std::uniform_real_distribution<float> dist;
+		for (size_t i = 0; i < len; i++)
+			data[i] += sqrt(-2 * std::log(dist(gen))) * cos(2 * M_PI * dist(gen));
+	}
+	auto mid = std::chrono::steady_clock::now();
+	snowboy::DitherGenerator gen;
+	gen.Seed(0);
+	gen.AddNoise(data.data(), len, 1.0f);
+	auto end = std::chrono::steady_clock::now();
+	GTEST_WARN("dithering one minute of 25 ms frames: Box-Muller %.2f ms, generator %.2f ms",
+			   std::chrono::duration<double, std::milli>(mid - start).count(), std::chrono::duration<double, std::milli>(end - mid).count());
+}
+
+// The separate passes CreateFrames used to make over every frame
+static void reference_frames(const snowboy::FramerStream& framer, const snowboy::Vector& data, snowboy::Matrix* mat) {
+	const auto len = framer.m_frame_length_samples;
+	const auto nframes = framer.NumFrames(data.size());
+	mat->Resize(nframes, len);
+	for (size_t f = 0; f < nframes; f++) {
+		snowboy::SubVector sub{*mat, f};
+		sub.CopyFromVec(data.Range(framer.m_frame_shift_samples * f, len));
+		if (framer.m_options.subtract_mean) sub.Add(-sub.Sum() / sub.size());
+		auto p = sub.data();
+		for (size_t i = len - 1; i > 0; i--)
+			p[i] -= framer.m_options.preemphasis_coeff * p[i - 1];
+		p[0] -= framer.m_options.preemphasis_coeff * p[0];
+		sub.MulElements(framer.m_window);
+	}
+}
+
+TEST(FramerTest, FusedFramingMatchesPasses) {
+	auto options = dither_options(0);
+	options.dither_coeff = 0.0f;
+	options.preemphasis_coeff = 0.97f;
+	options.subtract_mean = true;
+	options.window_type = "povey";
+	const size_t len = 16000 * 60;
+	snowboy::Vector input;
+	input.Resize(len);
+	unsigned int seed = 11;
+	for (size_t i = 0; i < len; i++)
+		input[i] = static_cast<float>(rand_r(&seed) % 20000 - 10000);
+
+	snowboy::FramerStream framer{options};
+	snowboy::Matrix expected, fused;
+	// Both run once untimed, so the timed runs write into warm output memory
+	reference_frames(framer, input, &expected);
+	framer.CreateFrames(input, &fused);
+	auto start = std::chrono::steady_clock::now();
+	reference_frames(framer, input, &expected);
+	auto mid = std::chrono::steady_clock::now();
+	framer.CreateFrames(input, &fused);
+	auto end = std::chrono::steady_clock::now();
+	ASSERT_EQ(expected.rows(), fused.rows());
+	ASSERT_EQ(expected.cols(), fused.cols());
+	for (size_t r = 0; r < expected.rows(); r++) {
+		for (size_t c = 0; c < expected.cols(); c++)
+			ASSERT_EQ(expected(r, c), fused(r, c)) << r << "," << c;
+	}
+	// The samples after the last frame stay buffered for the next call
+	ASSERT_EQ(framer.field_x40.size(), len - fused.rows() * framer.m_frame_shift_samples);
+	ASSERT_EQ(framer.field_x40[0], input[fused.rows() * framer.m_frame_shift_samples]);
+	GTEST_WARN("framing one minute of audio: separate passes %.2f ms, fused %.2f ms",
+			   std::chrono::duration<double, std::milli>(mid - start).count(), std::chrono::duration<double, std::milli>(end - mid).count());
+}
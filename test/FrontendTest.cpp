@@ -0,0 +1,220 @@
+#include <agc.h>
+#include <chrono>
+#include <cmath>
+#include <frontend-lib.h>
+#include <helper.h>
+#include <ns3.h>
+#include <snowboy-detect.h>
+
+const static auto root = detect_project_root();
+
+static std::vector<short> white_noise(size_t len, int amplitude, unsigned int* seed) {
+	std::vector<short> res(len);
+	for (auto& e : res)
+		e = static_cast<short>(static_cast<int>(rand_r(seed) % (2 * amplitude + 1)) - amplitude);
+	return res;
+}
+
+// 1 kHz tone, switched on and off every `period` samples like syllables
+static std::vector<short> tone_bursts(size_t len, int amplitude, size_t period) {
+	std::vector<short> res(len);
+	for (size_t i = 0; i < len; i++)
+		res[i] = (i / period) % 2 == 0 ? static_cast<short>(amplitude * sin(2 * M_PI * 1000 * i / 16000.0)) : 0;
+	return res;
+}
+
+static double energy(const short* data, size_t len) {
+	double res = 0;
+	for (size_t i = 0; i < len; i++)
+		res += static_cast<double>(data[i]) * data[i];
+	return res;
+}
+
+static std::vector<short> run_ns(const std::vector<short>& in, const char* ns_power, const char* dr_power) {
+	int status = 0;
+	auto ns = NS3_Init(16000, 160, &status);
+	EXPECT_EQ(status, 1);
+	EXPECT_EQ(NS3_SetPara(ns, "NS_Power", ns_power), 1);
+	EXPECT_EQ(NS3_SetPara(ns, "DR_Power", dr_power), 1);
+	std::vector<short> out(in.size());
+	for (size_t i = 0; i + 160 <= in.size(); i += 160)
+		NS3_Process(ns, &in[i], &out[i]);
+	NS3_Exit(ns);
+	return out;
+}
+
+static std::vector<short> run_agc(const std::vector<short>& in, const char* level, const char* power) {
+	int status = 0;
+	auto agc = AGC_Init(16000, 160, 1, &status);
+	EXPECT_EQ(status, 1);
+	EXPECT_EQ(AGC_SetPara(agc, "AGC_Level", level), 1);
+	EXPECT_EQ(AGC_SetPara(agc, "AGC_Power", power), 1);
+	std::vector<short> out(in.size());
+	for (size_t i = 0; i + 160 <= in.size(); i += 160)
+		AGC_Process(agc, &in[i], &out[i]);
+	AGC_Exit(agc);
+	return out;
+}
+
+TEST(FrontendTest, VectorHelpers) {
+	// Odd lengths cover the vector loops and the scalar tails
+	unsigned int seed = 7;
+	const size_t len = 77;
+	auto a = white_noise(len, 32767, &seed);
+	auto b = white_noise(len, 32767, &seed);
+	a[3] = -32768;
+	b[3] = -32768;
+	a[5] = 32767;
+	b[5] = 32767;
+	for (int shift : {12, 15}) {
+		std::vector<short> out(len);
+		TSpl_ScaleVectorW16(a.data(), b.data(), out.data(), len, shift);
+		for (size_t i = 0; i < len; i++)
+			ASSERT_EQ(out[i], TSpl_SatW32ToW16((a[i] * b[i]) >> shift)) << i;
+	}
+	std::vector<short> sum(len);
+	TSpl_AddSatVectorW16(a.data(), b.data(), sum.data(), len);
+	for (size_t i = 0; i < len; i++)
+		ASSERT_EQ(sum[i], TSpl_SatW32ToW16(a[i] + b[i])) << i;
+	std::vector<uint32_t> magn(len / 2);
+	TSpl_ComplexSquaredMagnitude(a.data(), magn.data(), len / 2);
+	for (size_t k = 0; k < len / 2; k++)
+		ASSERT_EQ(magn[k], static_cast<uint32_t>(a[2 * k] * a[2 * k]) + static_cast<uint32_t>(a[2 * k + 1] * a[2 * k + 1])) << k;
+	for (size_t n = 0; n <= len; n++) {
+		int max = 0;
+		for (size_t i = 0; i < n; i++)
+			max = std::max(max, std::min(32767, std::abs(a[i])));
+		ASSERT_EQ(TSpl_MaxAbsValueW16(a.data(), n), max) << n;
+	}
+	for (uint32_t v : {0u, 1u, 2u, 3u, 4u, 99u, 100u, 65535u, 65536u, 4294967295u, 2147483648u}) {
+		auto r = TSpl_SqrtFloor(v);
+		ASSERT_LE(static_cast<uint64_t>(r) * r, v);
+		ASSERT_GT((static_cast<uint64_t>(r) + 1) * (r + 1), v);
+	}
+}
+
+TEST(FrontendTest, NoiseSuppression) {
+	unsigned int seed = 11;
+	const size_t len = 16000 * 6, tail = 16000 * 2;
+	auto noise = white_noise(len, 600, &seed);
+
+	// Stationary noise ends up close to the gain floor of the policy (-12 dB for NS_Power 1)
+	auto out = run_ns(noise, "1", "0");
+	auto reduction = 10 * log10(energy(&out[len - tail], tail) / energy(&noise[len - tail], tail));
+	ASSERT_LT(reduction, -6.0);
+
+	// Bursts well above the noise pass mostly unchanged, the output is delayed by 96 samples
+	auto bursts = tone_bursts(len, 8000, 4800);
+	std::vector<short> noisy(len);
+	for (size_t i = 0; i < len; i++)
+		noisy[i] = bursts[i] + noise[i];
+	out = run_ns(noisy, "1", "0");
+	const size_t burst = len - 2 * 4800;
+	auto change = 10 * log10(energy(&out[burst + 96 + 480], 3840) / energy(&bursts[burst + 480], 3840));
+	ASSERT_GT(change, -1.5);
+	ASSERT_LT(change, 1.0);
+	// The gaps between the bursts are suppressed like the noise
+	auto gap = 10 * log10(energy(&out[burst + 4800 + 96 + 960], 2880) / energy(&noise[burst + 4800 + 960], 2880));
+	ASSERT_LT(gap, -6.0);
+
+	GTEST_WARN("noise %.1f dB, bursts %.1f dB, gaps %.1f dB", reduction, change, gap);
+
+	// Dereverberation only ever lowers the gains
+	auto dereverb = run_ns(noisy, "1", "3");
+	ASSERT_LE(energy(&dereverb[len - tail], tail), energy(&out[len - tail], tail));
+
+	int status = 0;
+	ASSERT_EQ(NS3_Init(44100, 441, &status), nullptr);
+	ASSERT_NE(status, 1);
+	auto ns = NS3_Init(16000, 160, &status);
+	ASSERT_EQ(NS3_SetPara(ns, "NS_Power", "4"), 4);
+	ASSERT_EQ(NS3_SetPara(ns, "Unknown", "1"), 4);
+	NS3_Exit(ns);
+}
+
+TEST(FrontendTest, AutomaticGainControl) {
+	const size_t len = 16000 * 4, tail = 16000;
+	// A quiet signal gets the full compression gain (12 dB)
+	auto quiet = tone_bursts(len, 300, len);
+	auto out = run_agc(quiet, "2", "12");
+	auto gain = 10 * log10(energy(&out[len - tail], tail) / energy(&quiet[len - tail], tail));
+	ASSERT_NEAR(gain, 12.0, 1.0);
+
+	// A loud one is brought down to the target level (-2 dBFS)
+	auto loud = tone_bursts(len, 32000, len);
+	out = run_agc(loud, "2", "12");
+	short peak = 0;
+	for (size_t i = len - tail; i < len; i++)
+		peak = std::max<short>(peak, std::abs(out[i]));
+	ASSERT_NEAR(20 * log10(peak / 32768.0), -2.0, 1.0);
+
+	// Silence stays silent
+	std::vector<short> silence(len, 0);
+	out = run_agc(silence, "2", "12");
+	ASSERT_EQ(energy(out.data(), len), 0);
+
+	int status = 0;
+	auto agc = AGC_Init(16000, 160, 1, &status);
+	ASSERT_EQ(AGC_SetPara(agc, "AGC_Power", "30"), 4);
+	AGC_Exit(agc);
+}
+
+TEST(FrontendTest, DetectsWithFrontend) {
+	if (!file_exists(root + "audio_samples/snowboy.wav")) {
+		GTEST_WARN("Skiping because audio file is missing!");
+		return;
+	}
+	auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+	unsigned int seed = 3;
+	auto noise = white_noise(data.size(), 300, &seed);
+	for (auto noisy : {false, true}) {
+		snowboy::SnowboyDetect detector(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+		detector.SetSensitivity("0.5");
+		detector.ApplyFrontend(true);
+		int detections = 0;
+		for (size_t i = 0; i < data.size(); i += 1600) {
+			std::vector<short> chunk(data.begin() + i, data.begin() + std::min(data.size(), i + 1600));
+			if (noisy) {
+				for (size_t j = 0; j < chunk.size(); j++)
+					chunk[j] = TSpl_SatW32ToW16(chunk[j] + noise[i + j]);
+			}
+			if (detector.RunDetection(chunk.data(), chunk.size()) > 0) detections++;
+		}
+		GTEST_WARN("%s: %d detections with the frontend", noisy ? "with noise" : "clean", detections);
+		ASSERT_GT(detections, 0);
+	}
+}
+
+TEST(FrontendTest, BlockCpuBudget) {
+	unsigned int seed = 5;
+	const size_t len = 16000 * 30;
+	auto audio = tone_bursts(len, 8000, 4800);
+	auto noise = white_noise(len, 600, &seed);
+	for (size_t i = 0; i < len; i++)
+		audio[i] += noise[i];
+
+	int status = 0;
+	auto ns = NS3_Init(16000, 160, &status);
+	NS3_SetPara(ns, "NS_Power", "1");
+	NS3_SetPara(ns, "DR_Power", "1");
+	auto agc = AGC_Init(16000, 160, 1, &status);
+	AGC_SetPara(agc, "AGC_Level", "2");
+	AGC_SetPara(agc, "AGC_Power", "12");
+	std::chrono::nanoseconds time_ns{0}, time_agc{0};
+	for (size_t i = 0; i + 160 <= len; i += 160) {
+		auto start = std::chrono::steady_clock::now();
+		NS3_Process(ns, &audio[i], &audio[i]);
+		auto mid = std::chrono::steady_clock::now();
+		AGC_Process(agc, &audio[i], &audio[i]);
+		time_ns += mid - start;
+		time_agc += std::chrono::steady_clock::now() - mid;
+	}
+	NS3_Exit(ns);
+	AGC_Exit(agc);
+	const size_t blocks = len / 160;
+	auto us_ns = std::chrono::duration<double, std::micro>(time_ns).count() / blocks;
+	auto us_agc = std::chrono::duration<double, std::micro>(time_agc).count() / blocks;
+	GTEST_WARN("per 10 ms block: NS %.2f us, AGC %.2f us, %.2f%% of real time", us_ns, us_agc, (us_ns + us_agc) / 100);
+	// Far below real time even on slow machines, the frontend has to run next to the network
+	ASSERT_LT(us_ns + us_agc, 2000);
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cmath>
+#include <gain-control-stream.h>
+#include <helper.h>
+#include <intercept-stream.h>
+#include <matrix-wrapper.h>
+
+// The per sample loop GainControlStream::Read used to run
+static float reference_gain(float x, float gain, float amp) {
+	auto v = x / amp * gain;
+	if (v >= 1.0)
+		v = 1.0;
+	else if (v <= -1.0)
+		v = -1.0;
+	else
+		v = v * 1.5 - v * v * 0.5 * v;
+	return v * amp;
+}
+
+TEST(GainControlTest, MatchesScalarClipper) {
+	snowboy::GainControlStreamOptions options;
+	options.m_audioGain = 2.5f;
+	snowboy::GainControlStream gain{options};
+	std::vector<float> data(16003);
+	unsigned int seed = 9;
+	for (auto& e : data)
+		e = static_cast<float>(static_cast<int>(rand_r(&seed) % 65536) - 32768);
+	auto expected = data;
+	for (auto& e : expected)
+		e = reference_gain(e, 2.5f, 32767.0f);
+	gain.Process(data.data(), data.size());
+	for (size_t i = 0; i < data.size(); i++)
+		ASSERT_NEAR(data[i], expected[i], 0.01f) << i;
+	// Clipped samples land exactly on the amplitude
+	float x[] = {40000.0f, -40000.0f, 32767.0f, -32767.0f, 0.0f};
+	gain.Process(x, 5);
+	ASSERT_EQ(x[0], 32767.0f);
+	ASSERT_EQ(x[1], -32767.0f);
+	ASSERT_EQ(x[4], 0.0f);
+}
+
+TEST(GainControlTest, ProcessesEveryRow) {
+	snowboy::GainControlStreamOptions options;
+	options.m_audioGain = 2.0f;
+	snowboy::GainControlStream gain{options};
+	snowboy::InterceptStream intercept;
+	gain.Connect(&intercept);
+	snowboy::Matrix mat;
+	mat.Resize(2, 5);
+	for (size_t r = 0; r < mat.rows(); r++) {
+		for (size_t c = 0; c < mat.cols(); c++)
+			mat(r, c) = 1000.0f * (r + c);
+	}
+	intercept.SetData(mat, std::vector<snowboy::FrameInfo>(2), static_cast<snowboy::SnowboySignal>(0x20));
+	snowboy::Matrix out;
+	std::vector<snowboy::FrameInfo> info;
+	gain.Read(&out, &info);
+	ASSERT_EQ(out.rows(), 2);
+	for (size_t r = 0; r < out.rows(); r++) {
+		for (size_t c = 0; c < out.cols(); c++)
+			ASSERT_NEAR(out(r, c), reference_gain(mat(r, c), 2.0f, 32767.0f), 0.01f);
+	}
+}
+
+TEST(GainControlTest, ClipperSpeed) {
+	const size_t len = 16000 * 60;
+	std::vector<float> data(len), ref(len);
+	unsigned int seed = 4;
+	for (auto& e : data)
+		e = static_cast<float>(static_cast<int>(rand_r(&seed) % 65536) - 32768);
+	ref = data;
+	snowboy::GainControlStreamOptions options;
+	options.m_audioGain = 1.5f;
+	snowboy::GainControlStream gain{options};
+	auto start = std::chrono::steady_clock::now();
+	for (auto& e : ref)
+		e = reference_gain(e, 1.5f, 32767.0f);
+	auto mid = std::chrono::steady_clock::now();
+	gain.Process(data.data(), len);
+	auto end = std::chrono::steady_clock::now();
+	ASSERT_NEAR(data[len / 2], ref[len / 2], 0.01f);
+	GTEST_WARN("gain on one minute of audio: scalar %.2f ms, vectorized %.2f ms",
+			   std::chrono::duration<double, std::milli>(mid - start).count(), std::chrono::duration<double, std::milli>(end - mid).count());
+}
@@ -0,0 +1,291 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <helper.h>
+#include <matrix-wrapper.h>
+#include <nnet-lib.h>
+#include <pipeline-lib.h>
+#include <snowboy-detect.h>
+#include <snowboy-error.h>
+#include <snowboy-io.h>
+#include <sys/stat.h>
+#include <thread>
+#include <vector-wrapper.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+const static auto root = detect_project_root();
+
+// A container holding `m` and `v` as aligned blobs
+static std::string aligned_container(const snowboy::Matrix& m, const snowboy::Vector& v) {
+	snowboy::ModelContainerHeader header{};
+	memcpy(header.magic, snowboy::global_snowboy_container_magic, sizeof(header.magic));
+	header.version = snowboy::kModelContainerVersion;
+	header.header_size = sizeof(header);
+	std::stringstream ss;
+	ss.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m.WriteAligned(&ss);
+	v.WriteAligned(&ss);
+	auto data = ss.str();
+	header.payload_size = data.size() - sizeof(header);
+	memcpy(&data[0], &header, sizeof(header));
+	return data;
+}
+
+TEST(ModelContainerTest, AlignedMatrixIsMapped) {
+	unsigned int seed = 5;
+	auto m = random_matrix(&seed);
+	snowboy::Vector v;
+	v.Resize(13);
+	for (size_t i = 0; i < v.size(); i++)
+		v[i] = i * 0.5f;
+	{
+		auto data = aligned_container(m, v);
+		std::ofstream out{"temp_aligned.bin", std::ios::binary | std::ios::trunc};
+		out.write(data.data(), data.size());
+	}
+	snowboy::Matrix m2;
+	snowboy::Vector v2;
+	{
+		snowboy::Input in{"temp_aligned.bin"};
+		ASSERT_TRUE(in.is_binary());
+		ASSERT_TRUE(in.is_container());
+		m2.Read(true, in.Stream());
+		v2.Read(true, in.Stream());
+	}
+	// The input is gone, the data has to be kept alive by the matrix and vector
+	ASSERT_NE(m2.m_mapping, nullptr);
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(m2.data()) % snowboy::kModelBlobAlignment, 0);
+	ASSERT_EQ(reinterpret_cast<uintptr_t>(v2.data()) % snowboy::kModelBlobAlignment, 0);
+	ASSERT_EQ(m.rows(), m2.rows());
+	ASSERT_EQ(m.cols(), m2.cols());
+	for (size_t r = 0; r < m.rows(); r++) {
+		for (size_t c = 0; c < m.cols(); c++)
+			ASSERT_EQ(m(r, c), m2(r, c));
+	}
+	ASSERT_EQ(v.size(), v2.size());
+	for (size_t i = 0; i < v.size(); i++)
+		ASSERT_EQ(v[i], v2[i]);
+
+	// Modifying a mapped matrix must not touch the file
+	auto copy = m2;
+	m2.Scale(2.0f);
+	snowboy::Input in{"temp_aligned.bin"};
+	snowboy::Matrix m3;
+	m3.Read(true, in.Stream());
+	ASSERT_EQ(m3(0, 0), copy(0, 0));
+}
+
+TEST(ModelContainerTest, ReadsPipes) {
+#ifdef _WIN32
+	GTEST_SKIP() << "no named pipes";
+#else
+	unsigned int seed = 8;
+	auto m = random_matrix(&seed);
+	snowboy::Vector v;
+	v.Resize(21);
+	for (size_t i = 0; i < v.size(); i++)
+		v[i] = i * 0.25f;
+	std::stringstream binary, text;
+	binary.put(0x00);
+	binary.put('B');
+	m.Write(true, &binary);
+	v.Write(true, &binary);
+	m.Write(false, &text);
+	v.Write(false, &text);
+
+	std::remove("temp_pipe");
+	ASSERT_EQ(mkfifo("temp_pipe", 0600), 0);
+	for (auto& data : {binary.str(), text.str(), aligned_container(m, v)}) {
+		std::thread writer{[&]() {
+			std::ofstream out{"temp_pipe", std::ios::binary};
+			out.write(data.data(), data.size());
+		}};
+		snowboy::Matrix m2;
+		snowboy::Vector v2;
+		{
+			snowboy::Input in{"temp_pipe"};
+			m2.Read(in.is_binary(), in.Stream());
+			v2.Read(in.is_binary(), in.Stream());
+		}
+		writer.join();
+		ASSERT_EQ(m2.m_mapping, nullptr);
+		ASSERT_EQ(m.rows(), m2.rows());
+		ASSERT_EQ(m.cols(), m2.cols());
+		for (size_t r = 0; r < m.rows(); r++) {
+			for (size_t c = 0; c < m.cols(); c++)
+				ASSERT_EQ(m(r, c), m2(r, c));
+		}
+		ASSERT_EQ(v.size(), v2.size());
+		for (size_t i = 0; i < v.size(); i++)
+			ASSERT_EQ(v[i], v2[i]);
+	}
+	ASSERT_EQ(snowboy::PinMappedFile("temp_pipe"), nullptr);
+	ASSERT_EQ(snowboy::ModelCachePath("temp_pipe"), "");
+	std::remove("temp_pipe");
+#endif
+}
+
+TEST(ModelContainerTest, ConvertedModelsDetectIdentically) {
+	snowboy::ConvertToModelContainer(root + "resources/common.res", "temp_common.snowmdl");
+	snowboy::ConvertToModelContainer(root + "resources/models/snowboy.umdl", "temp_snowboy.snowmdl");
+	snowboy::ConvertToModelContainer(root + "resources/pmdl/hey_casper.pmdl", "temp_hey_casper.snowmdl");
+	ASSERT_THROW(snowboy::ConvertToModelContainer("temp_snowboy.snowmdl", "temp_twice.snowmdl"), snowboy::snowboy_exception);
+
+	const std::string models = root + "resources/models/snowboy.umdl," + root + "resources/pmdl/hey_casper.pmdl";
+	const std::string converted = "temp_snowboy.snowmdl,temp_hey_casper.snowmdl";
+	std::chrono::nanoseconds time_original{0}, time_converted{0};
+	for (auto& e : {"hotword1.wav", "hotword3_fail.wav", "noise1.wav", "sample1.wav", "snowboy.wav"}) {
+		if (!file_exists(root + "audio_samples/" + e)) {
+			GTEST_WARN("Skiping %s because audio file is missing!", e);
+			continue;
+		}
+		auto data = read_sample_file(root + "audio_samples/" + e);
+		auto start = std::chrono::steady_clock::now();
+		snowboy::SnowboyDetect original(root + "resources/common.res", models);
+		auto mid = std::chrono::steady_clock::now();
+		snowboy::SnowboyDetect container("temp_common.snowmdl", converted);
+		time_original += mid - start;
+		time_converted += std::chrono::steady_clock::now() - mid;
+		for (auto detector : {&original, &container}) {
+			detector->SetSensitivity("0.5,0.45");
+			detector->SetAudioGain(1.0);
+			detector->ApplyFrontend(false);
+		}
+		const size_t chunksize = 1600;
+		for (size_t i = 0; i < data.size(); i += chunksize) {
+			auto len = std::min<size_t>(chunksize, data.size() - i);
+			ASSERT_EQ(original.RunDetection(data.data() + i, len), container.RunDetection(data.data() + i, len))
+				<< e << " at sample " << i;
+		}
+	}
+	GTEST_WARN("detector construction: original %.2f ms, container %.2f ms",
+			   std::chrono::duration<double, std::milli>(time_original).count() / 5,
+			   std::chrono::duration<double, std::milli>(time_converted).count() / 5);
+}
+
+TEST(ModelContainerTest, UpdateContainerModel) {
+	const auto resource = root + "resources/common.res";
+	snowboy::ConvertToModelContainer(root + "resources/models/snowboy.umdl", "temp_update.snowmdl");
+	snowboy::ConvertToModelContainer(root + "resources/pmdl/hey_casper.pmdl", "temp_update_personal.snowmdl");
+	const std::string models = "temp_update.snowmdl,temp_update_personal.snowmdl";
+	snowboy::SnowboyDetect original(resource, models);
+	// The weights of the detector point into the files that are rewritten here
+	original.UpdateModel();
+	snowboy::SnowboyDetect reloaded(resource, models);
+	ASSERT_FALSE(snowboy::Input{"temp_update.snowmdl"}.is_container());
+	ASSERT_EQ(reloaded.NumHotwords(), original.NumHotwords());
+	ASSERT_EQ(reloaded.GetSensitivity(), original.GetSensitivity());
+
+	if (file_exists(root + "audio_samples/snowboy.wav")) {
+		auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+		const size_t chunksize = 1600;
+		int detected = 0;
+		for (size_t i = 0; i < data.size(); i += chunksize) {
+			auto len = std::min<size_t>(chunksize, data.size() - i);
+			auto expected = original.RunDetection(data.data() + i, len);
+			ASSERT_EQ(expected, reloaded.RunDetection(data.data() + i, len)) << "at sample " << i;
+			detected = std::max(detected, expected);
+		}
+		ASSERT_GT(detected, 0);
+	}
+	// Output that is not closed leaves the previous file in place
+	{
+		snowboy::Output out{"temp_update.snowmdl", true};
+		*out.Stream() << "partial";
+	}
+	snowboy::SnowboyDetect after_failure(resource, models);
+	ASSERT_EQ(after_failure.NumHotwords(), original.NumHotwords());
+}
+
+// Loads every model embedded in the resource the way the pipeline streams do
+static void load_resource_models(const std::string& resource) {
+	std::string options;
+	snowboy::UnpackPipelineResource(resource, &options);
+	std::vector<std::string> parts;
+	snowboy::SplitStringToVector(options, snowboy::global_snowboy_whitespace_set, &parts);
+	for (auto& opt : parts) {
+		auto pos = opt.find("filename=");
+		if (pos == std::string::npos) continue;
+		snowboy::Input in{opt.substr(pos + 9)};
+		snowboy::Nnet nnet;
+		nnet.Read(in.is_binary(), in.Stream());
+	}
+}
+
+TEST(ModelContainerTest, ResourceIsMappedOnce) {
+	const auto resource = root + "resources/common.res";
+	const auto model = root + "resources/models/snowboy.umdl";
+	const size_t iterations = 20;
+	auto model_pin = snowboy::PinMappedFile(model);
+
+	std::chrono::nanoseconds time_detector{0}, time_reopen{0}, time_pinned{0};
+	for (size_t i = 0; i < iterations; i++) {
+		snowboy::MappedFile::ResetNumMappings();
+		auto start = std::chrono::steady_clock::now();
+		snowboy::SnowboyDetect detector(resource, model);
+		time_detector += std::chrono::steady_clock::now() - start;
+		// The model is pinned by the test, so the only new mapping is the resource
+		ASSERT_EQ(snowboy::MappedFile::NumMappings(), 1);
+	}
+	for (size_t i = 0; i < iterations; i++) {
+		snowboy::MappedFile::ResetNumMappings();
+		auto start = std::chrono::steady_clock::now();
+		load_resource_models(resource);
+		auto mid = std::chrono::steady_clock::now();
+		ASSERT_GT(snowboy::MappedFile::NumMappings(), 1);
+		snowboy::MappedFile::ResetNumMappings();
+		auto pin = snowboy::PinMappedFile(resource);
+		load_resource_models(resource);
+		time_reopen += mid - start;
+		time_pinned += std::chrono::steady_clock::now() - mid;
+		ASSERT_EQ(snowboy::MappedFile::NumMappings(), 1);
+	}
+	GTEST_WARN("detector construction %.2f ms, resource models reopened per stream %.2f ms, pinned %.2f ms",
+			   std::chrono::duration<double, std::milli>(time_detector).count() / iterations,
+			   std::chrono::duration<double, std::milli>(time_reopen).count() / iterations,
+			   std::chrono::duration<double, std::milli>(time_pinned).count() / iterations);
+}
+
+TEST(ModelContainerTest, ModelCache) {
+	const auto resource = root + "resources/common.res";
+	const auto models = root + "resources/models/snowboy.umdl," + root + "resources/pmdl/hey_casper.pmdl";
+#ifdef _WIN32
+	_mkdir("temp_model_cache");
+#else
+	mkdir("temp_model_cache", 0755);
+#endif
+	snowboy::SnowboyDetect::SetModelCacheDirectory("temp_model_cache");
+	for (auto& e : {resource, root + "resources/models/snowboy.umdl"})
+		std::remove(snowboy::ModelCachePath(e).c_str());
+
+	std::chrono::nanoseconds time_cold{0}, time_cached{0};
+	auto start = std::chrono::steady_clock::now();
+	snowboy::SnowboyDetect cold(resource, models);
+	time_cold = std::chrono::steady_clock::now() - start;
+	for (auto& e : {resource, root + "resources/models/snowboy.umdl", root + "resources/pmdl/hey_casper.pmdl"}) {
+		auto cached = snowboy::ResolveModelFile(e);
+		ASSERT_NE(cached, e) << e;
+		ASSERT_TRUE(snowboy::Input{cached}.is_container());
+	}
+	start = std::chrono::steady_clock::now();
+	snowboy::SnowboyDetect cached(resource, models);
+	time_cached = std::chrono::steady_clock::now() - start;
+	snowboy::SnowboyDetect::SetModelCacheDirectory("");
+	snowboy::SnowboyDetect uncached(resource, models);
+
+	if (file_exists(root + "audio_samples/snowboy.wav")) {
+		auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+		const size_t chunksize = 1600;
+		for (size_t i = 0; i < data.size(); i += chunksize) {
+			auto len = std::min<size_t>(chunksize, data.size() - i);
+			auto expected = uncached.RunDetection(data.data() + i, len);
+			ASSERT_EQ(expected, cold.RunDetection(data.data() + i, len)) << "at sample " << i;
+			ASSERT_EQ(expected, cached.RunDetection(data.data() + i, len)) << "at sample " << i;
+		}
+	}
+	GTEST_WARN("detector construction: populating cache %.2f ms, from cache %.2f ms",
+			   std::chrono::duration<double, std::milli>(time_cold).count(),
+			   std::chrono::duration<double, std::milli>(time_cached).count());
+}
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <deque>
+#include <frame-info.h>
+#include <helper.h>
+#include <intercept-stream.h>
+#include <limits>
+#include <matrix-wrapper.h>
+#include <raw-energy-vad-stream.h>
+#include <vector-wrapper.h>
+
+// The background energy bookkeeping as the original library did it, with deques erased from the front
+struct ReferenceBackground {
+	std::deque<std::pair<unsigned int, float>> raw;
+	std::deque<float> bg;
+	int sum = 0;
+	float bg_energy = 0;
+
+	void Read(const snowboy::MatrixBase& mat, const std::vector<snowboy::FrameInfo>& info, const snowboy::RawEnergyVadStreamOptions& options) {
+		for (size_t r = 0; r < mat.rows(); r++) {
+			auto dot = snowboy::SubVector{mat, r}.DotVec(snowboy::SubVector{mat, r});
+			raw.push_back({info[r].frame_id, logf(std::max(std::numeric_limits<float>::min(), dot))});
+		}
+		while (raw.size() > mat.rows() + options.raw_buffer_extra)
+			raw.pop_front();
+	}
+
+	void Update(const std::vector<snowboy::FrameInfo>& info, const snowboy::RawEnergyVadStreamOptions& options) {
+		if (info.empty()) return;
+		auto it = raw.begin();
+		while (!raw.empty()) {
+			if (info[0].frame_id <= it->first) {
+				for (size_t i = 0; i < info.size() && it != raw.end(); i++) {
+					if (info[i].frame_id == it->first) {
+						if ((info[i].flags & 1) == 0) bg.push_back(it->second);
+						it = raw.erase(it);
+					}
+				}
+				auto b = bg.begin();
+				while (options.bg_buffer_size < bg.size()) {
+					sum = sum - *b;
+					b = bg.erase(b);
+				}
+				if (options.bg_buffer_size != bg.size()) return;
+				bg_energy = std::min(sum / (float)options.bg_buffer_size, options.bg_energy_cap);
+				return;
+			}
+			it = raw.erase(it);
+		}
+	}
+};
+
+TEST(RawEnergyVadTest, BackgroundMatchesOriginal) {
+	for (uint32_t bg_buffer_size : {0u, 1u, 20u, 100u}) {
+		snowboy::RawEnergyVadStreamOptions options{false, 2.0f, 15.0f, bg_buffer_size, 10};
+		snowboy::RawEnergyVadStream stream{options};
+		snowboy::InterceptStream intercept;
+		stream.Connect(&intercept);
+		ReferenceBackground reference;
+		unsigned int seed = 9;
+		unsigned int frame_id = 1;
+		for (int chunk = 0; chunk < 300; chunk++) {
+			// Chunks of varying length, like the reads after the framer
+			snowboy::Matrix mat;
+			mat.Resize(rand_r(&seed) % 16, 40);
+			std::vector<snowboy::FrameInfo> info(mat.rows());
+			for (size_t r = 0; r < mat.rows(); r++) {
+				const int amplitude = 1 + rand_r(&seed) % 2000;
+				for (size_t c = 0; c < mat.cols(); c++)
+					mat(r, c) = static_cast<float>(static_cast<int>(rand_r(&seed) % (2 * amplitude + 1)) - amplitude);
+				info[r].frame_id = frame_id++;
+			}
+			reference.Read(mat, info, options);
+			intercept.SetData(mat, info, static_cast<snowboy::SnowboySignal>(0x20));
+			snowboy::Matrix out;
+			std::vector<snowboy::FrameInfo> out_info;
+			stream.Read(&out, &out_info);
+
+			// The frames coming out of the VAD network later, some of them lost or without their id
+			std::vector<snowboy::FrameInfo> vad_info;
+			for (unsigned int id = frame_id - std::min<unsigned int>(frame_id - 1, rand_r(&seed) % 30); id < frame_id; id++) {
+				if (rand_r(&seed) % 8 == 0) continue;
+				snowboy::FrameInfo e;
+				e.frame_id = rand_r(&seed) % 16 == 0 ? 0 : id;
+				e.flags = rand_r(&seed) % 3 == 0 ? 1 : 0;
+				vad_info.push_back(e);
+			}
+			reference.Update(vad_info, options);
+			stream.UpdateBackgroundEnergy(vad_info);
+			ASSERT_EQ(stream.field_x34, reference.sum) << "bg-buffer-size " << bg_buffer_size << " chunk " << chunk;
+			if (bg_buffer_size != 0) ASSERT_EQ(stream.m_bg_energy, reference.bg_energy) << "bg-buffer-size " << bg_buffer_size << " chunk " << chunk;
+		}
+		if (bg_buffer_size > 1) ASSERT_LT(reference.sum, 0);
+	}
+}
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cmath>
+#include <frame-info.h>
+#include <helper.h>
+#include <intercept-stream.h>
+#include <matrix-wrapper.h>
+#include <resample-stream.h>
+#include <snowboy-detect.h>
+
+const static auto root = detect_project_root();
+
+// Runs `input` through `stream` in chunks of `chunk` samples. The last one is marked as the end, or an empty chunk
+// after them with `empty_end`.
+static std::vector<float> resample(snowboy::ResampleStream* stream, const std::vector<float>& input, size_t chunk, bool empty_end = false) {
+	snowboy::InterceptStream intercept;
+	stream->Connect(&intercept);
+	std::vector<float> res;
+	auto read = [&](const snowboy::Matrix& mat, bool is_end) {
+		intercept.SetData(mat, std::vector<snowboy::FrameInfo>(1), static_cast<snowboy::SnowboySignal>(is_end ? 0x30 : 0x20));
+		snowboy::Matrix out;
+		std::vector<snowboy::FrameInfo> info;
+		stream->Read(&out, &info);
+		for (size_t c = 0; c < out.cols(); c++)
+			res.push_back(out(0, c));
+	};
+	for (size_t i = 0; i < input.size(); i += chunk) {
+		auto len = std::min(chunk, input.size() - i);
+		snowboy::Matrix mat;
+		mat.Resize(1, len);
+		for (size_t c = 0; c < len; c++)
+			mat(0, c) = input[i + c];
+		read(mat, !empty_end && i + len == input.size());
+	}
+	if (empty_end) read(snowboy::Matrix{}, true);
+	return res;
+}
+
+static std::vector<float> resample(const std::vector<float>& input, int in_rate, int out_rate, size_t chunk) {
+	snowboy::ResampleStreamOptions options;
+	options.input_sample_rate = in_rate;
+	options.output_sample_rate = out_rate;
+	snowboy::ResampleStream stream{options};
+	return resample(&stream, input, chunk);
+}
+
+static std::vector<float> tone(double freq, int rate, size_t len) {
+	std::vector<float> res(len);
+	for (size_t i = 0; i < len; i++)
+		res[i] = static_cast<float>(10000 * sin(2 * M_PI * freq * i / rate));
+	return res;
+}
+
+// RMS of the difference to a 1 kHz tone at `rate`, leaving out the filter's ramp at both ends
+static double tone_error(const std::vector<float>& data, int rate) {
+	auto expected = tone(1000, rate, data.size());
+	double err = 0;
+	size_t n = 0;
+	for (size_t i = rate / 100; i + rate / 100 < data.size(); i++, n++)
+		err += (data[i] - expected[i]) * (data[i] - expected[i]);
+	return sqrt(err / n);
+}
+
+TEST(ResampleTest, ConvertsTones) {
+	for (int rate : {48000, 44100, 32000, 8000}) {
+		auto out = resample(tone(1000, rate, rate), rate, 16000, 1000);
+		// Every output sample up to the end of the input
+		ASSERT_EQ(out.size(), 16000) << rate;
+		// -60 dB relative to the tone
+		ASSERT_LT(tone_error(out, 16000), 10.0) << rate;
+	}
+}
+
+TEST(ResampleTest, RemovesAliases) {
+	// 12 kHz folds onto 4 kHz at 16 kHz unless it is filtered out
+	for (int rate : {48000, 44100}) {
+		auto out = resample(tone(12000, rate, rate), rate, 16000, 4800);
+		double energy = 0;
+		for (size_t i = 160; i + 160 < out.size(); i++)
+			energy += out[i] * out[i];
+		ASSERT_LT(10 * log10(energy / (out.size() - 320) / (10000.0 * 10000.0 / 2)), -40.0) << rate;
+	}
+}
+
+TEST(ResampleTest, ChunkingDoesNotMatter) {
+	std::vector<float> input(48000);
+	unsigned int seed = 6;
+	for (auto& e : input)
+		e = static_cast<float>(rand_r(&seed) % 20000) - 10000.0f;
+	for (int rate : {48000, 44100}) {
+		auto whole = resample(input, rate, 16000, input.size());
+		for (size_t chunk : {1, 160, 441, 4799}) {
+			auto chunked = resample(input, rate, 16000, chunk);
+			ASSERT_EQ(whole, chunked) << rate << " in chunks of " << chunk;
+		}
+	}
+}
+
+TEST(ResampleTest, EmptyEndFlushes) {
+	std::vector<float> input(4800);
+	unsigned int seed = 8;
+	for (auto& e : input)
+		e = static_cast<float>(rand_r(&seed) % 20000) - 10000.0f;
+	snowboy::ResampleStreamOptions options;
+	options.input_sample_rate = 44100;
+	options.output_sample_rate = 16000;
+	snowboy::ResampleStream stream{options};
+	auto expected = resample(input, 44100, 16000, 441);
+	// The empty end read passes on the filter tail and resets the stream for the next one
+	for (int i = 0; i < 2; i++)
+		ASSERT_EQ(resample(&stream, input, 441, true), expected) << "stream " << i;
+}
+
+TEST(ResampleTest, DetectsAt48kHz) {
+	if (!file_exists(root + "audio_samples/snowboy.wav")) {
+		GTEST_WARN("Skiping test because audio file is missing!");
+		return;
+	}
+	auto data = read_sample_file(root + "audio_samples/snowboy.wav");
+	std::vector<float> input(data.begin(), data.end());
+	auto upsampled = resample(input, 16000, 48000, input.size());
+	std::vector<short> audio_48k(upsampled.size());
+	for (size_t i = 0; i < upsampled.size(); i++)
+		audio_48k[i] = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, std::round(upsampled[i]))));
+
+	auto run = [](snowboy::SnowboyDetect& detector, const std::vector<short>& audio, size_t chunk, std::vector<int>* hits) {
+		std::chrono::nanoseconds time{0};
+		for (size_t i = 0; i < audio.size(); i += chunk) {
+			auto len = std::min(chunk, audio.size() - i);
+			auto start = std::chrono::steady_clock::now();
+			auto res = detector.RunDetection(audio.data() + i, len);
+			time += std::chrono::steady_clock::now() - start;
+			if (res > 0) hits->push_back(res);
+		}
+		return std::chrono::duration<double, std::milli>(time).count();
+	};
+	snowboy::SnowboyDetect detector16(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+	snowboy::SnowboyDetect detector48(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+	detector48.SetInputSampleRate(48000);
+	ASSERT_EQ(detector48.SampleRate(), 48000);
+	std::vector<int> hits16, hits48;
+	auto time16 = run(detector16, data, 1600, &hits16);
+	auto time48 = run(detector48, audio_48k, 4800, &hits48);
+	ASSERT_FALSE(hits16.empty());
+	ASSERT_EQ(hits16, hits48);
+
+	// The decimation alone
+	auto start = std::chrono::steady_clock::now();
+	resample(upsampled, 48000, 16000, 4800);
+	auto resample_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	GTEST_WARN("%.1f s of audio: detection at 16 kHz %.2f ms, at 48 kHz %.2f ms, 3:1 decimation alone %.2f ms", data.size() / 16000.0, time16,
+			   time48, resample_time);
+}
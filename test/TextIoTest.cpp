@@ -0,0 +1,212 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <frame-info.h>
+#include <helper.h>
+#include <matrix-wrapper.h>
+#include <nnet-lib.h>
+#include <pipeline-lib.h>
+#include <snowboy-error.h>
+#include <snowboy-io.h>
+#include <vector-wrapper.h>
+
+const static auto root = detect_project_root();
+
+// Random floats over the whole range, including subnormals and values with long decimal expansions
+static float random_float(unsigned int* seed) {
+	for (;;) {
+		uint32_t bits = (static_cast<uint32_t>(rand_r(seed)) << 16) ^ static_cast<uint32_t>(rand_r(seed));
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		if (std::isfinite(f)) return f;
+	}
+}
+
+static void expect_same_bits(float a, float b) {
+	ASSERT_EQ(memcmp(&a, &b, sizeof(a)), 0) << a << " v.s. " << b;
+}
+
+TEST(TextIoTest, FloatsRoundTrip) {
+	unsigned int seed = 17;
+	std::vector<float> values{0.0f, -0.0f, 1.0f, -1.0f, 0.1f, 1e-45f, 1.17549435e-38f, 3.40282347e+38f, 16777217.0f, 0.3f};
+	for (size_t i = 0; i < 200000; i++)
+		values.push_back(random_float(&seed));
+	std::stringstream ss;
+	snowboy::WriteTextValues(values.data(), values.size(), &ss);
+	// Also what other tools write: short, long and exponent notation
+	const char* extra = "1 -2.5 .5 5. 1e3 1E-3 +7 0.100000001490116119384765625 123456789012345678901234567890 3.4028235e38 1e-50 ";
+	ss << extra;
+	std::vector<float> expected = values;
+	for (auto e : {"1", "-2.5", ".5", "5.", "1e3", "1E-3", "+7", "0.100000001490116119384765625", "123456789012345678901234567890", "3.4028235e38", "1e-50"})
+		expected.push_back(strtof(e, nullptr));
+	std::stringstream block;
+	block << "[ " << ss.str() << "]";
+	std::vector<float> read;
+	snowboy::ReadTextBlock<float>(&block, &read, nullptr);
+	ASSERT_EQ(read.size(), expected.size());
+	for (size_t i = 0; i < read.size(); i++)
+		expect_same_bits(read[i], expected[i]);
+
+	std::stringstream bad{"[ 1 2x 3 ]"};
+	ASSERT_THROW(snowboy::ReadTextBlock<float>(&bad, &read, nullptr), snowboy::snowboy_exception);
+	std::stringstream open{"[ 1 2 3"};
+	ASSERT_THROW(snowboy::ReadTextBlock<float>(&open, &read, nullptr), snowboy::snowboy_exception);
+
+	// An exponent without digits at the very end of the mapping, a page long so reading past it faults
+	for (std::string e : {"1e", "-", "1e-"}) {
+		{
+			std::ofstream out{"temp_text_end.txt", std::ios::trunc};
+			out << std::string(4096 - e.size(), ' ') << e;
+		}
+		snowboy::Input in{"temp_text_end.txt"};
+		float f = 0;
+		ASSERT_THROW(snowboy::ReadBasicType<float>(false, &f, in.Stream()), snowboy::snowboy_exception) << e;
+		int i = 0;
+		snowboy::Input in2{"temp_text_end.txt"};
+		ASSERT_THROW(snowboy::ReadBasicType<int>(false, &i, in2.Stream()), snowboy::snowboy_exception) << e;
+	}
+}
+
+TEST(TextIoTest, MatrixVectorRoundTrip) {
+	unsigned int seed = 3;
+	snowboy::Matrix m;
+	m.Resize(37, 23);
+	for (size_t r = 0; r < m.rows(); r++) {
+		for (size_t c = 0; c < m.cols(); c++)
+			m(r, c) = random_float(&seed);
+	}
+	snowboy::Vector v;
+	v.Resize(41);
+	for (size_t i = 0; i < v.size(); i++)
+		v[i] = random_float(&seed);
+	std::vector<int> ints{0, -1, 5, 2147483647, -2147483647 - 1};
+	snowboy::Matrix empty;
+	{
+		std::ofstream out{"temp_text_io.txt", std::ios::trunc};
+		snowboy::WriteToken(false, "<M>", &out);
+		m.Write(false, &out);
+		v.Write(false, &out);
+		snowboy::WriteIntegerVector(false, ints, &out);
+		empty.Write(false, &out);
+		snowboy::WriteBasicType<float>(false, 0.25f, &out);
+	}
+	std::stringstream copy;
+	{
+		std::ifstream in{"temp_text_io.txt"};
+		copy << in.rdbuf();
+	}
+	// Once straight from the mapping, once through a regular stream
+	snowboy::Input in{"temp_text_io.txt"};
+	ASSERT_FALSE(in.is_binary());
+	for (auto is : {in.Stream(), static_cast<std::istream*>(&copy)}) {
+		snowboy::ExpectToken(false, "<M>", is);
+		snowboy::Matrix m2;
+		snowboy::Vector v2;
+		std::vector<int> ints2;
+		snowboy::Matrix empty2;
+		float f = 0;
+		m2.Read(false, is);
+		v2.Read(false, is);
+		snowboy::ReadIntegerVector(false, &ints2, is);
+		empty2.Read(false, is);
+		snowboy::ReadBasicType<float>(false, &f, is);
+		ASSERT_EQ(m2.rows(), m.rows());
+		ASSERT_EQ(m2.cols(), m.cols());
+		for (size_t r = 0; r < m.rows(); r++) {
+			for (size_t c = 0; c < m.cols(); c++)
+				expect_same_bits(m2(r, c), m(r, c));
+		}
+		ASSERT_EQ(v2.size(), v.size());
+		for (size_t i = 0; i < v.size(); i++)
+			expect_same_bits(v2[i], v[i]);
+		ASSERT_EQ(ints2, ints);
+		ASSERT_EQ(empty2.rows(), 0);
+		ASSERT_EQ(f, 0.25f);
+	}
+
+	std::stringstream ragged{" [\n  1 2 3\n  4 5 ]\n"};
+	snowboy::Matrix m3;
+	ASSERT_THROW(m3.Read(false, &ragged), snowboy::snowboy_exception);
+	std::stringstream add{" [ 1 2 3 ]\n"};
+	snowboy::Vector v3;
+	v3.Resize(3);
+	v3[0] = 1;
+	v3.Read(false, true, &add);
+	ASSERT_EQ(v3[0], 2);
+	ASSERT_EQ(v3[2], 3);
+}
+
+TEST(TextIoTest, TextModelLoadTime) {
+	// The largest network of the resource, written once in text mode
+	std::string options;
+	snowboy::UnpackPipelineResource(root + "resources/common.res", &options);
+	std::vector<std::string> parts;
+	snowboy::SplitStringToVector(options, snowboy::global_snowboy_whitespace_set, &parts);
+	snowboy::Nnet binary_nnet;
+	std::string binary_file;
+	size_t best_size = 0;
+	for (auto& opt : parts) {
+		auto pos = opt.find("filename=");
+		if (pos == std::string::npos) continue;
+		snowboy::Input in{opt.substr(pos + 9)};
+		snowboy::Nnet nnet;
+		nnet.Read(in.is_binary(), in.Stream());
+		std::stringstream ss;
+		nnet.Write(true, &ss);
+		if (ss.str().size() > best_size) {
+			best_size = ss.str().size();
+			binary_file = opt.substr(pos + 9);
+		}
+	}
+	ASSERT_FALSE(binary_file.empty());
+	{
+		snowboy::Input in{binary_file};
+		binary_nnet.Read(in.is_binary(), in.Stream());
+		std::ofstream out{"temp_text_nnet.txt", std::ios::trunc};
+		binary_nnet.Write(false, &out);
+	}
+
+	const size_t iterations = 10;
+	std::chrono::nanoseconds time_binary{0}, time_text{0};
+	snowboy::Nnet text_nnet;
+	for (size_t i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		{
+			snowboy::Input in{binary_file};
+			snowboy::Nnet nnet;
+			nnet.Read(in.is_binary(), in.Stream());
+		}
+		auto mid = std::chrono::steady_clock::now();
+		{
+			snowboy::Input in{"temp_text_nnet.txt"};
+			ASSERT_FALSE(in.is_binary());
+			text_nnet.Read(in.is_binary(), in.Stream());
+		}
+		time_binary += mid - start;
+		time_text += std::chrono::steady_clock::now() - mid;
+	}
+
+	// Both networks compute the same output
+	unsigned int seed = 9;
+	snowboy::Matrix input;
+	input.Resize(50, binary_nnet.InputDim());
+	for (size_t r = 0; r < input.rows(); r++) {
+		for (size_t c = 0; c < input.cols(); c++)
+			input(r, c) = (rand_r(&seed) % 2000) / 100.0f - 10.0f;
+	}
+	std::vector<snowboy::FrameInfo> info(input.rows());
+	snowboy::Matrix out_binary, out_text;
+	std::vector<snowboy::FrameInfo> info_binary, info_text;
+	binary_nnet.Compute(input, info, &out_binary, &info_binary);
+	text_nnet.Compute(input, info, &out_text, &info_text);
+	ASSERT_EQ(out_binary.rows(), out_text.rows());
+	ASSERT_EQ(out_binary.cols(), out_text.cols());
+	for (size_t r = 0; r < out_binary.rows(); r++) {
+		for (size_t c = 0; c < out_binary.cols(); c++)
+			ASSERT_EQ(out_binary(r, c), out_text(r, c));
+	}
+	GTEST_WARN("network of %zu bytes: binary load %.2f ms, text load %.2f ms (%.1fx)", best_size,
+			   std::chrono::duration<double, std::milli>(time_binary).count() / iterations,
+			   std::chrono::duration<double, std::milli>(time_text).count() / iterations, double(time_text.count()) / time_binary.count());
+}
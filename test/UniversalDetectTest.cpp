@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <frame-info.h>
+#include <frame-score-sink.h>
+#include <helper.h>
+#include <intercept-stream.h>
+#include <limits>
+#include <matrix-wrapper.h>
+#include <memory>
+#include <snowboy-detect.h>
+#include <snowboy-error.h>
+#include <universal-detect-stream.h>
+
+const static auto root = detect_project_root();
+
+static snowboy::UniversalDetectStreamOptions universal_options(const std::string& model) {
+	snowboy::UniversalDetectStreamOptions options;
+	options.slide_step = 1;
+	options.min_num_frames_per_phone = 3;
+	options.num_repeats = 3;
+	options.min_detection_interval = 0;
+	options.sensitivity_str = "0.5";
+	options.high_sensitivity_str = "";
+	options.model_str = model;
+	options.smooth_window_str = "";
+	options.slide_window_str = "";
+	options.debug_mode = false;
+	return options;
+}
+
+// Replaces the keywords of the first model with `num_keywords` random keywords drawn from a small
+// pool of outputs, so that most phones are shared between keywords like in real multi hotword models.
+static void synthesize_keywords(snowboy::UniversalDetectStream::ModelInfo* model, size_t num_keywords, unsigned int* seed) {
+	const auto num_outputs = model->slide_buffer.m_cols;
+	auto base = model->keywords.front();
+	model->keywords.clear();
+	for (size_t k = 0; k < num_keywords; k++) {
+		auto kw = base;
+		kw.hotword_id = k + 1;
+		kw.field_x88.resize(3 + rand_r(seed) % 6);
+		kw.search_floor.resize(kw.field_x88.size());
+		for (size_t i = 0; i < kw.field_x88.size(); i++) {
+			kw.field_x88[i] = 1 + rand_r(seed) % std::min<size_t>(num_outputs - 1, 16);
+			kw.search_floor[i] = (rand_r(seed) % 100) / 1000.0f;
+		}
+		model->keywords.push_back(kw);
+	}
+	model->InitSlideBuffer(1);
+	model->UpdateThresholds();
+}
+
+static float reference_naive_search(const snowboy::UniversalDetectStream::ModelInfo& model, size_t keyword_id) {
+	auto& kw = model.keywords[keyword_id];
+	auto row = model.SlideWindowRow(0);
+	float sum = 0.0f;
+	for (size_t i = 0; i < kw.field_x88.size(); i++) {
+		auto x = row[kw.field_x88[i]];
+		if (kw.search_floor[i] > x) return 0.0f;
+		sum += logf(std::max(x, std::numeric_limits<float>::min()));
+	}
+	return expf(sum / static_cast<float>(kw.field_x88.size()));
+}
+
+TEST(UniversalDetectTest, NaiveSearchManyKeywords) {
+	snowboy::UniversalDetectStream stream{universal_options(root + "resources/models/snowboy.umdl")};
+	auto& model = stream.m_model_info.front();
+	unsigned int seed = 1234;
+	synthesize_keywords(&model, 64, &seed);
+
+	const size_t num_frames = 2000;
+	snowboy::Matrix frames;
+	frames.Resize(num_frames, model.slide_buffer.m_cols);
+	for (size_t r = 0; r < frames.m_rows; r++) {
+		for (size_t c = 0; c < frames.m_cols; c++) {
+			frames(r, c) = (rand_r(&seed) % 1000) / 1000.0f;
+		}
+	}
+
+	std::chrono::nanoseconds time_ref{0}, time_new{0};
+	float checksum_ref = 0.0f, checksum_new = 0.0f;
+	for (size_t r = 0; r < num_frames; r++) {
+		model.PushSlideWindow(frames.RowRange(r, 1));
+		auto start = std::chrono::steady_clock::now();
+		for (size_t k = 0; k < model.keywords.size(); k++)
+			checksum_ref += reference_naive_search(model, k);
+		auto mid = std::chrono::steady_clock::now();
+		// Already done by PushSlideWindow, repeated so the shared log computation is part of the timing
+		model.UpdateSlideLogPosterior();
+		for (size_t k = 0; k < model.keywords.size(); k++)
+			checksum_new += model.HotwordNaiveSearch(k);
+		auto end = std::chrono::steady_clock::now();
+		time_ref += mid - start;
+		time_new += end - mid;
+		for (size_t k = 0; k < model.keywords.size(); k++)
+			ASSERT_EQ(reference_naive_search(model, k), model.HotwordNaiveSearch(k)) << "frame " << r << " keyword " << k;
+	}
+	ASSERT_EQ(checksum_ref, checksum_new);
+	GTEST_WARN("naive search, %zu keywords: reference %.1f ns/frame, cached %.1f ns/frame", model.keywords.size(),
+			   double(time_ref.count()) / num_frames, double(time_new.count()) / num_frames);
+}
+
+TEST(UniversalDetectTest, KeywordScaling) {
+	const size_t num_frames = 3000;
+	const size_t chunk_size = 10;
+	std::chrono::nanoseconds time_single{0};
+	for (size_t num_keywords : {1, 8, 32, 64, 128}) {
+		// The reference always takes the slow path, like the stream did before the trigger check
+		snowboy::InterceptStream input, reference_input;
+		auto options = universal_options(root + "resources/models/snowboy.umdl");
+		// Random features give posteriors of a few percent once the floors are gone, these thresholds let
+		// some frames reach the slow path and detect
+		options.sensitivity_str = "0.97";
+		options.high_sensitivity_str = "0.98";
+		snowboy::UniversalDetectStream stream{options};
+		snowboy::UniversalDetectStream reference{options};
+		stream.Connect(&input);
+		reference.Connect(&reference_input);
+		unsigned int seed = 42;
+		synthesize_keywords(&stream.m_model_info.front(), num_keywords, &seed);
+		seed = 42;
+		synthesize_keywords(&reference.m_model_info.front(), num_keywords, &seed);
+		for (auto e : {&stream, &reference}) {
+			for (auto& kw : e->m_model_info.front().keywords)
+				std::fill(kw.search_floor.begin(), kw.search_floor.end(), 0.0f);
+		}
+		auto& triggers = reference.m_model_info.front().kw_trigger;
+		std::fill(triggers.begin(), triggers.end(), -1.0f);
+
+		snowboy::Matrix features;
+		features.Resize(chunk_size, stream.m_model_info.front().network.InputDim());
+		std::vector<snowboy::FrameInfo> info(chunk_size);
+		std::chrono::nanoseconds time{0};
+		size_t num_detections = 0;
+		for (size_t f = 0; f < num_frames; f += chunk_size) {
+			for (size_t r = 0; r < features.m_rows; r++) {
+				info[r].frame_id = f + r;
+				for (size_t c = 0; c < features.m_cols; c++)
+					features(r, c) = (rand_r(&seed) % 2000) / 100.0f - 10.0f;
+			}
+			input.SetData(features, info, static_cast<snowboy::SnowboySignal>(0));
+			reference_input.SetData(features, info, static_cast<snowboy::SnowboySignal>(0));
+			snowboy::Matrix out, reference_out;
+			std::vector<snowboy::FrameInfo> out_info, reference_info;
+			auto start = std::chrono::steady_clock::now();
+			stream.Read(&out, &out_info);
+			time += std::chrono::steady_clock::now() - start;
+			reference.Read(&reference_out, &reference_info);
+
+			ASSERT_EQ(out.m_rows, reference_out.m_rows) << num_keywords << " keywords, frame " << f;
+			if (out.m_rows != 0) {
+				num_detections++;
+				ASSERT_EQ(out.m_data[0], reference_out.m_data[0]) << num_keywords << " keywords, frame " << f;
+				ASSERT_EQ(out_info[0].frame_id, reference_info[0].frame_id) << num_keywords << " keywords, frame " << f;
+			}
+			ASSERT_EQ(stream.m_model_info.front().kw_posterior, reference.m_model_info.front().kw_posterior)
+				<< num_keywords << " keywords, frame " << f;
+			ASSERT_EQ(stream.field_x60, reference.field_x60) << num_keywords << " keywords, frame " << f;
+			ASSERT_EQ(stream.field_x68, reference.field_x68) << num_keywords << " keywords, frame " << f;
+		}
+		if (num_keywords == 1) time_single = time;
+		GTEST_WARN("%3zu keywords: %.2f us/frame (%.2fx single keyword), %zu detections", num_keywords,
+				   double(time.count()) / num_frames / 1000.0, double(time.count()) / double(time_single.count()), num_detections);
+	}
+}
+
+// `value` once per hotword, the way the score app sweeps several models
+static std::string repeat_sensitivity(const std::string& value, int num_hotwords) {
+	std::string res;
+	for (int i = 0; i < num_hotwords && !value.empty(); i++)
+		res += (i == 0 ? "" : ",") + value;
+	return res;
+}
+
+// Checks that the detections evaluated from a score trace match full runs at every sensitivity of the sweep
+static void check_sensitivity_sweep(const std::string& models) {
+	const auto resource = root + "resources/common.res";
+	const std::vector<std::pair<std::string, std::string>> sweep = {
+		{"0.3", ""}, {"0.4", ""}, {"0.5", ""}, {"0.6", ""}, {"0.7", ""}, {"0.8", ""}, {"0.4", "0.6"}, {"0.5", "0.7"}};
+	const size_t chunksize = 1600;
+	std::chrono::nanoseconds time_full{0}, time_sweep{0};
+	size_t num_detections = 0;
+	for (auto& e : {"hotword1.wav", "hotword2.wav", "hotword3.wav", "hotword3_fail.wav", "noise1.wav", "noise2.wav", "sample1.wav", "snowboy.wav"}) {
+		if (!file_exists(root + "audio_samples/" + e)) {
+			GTEST_WARN("Skiping %s because audio file is missing!", e);
+			continue;
+		}
+		auto data = read_sample_file(root + "audio_samples/" + e);
+		auto start = std::chrono::steady_clock::now();
+		snowboy::SnowboyDetect traced(resource, models);
+		const int num_hotwords = traced.NumHotwords();
+		traced.StartScoreTrace();
+		for (size_t i = 0; i < data.size(); i += chunksize) {
+			auto len = std::min<size_t>(chunksize, data.size() - i);
+			ASSERT_LE(traced.RunDetection(data.data() + i, len, i + len == data.size()), 0);
+		}
+		std::vector<std::vector<snowboy::HotwordDetection>> swept;
+		for (auto& s : sweep)
+			swept.push_back(traced.EvaluateScoreTrace(repeat_sensitivity(s.first, num_hotwords), repeat_sensitivity(s.second, num_hotwords)));
+		time_sweep += std::chrono::steady_clock::now() - start;
+
+		for (size_t k = 0; k < sweep.size(); k++) {
+			start = std::chrono::steady_clock::now();
+			snowboy::SnowboyDetect detector(resource, models);
+			detector.SetSensitivity(repeat_sensitivity(sweep[k].first, num_hotwords));
+			if (!sweep[k].second.empty()) detector.SetHighSensitivity(repeat_sensitivity(sweep[k].second, num_hotwords));
+			std::vector<snowboy::HotwordDetection> expected;
+			for (size_t i = 0; i < data.size(); i += chunksize) {
+				auto len = std::min<size_t>(chunksize, data.size() - i);
+				auto res = detector.RunDetection(data.data() + i, len, i + len == data.size());
+				if (res > 0) expected.push_back({res, detector.GetLastDetectionFrameId(), detector.GetLastDetectionScore()});
+			}
+			time_full += std::chrono::steady_clock::now() - start;
+			ASSERT_EQ(expected.size(), swept[k].size()) << e << " sensitivity " << sweep[k].first << "/" << sweep[k].second;
+			for (size_t i = 0; i < expected.size(); i++) {
+				ASSERT_EQ(expected[i].hotword, swept[k][i].hotword) << e << " detection " << i;
+				ASSERT_EQ(expected[i].frame_id, swept[k][i].frame_id) << e << " detection " << i;
+				ASSERT_EQ(expected[i].score, swept[k][i].score) << e << " detection " << i;
+			}
+			num_detections += expected.size();
+		}
+	}
+	GTEST_WARN("%zu sensitivities, %zu detections: full runs %.1f ms, trace and sweep %.1f ms", sweep.size(), num_detections,
+			   std::chrono::duration<double, std::milli>(time_full).count(), std::chrono::duration<double, std::milli>(time_sweep).count());
+}
+
+TEST(UniversalDetectTest, SensitivitySweep) {
+	check_sensitivity_sweep(root + "resources/models/snowboy.umdl");
+}
+
+TEST(UniversalDetectTest, SensitivitySweepMultipleModels) {
+	// jarvis.umdl holds two hotwords, so every sensitivity is given three times
+	check_sensitivity_sweep(root + "resources/models/snowboy.umdl," + root + "resources/models/jarvis.umdl");
+}
+
+// Detections of a detector run over `data` with `sensitivity`
+static std::vector<snowboy::HotwordDetection> run_detection(const std::string& resource, const std::string& model, const std::vector<short>& data,
+															 const std::string& sensitivity, size_t chunksize) {
+	snowboy::SnowboyDetect detector(resource, model);
+	detector.SetSensitivity(sensitivity);
+	std::vector<snowboy::HotwordDetection> res;
+	for (size_t i = 0; i < data.size(); i += chunksize) {
+		auto len = std::min<size_t>(chunksize, data.size() - i);
+		auto hotword = detector.RunDetection(data.data() + i, len, i + len == data.size());
+		if (hotword > 0) res.push_back({hotword, detector.GetLastDetectionFrameId(), detector.GetLastDetectionScore()});
+	}
+	return res;
+}
+
+// Detections at each of `sweep` from a score trace of `data`
+static std::vector<std::vector<snowboy::HotwordDetection>> sweep_detection(const std::string& resource, const std::string& model, const std::vector<short>& data,
+																		   const std::vector<std::string>& sweep, size_t chunksize, float min_rerun_seconds) {
+	snowboy::SnowboyDetect detector(resource, model);
+	detector.StartScoreTrace(min_rerun_seconds);
+	for (size_t i = 0; i < data.size(); i += chunksize) {
+		auto len = std::min<size_t>(chunksize, data.size() - i);
+		EXPECT_LE(detector.RunDetection(data.data() + i, len, i + len == data.size()), 0);
+	}
+	std::vector<std::vector<snowboy::HotwordDetection>> res;
+	for (auto& s : sweep)
+		res.push_back(detector.EvaluateScoreTrace(s));
+	return res;
+}
+
+TEST(UniversalDetectTest, SensitivitySweepLongFile) {
+	// Two minutes of audio with a detection every few seconds, the audio after each of them must not be run to the end
+	const auto resource = root + "resources/common.res";
+	const auto model = root + "resources/models/snowboy.umdl";
+	std::vector<short> data;
+	for (int i = 0; i < 10; i++) {
+		for (auto& e : {"hotword1.wav", "noise1.wav", "noise2.wav", "hotword2.wav", "noise3.wav", "hotword3_fail.wav", "sample1.wav"}) {
+			if (!file_exists(root + "audio_samples/" + e)) GTEST_SKIP() << "audio file is missing";
+			auto samples = read_sample_file(root + "audio_samples/" + e);
+			data.insert(data.end(), samples.begin(), samples.end());
+		}
+	}
+	std::vector<std::string> sweep;
+	for (int i = 30; i <= 70; i += 5)
+		sweep.push_back("0." + std::to_string(i));
+	const size_t chunksize = 1600;
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::vector<snowboy::HotwordDetection>> expected;
+	for (auto& s : sweep)
+		expected.push_back(run_detection(resource, model, data, s, chunksize));
+	auto time_full = std::chrono::steady_clock::now() - start;
+	start = std::chrono::steady_clock::now();
+	auto exact = sweep_detection(resource, model, data, sweep, chunksize, 0);
+	auto time_exact = std::chrono::steady_clock::now() - start;
+	start = std::chrono::steady_clock::now();
+	// Reusing the scores of the whole audio happens to give the same detections for this audio
+	auto reused = sweep_detection(resource, model, data, sweep, chunksize, 2);
+	auto time_reused = std::chrono::steady_clock::now() - start;
+
+	size_t num_detections = 0;
+	for (size_t k = 0; k < sweep.size(); k++) {
+		for (auto swept : {&exact[k], &reused[k]}) {
+			const auto what = "sensitivity " + sweep[k] + (swept == &exact[k] ? "" : " reusing scores");
+			ASSERT_EQ(expected[k].size(), swept->size()) << what;
+			for (size_t i = 0; i < expected[k].size(); i++) {
+				ASSERT_EQ(expected[k][i].hotword, (*swept)[i].hotword) << what << " detection " << i;
+				ASSERT_EQ(expected[k][i].frame_id, (*swept)[i].frame_id) << what << " detection " << i;
+				ASSERT_EQ(expected[k][i].score, (*swept)[i].score) << what << " detection " << i;
+			}
+		}
+		num_detections += expected[k].size();
+	}
+	GTEST_WARN("%.0f s of audio, %zu sensitivities, %zu detections: full runs %.1f ms, exact sweep %.1f ms, sweep reusing scores %.1f ms",
+			   data.size() / 16000.0, sweep.size(), num_detections, std::chrono::duration<double, std::milli>(time_full).count(),
+			   std::chrono::duration<double, std::milli>(time_exact).count(), std::chrono::duration<double, std::milli>(time_reused).count());
+}
+
+TEST(UniversalDetectTest, FrameScoreTrace) {
+	const auto resource = root + "resources/common.res";
+	const auto models = root + "resources/models/snowboy.umdl," + root + "resources/pmdl/hey_casper.pmdl";
+	if (!file_exists(root + "audio_samples/sample1.wav")) {
+		GTEST_SKIP() << "audio file is missing";
+	}
+	auto data = read_sample_file(root + "audio_samples/sample1.wav");
+	const size_t chunksize = 1600;
+	auto run = [&](snowboy::FrameScoreSink* sink, std::vector<snowboy::HotwordDetection>* detections) {
+		snowboy::SnowboyDetect detector(resource, models);
+		detector.SetSensitivity("0.5,0.45");
+		detector.SetFrameScoreSink(sink);
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < data.size(); i += chunksize) {
+			auto len = std::min<size_t>(chunksize, data.size() - i);
+			auto res = detector.RunDetection(data.data() + i, len, i + len == data.size());
+			if (res > 0) detections->push_back({res, detector.GetLastDetectionFrameId(), detector.GetLastDetectionScore()});
+		}
+		return std::chrono::steady_clock::now() - start;
+	};
+
+	std::vector<snowboy::HotwordDetection> expected, traced, buffered;
+	auto time_plain = run(nullptr, &expected);
+	std::chrono::nanoseconds time_traced;
+	{
+		snowboy::FrameScoreFileSink sink{"temp_frame_scores.bin"};
+		time_traced = run(&sink, &traced);
+	}
+	snowboy::FrameScoreRingBuffer ring{100};
+	run(&ring, &buffered);
+	ASSERT_EQ(expected.size(), traced.size());
+	ASSERT_EQ(expected.size(), buffered.size());
+
+	auto scores = snowboy::ReadFrameScores("temp_frame_scores.bin");
+	size_t num_universal = 0, num_template = 0;
+	for (auto& e : scores) {
+		if (e.kind == snowboy::FrameScore::kUniversalPosterior) {
+			num_universal++;
+			ASSERT_EQ(e.hotword, 1);
+			ASSERT_EQ(e.template_id, 0);
+		} else {
+			ASSERT_EQ(e.kind, snowboy::FrameScore::kTemplateDistance);
+			num_template++;
+			// The personal model comes second in the model list
+			ASSERT_EQ(e.hotword, 2);
+			ASSERT_LT(e.template_id, 3);
+		}
+	}
+	ASSERT_GT(num_universal, 0);
+	ASSERT_EQ(num_template % 3, 0);
+	ASSERT_GT(num_template, 0);
+	// The score of every universal detection is the posterior traced for its frame and hotword
+	for (auto& d : expected) {
+		if (d.hotword != 1) continue;
+		auto it = std::find_if(scores.begin(), scores.end(), [&](const snowboy::FrameScore& e) {
+			return e.kind == snowboy::FrameScore::kUniversalPosterior && e.hotword == static_cast<uint32_t>(d.hotword) && e.frame_id == d.frame_id
+				   && e.score == d.score;
+		});
+		ASSERT_NE(it, scores.end()) << "detection at frame " << d.frame_id;
+	}
+
+	auto last = ring.Scores();
+	ASSERT_EQ(last.size(), 100);
+	for (size_t i = 0; i < last.size(); i++) {
+		auto& e = scores[scores.size() - last.size() + i];
+		ASSERT_EQ(e.frame_id, last[i].frame_id);
+		ASSERT_EQ(e.kind, last[i].kind);
+		ASSERT_EQ(e.score, last[i].score);
+	}
+	ring.Save("temp_frame_scores_ring.bin");
+	ASSERT_EQ(snowboy::ReadFrameScores("temp_frame_scores_ring.bin").size(), last.size());
+	GTEST_WARN("%zu frame scores, detection without sink %.2f ms, with file sink %.2f ms", scores.size(),
+			   std::chrono::duration<double, std::milli>(time_plain).count(), std::chrono::duration<double, std::milli>(time_traced).count());
+}
+
+TEST(UniversalDetectTest, FrameScoreFileSinkWriteError) {
+	if (!file_exists("/dev/full")) {
+		GTEST_SKIP() << "/dev/full is missing";
+	}
+	std::vector<snowboy::FrameScore> scores(8192);
+	auto sink = std::make_unique<snowboy::FrameScoreFileSink>("/dev/full");
+	ASSERT_THROW(sink->Write(scores.data(), scores.size()), snowboy::snowboy_exception);
+	ASSERT_THROW(sink->Flush(), snowboy::snowboy_exception);
+	// The stream is in a failed state, destroying the sink must not throw
+	sink.reset();
+}
+
+TEST(UniversalDetectTest, BatchedNetworksMatchSeparate) {
+	snowboy::UniversalDetectStream stream{universal_options(root + "resources/models/snowboy.umdl")};
+	const auto& network = stream.m_model_info.front().network;
+	const size_t num_channels = 4;
+	std::vector<snowboy::Nnet> shared(num_channels), separate;
+	for (size_t c = 0; c < num_channels; c++) {
+		shared[c].ShareComponents(network);
+		separate.push_back(network);
+	}
+
+	unsigned int seed = 7;
+	std::chrono::nanoseconds time_batch{0}, time_separate{0};
+	for (size_t step = 0; step < 300; step++) {
+		std::vector<snowboy::Matrix> features(num_channels);
+		std::vector<std::vector<snowboy::FrameInfo>> info(num_channels);
+		for (size_t c = 0; c < num_channels; c++) {
+			// Channels may be handed a different number of frames
+			const size_t rows = step % 7 == 0 ? rand_r(&seed) % 4 : 10;
+			features[c].Resize(rows, network.InputDim());
+			info[c].resize(rows);
+			for (size_t r = 0; r < rows; r++) {
+				info[c][r].frame_id = step * 10 + r;
+				for (size_t i = 0; i < features[c].m_cols; i++)
+					features[c](r, i) = (rand_r(&seed) % 2000) / 100.0f - 10.0f;
+			}
+		}
+		std::vector<snowboy::Nnet*> nets;
+		std::vector<const snowboy::MatrixBase*> inputs;
+		std::vector<const std::vector<snowboy::FrameInfo>*> inputs_info;
+		for (size_t c = 0; c < num_channels; c++) {
+			nets.push_back(&shared[c]);
+			inputs.push_back(&features[c]);
+			inputs_info.push_back(&info[c]);
+		}
+		std::vector<snowboy::Matrix> outputs;
+		std::vector<std::vector<snowboy::FrameInfo>> outputs_info;
+		auto start = std::chrono::steady_clock::now();
+		snowboy::Nnet::ComputeBatch(nets, inputs, inputs_info, &outputs, &outputs_info);
+		time_batch += std::chrono::steady_clock::now() - start;
+
+		for (size_t c = 0; c < num_channels; c++) {
+			snowboy::Matrix expected;
+			std::vector<snowboy::FrameInfo> expected_info;
+			start = std::chrono::steady_clock::now();
+			separate[c].Compute(features[c], info[c], &expected, &expected_info);
+			time_separate += std::chrono::steady_clock::now() - start;
+			ASSERT_EQ(outputs[c].m_rows, expected.m_rows) << "channel " << c << " step " << step;
+			ASSERT_EQ(outputs_info[c].size(), expected_info.size());
+			for (size_t r = 0; r < expected.m_rows; r++) {
+				ASSERT_EQ(outputs_info[c][r].frame_id, expected_info[r].frame_id);
+				for (size_t i = 0; i < expected.m_cols; i++)
+					ASSERT_NEAR(outputs[c](r, i), expected(r, i), 1e-5f) << "channel " << c << " step " << step;
+			}
+		}
+	}
+	GTEST_WARN("%zu channels: batched %.2f ms, separate %.2f ms", num_channels, time_batch.count() / 1e6, time_separate.count() / 1e6);
+}
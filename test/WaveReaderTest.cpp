@@ -0,0 +1,56 @@
+#include <cstring>
+#include <helper.h>
+#include <snowboy-detect.h>
+#include <snowboy-error.h>
+#include <wave-reader.h>
+
+const static auto root = detect_project_root();
+
+TEST(WaveReaderTest, MatchesSampleFile) {
+	bool skipped_all = true;
+	for (auto& e : {"hotword1.wav", "noise1.wav", "snowboy.wav"}) {
+		if (!file_exists(root + "audio_samples/" + e)) {
+			GTEST_WARN("Skiping %s because audio file is missing!", e);
+			continue;
+		}
+		skipped_all = false;
+		auto expected = read_sample_file(root + "audio_samples/" + e);
+		snowboy::WaveReader reader{root + "audio_samples/" + e};
+		ASSERT_NO_THROW(reader.CheckFormat(16000, 1, 16));
+		ASSERT_THROW(reader.CheckFormat(8000, 1, 16), snowboy::snowboy_exception);
+		ASSERT_EQ(reader.NumFrames(), expected.size());
+
+		size_t pos = 0;
+		size_t len = 0;
+		while (auto chunk = reader.NextChunk(1000, &len)) {
+			ASSERT_LE(len, 1000);
+			ASSERT_EQ(memcmp(chunk, expected.data() + pos, len * sizeof(int16_t)), 0) << e << " at frame " << pos;
+			pos += len;
+		}
+		ASSERT_EQ(pos, expected.size());
+		reader.Seek(10);
+		ASSERT_EQ(reader.NextChunk(5, &len), reader.Samples() + 10);
+	}
+	ASSERT_FALSE(skipped_all);
+}
+
+TEST(WaveReaderTest, DetectFromChunks) {
+	if (!file_exists(root + "audio_samples/snowboy.wav")) {
+		GTEST_WARN("Skiping because audio file is missing!");
+		return;
+	}
+	snowboy::SnowboyDetect detector(root + "resources/common.res", root + "resources/models/snowboy.umdl");
+	detector.ApplyFrontend(false);
+	snowboy::WaveReader reader{root + "audio_samples/snowboy.wav"};
+	reader.CheckFormat(detector.SampleRate(), detector.NumChannels(), detector.BitsPerSample());
+	int result = 0;
+	size_t len = 0;
+	while (auto chunk = reader.NextChunk(1600, &len))
+		result = std::max(result, detector.RunDetection(chunk, len * detector.NumChannels()));
+	ASSERT_EQ(result, 1);
+}
+
+TEST(WaveReaderTest, RejectsInvalidFiles) {
+	ASSERT_THROW(snowboy::WaveReader{root + "resources/common.res"}, snowboy::snowboy_exception);
+	ASSERT_THROW(snowboy::WaveReader{"does_not_exist.wav"}, snowboy::snowboy_exception);
+}
@@ -111,6 +111,11 @@ EMSCRIPTEN_BINDINGS(snowman) {
 		.function("NumHotwords", &snowboy::SnowboyDetect::NumHotwords)
 		.function("SetAudioGain", &snowboy::SnowboyDetect::SetAudioGain)
 		.function("ApplyFrontend", &snowboy::SnowboyDetect::ApplyFrontend)
+		.function("SetInputSampleRate", &snowboy::SnowboyDetect::SetInputSampleRate)
+		.function("SetNumChannels", &snowboy::SnowboyDetect::SetNumChannels)
+		.function("SetChannelMix", &snowboy::SnowboyDetect::SetChannelMix)
+		.function("SetPowerSaving", &snowboy::SnowboyDetect::SetPowerSaving)
+		.function("GetLastDetectionChannel", &snowboy::SnowboyDetect::GetLastDetectionChannel)
 		.function("Reset", &snowboy::SnowboyDetect::Reset)
 		.function("RunDetectionI16", &SnowboyDetect_RunDetectionI16)
 		.function("RunDetectionI32", &SnowboyDetect_RunDetectionI32)